@@ -0,0 +1,8 @@
+#ifndef _BENCH_ALL_H
+#define _BENCH_ALL_H
+
+void bench_string_utils();
+void bench_uri();
+void bench_json();
+
+#endif // _BENCH_ALL_H
@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "bench.h"
+
+volatile size_t bench_sink;
+
+// Every malloc family call of the benchmarked code goes through these,
+// the binary is linked with -Wl,--wrap for each of them.
+static size_t bench_allocs;
+static size_t bench_alloc_bytes;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+  bench_allocs++;
+  bench_alloc_bytes += size;
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+  bench_allocs++;
+  bench_alloc_bytes += count * size;
+  return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  bench_allocs++;
+  bench_alloc_bytes += size;
+  return __real_realloc(ptr, size);
+}
+
+static uint64_t bench_now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t bench_random(uint64_t *state) {
+  uint64_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  *state = x;
+  return x;
+}
+
+// One tab separated line per case so runs can be diffed or loaded as is.
+void bench_header() {
+  printf("# name\tbytes\titerations\tns_per_op\tmb_per_s\tallocs_per_op\t"
+         "alloc_bytes_per_op\n");
+}
+
+// Iterations double until one batch runs for BENCH_MIN_NS, only that batch
+// is reported.
+void bench_run(const char *name, size_t bytes, BenchFn fn, void *context) {
+  fn(context);
+  size_t iterations = 1;
+  while (true) {
+    size_t allocs = bench_allocs;
+    size_t alloc_bytes = bench_alloc_bytes;
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < iterations; ++i) {
+      fn(context);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+    if (elapsed >= BENCH_MIN_NS) {
+      double ns = (double)elapsed / (double)iterations;
+      double mb_per_s = bytes > 0 ? (double)bytes / ns * 1e9 / 1e6 : 0;
+      printf("%s\t%zu\t%zu\t%.1f\t%.1f\t%.2f\t%.1f\n", name, bytes,
+             iterations, ns, mb_per_s,
+             (double)(bench_allocs - allocs) / (double)iterations,
+             (double)(bench_alloc_bytes - alloc_bytes) / (double)iterations);
+      fflush(stdout);
+      return;
+    }
+    iterations *= 2;
+  }
+}
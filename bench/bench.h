@@ -0,0 +1,21 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../src/string_utils.h"
+
+#ifndef _BENCH_H
+#define _BENCH_H
+
+#define BENCH_MIN_NS 200000000ULL
+#define BENCH_SEED 0x9e3779b97f4a7c15ULL
+
+typedef void (*BenchFn)(void *context);
+
+// bytes is the input size of one op, 0 when MB/s does not apply.
+void bench_run(const char *name, size_t bytes, BenchFn fn, void *context);
+void bench_header();
+uint64_t bench_random(uint64_t *state);
+
+extern volatile size_t bench_sink;
+
+#endif // _BENCH_H
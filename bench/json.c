@@ -0,0 +1,156 @@
+#include <stdio.h>
+
+#include "../src/json.h"
+#include "../src/json_lines.h"
+#include "bench.h"
+
+#define BENCH_CORPUS_SIZE (4 * 1024 * 1024)
+#define BENCH_NESTED_DEPTH 64
+#define BENCH_WIDE_KEYS 100000
+
+static void bench_append(StringBuffer *sb, const char *s) {
+  sb_append(sb, sv_new_from_cstr(s));
+}
+
+static void bench_corpus_strings(StringBuffer *sb, uint64_t *state) {
+  bench_append(sb, "[");
+  for (size_t i = 0; sb->len < BENCH_CORPUS_SIZE; ++i) {
+    char buf[160];
+    snprintf(buf, sizeof(buf),
+             "%s{\"title\":\"lorem ipsum dolor sit amet %llu\","
+             "\"body\":\"consectetur \\\"adipiscing\\\" elit\\n sed do "
+             "eiusmod tempor\",\"tag\":\"t%llu\"}",
+             i > 0 ? "," : "", (unsigned long long)bench_random(state),
+             (unsigned long long)(i % 100));
+    bench_append(sb, buf);
+  }
+  bench_append(sb, "]");
+}
+
+static void bench_corpus_numbers(StringBuffer *sb, uint64_t *state) {
+  bench_append(sb, "[");
+  for (size_t i = 0; sb->len < BENCH_CORPUS_SIZE; ++i) {
+    uint64_t r = bench_random(state);
+    char buf[128];
+    snprintf(buf, sizeof(buf), "%s[%lld,%.17g,%llu,%.3f]", i > 0 ? "," : "",
+             (long long)(r % 2000000) - 1000000, (double)r / 3.0e15,
+             (unsigned long long)r, (double)(r % 100000) / 7.0);
+    bench_append(sb, buf);
+  }
+  bench_append(sb, "]");
+}
+
+static void bench_corpus_nested(StringBuffer *sb, uint64_t *state) {
+  bench_append(sb, "[");
+  for (size_t i = 0; sb->len < BENCH_CORPUS_SIZE; ++i) {
+    bench_append(sb, i > 0 ? "," : "");
+    for (size_t d = 0; d < BENCH_NESTED_DEPTH; ++d) {
+      bench_append(sb, d % 2 == 0 ? "{\"a\":" : "[");
+    }
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%llu",
+             (unsigned long long)(bench_random(state) % 1000));
+    bench_append(sb, buf);
+    for (size_t d = BENCH_NESTED_DEPTH; d > 0; --d) {
+      bench_append(sb, (d - 1) % 2 == 0 ? "}" : "]");
+    }
+  }
+  bench_append(sb, "]");
+}
+
+static void bench_corpus_wide(StringBuffer *sb, uint64_t *state) {
+  bench_append(sb, "{");
+  for (size_t i = 0; i < BENCH_WIDE_KEYS; ++i) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%s\"key_%zu_%llu\":%zu", i > 0 ? "," : "", i,
+             (unsigned long long)(bench_random(state) % 1000), i);
+    bench_append(sb, buf);
+  }
+  bench_append(sb, "}");
+}
+
+static void bench_corpus_ndjson(StringBuffer *sb, uint64_t *state) {
+  for (size_t i = 0; sb->len < BENCH_CORPUS_SIZE; ++i) {
+    char buf[160];
+    snprintf(buf, sizeof(buf),
+             "{\"id\":%zu,\"user\":\"u%llu\",\"score\":%.2f,\"ok\":%s}\n", i,
+             (unsigned long long)(bench_random(state) % 10000),
+             (double)(i % 1000) / 3.0, i % 3 == 0 ? "true" : "false");
+    bench_append(sb, buf);
+  }
+}
+
+static void bench_json_free(Json *json) {
+  if (json->type == JSON_ARRAY) {
+    json_array_free(json->array);
+  } else {
+    json_object_free(json->object);
+  }
+}
+
+static void _json_parse_cb(void *context) {
+  Json json;
+  if (json_parse(context, &json)) {
+    bench_sink += json.type;
+    bench_json_free(&json);
+  }
+}
+
+static void _json_stringify_cb(void *context) {
+  StringBuffer *out = sb_new();
+  json_stringify(context, out);
+  bench_sink += out->len;
+  sb_free(out);
+}
+
+static bool _json_lines_value_cb(Json *value, size_t offset, void *context) {
+  (void)value;
+  (void)context;
+  bench_sink += offset;
+  return true;
+}
+
+static void _json_parse_lines_cb(void *context) {
+  StringBuffer *input = context;
+  JsonLinesHandler handler = {.on_value = _json_lines_value_cb};
+  json_parse_lines(sv_new(input->data, input->len), 1, &handler);
+}
+
+typedef struct {
+  const char *name;
+  void (*generate)(StringBuffer *sb, uint64_t *state);
+} BenchCorpus;
+
+static const BenchCorpus bench_corpora[] = {
+    {"strings", bench_corpus_strings},
+    {"numbers", bench_corpus_numbers},
+    {"nested", bench_corpus_nested},
+    {"wide", bench_corpus_wide},
+};
+
+void bench_json() {
+  char name[64];
+  for (size_t i = 0; i < sizeof(bench_corpora) / sizeof(bench_corpora[0]);
+       ++i) {
+    uint64_t state = BENCH_SEED;
+    StringBuffer *input = sb_new();
+    bench_corpora[i].generate(input, &state);
+
+    snprintf(name, sizeof(name), "json_parse/%s", bench_corpora[i].name);
+    bench_run(name, input->len, _json_parse_cb, input);
+
+    Json json;
+    json_parse(input, &json);
+    snprintf(name, sizeof(name), "json_stringify/%s", bench_corpora[i].name);
+    bench_run(name, input->len, _json_stringify_cb, &json);
+    bench_json_free(&json);
+    sb_free(input);
+  }
+
+  uint64_t state = BENCH_SEED;
+  StringBuffer *lines = sb_new();
+  bench_corpus_ndjson(lines, &state);
+  bench_run("json_parse_lines/ndjson", lines->len, _json_parse_lines_cb,
+            lines);
+  sb_free(lines);
+}
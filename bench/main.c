@@ -0,0 +1,10 @@
+#include "_all.h"
+#include "bench.h"
+
+int main() {
+  bench_header();
+  bench_string_utils();
+  bench_uri();
+  bench_json();
+  return 0;
+}
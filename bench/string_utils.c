@@ -0,0 +1,48 @@
+#include <string.h>
+
+#include "bench.h"
+
+#define BENCH_HAYSTACK_SIZE (1024 * 1024)
+#define BENCH_APPEND_PIECE "0123456789abcdef"
+
+typedef struct {
+  StringBuffer *haystack;
+  StringView needle;
+} FindCase;
+
+static void _sv_find_cb(void *context) {
+  FindCase *c = context;
+  bench_sink += (size_t)sv_find(sv_new(c->haystack->data, c->haystack->len),
+                                c->needle);
+}
+
+static void _sb_append_cb(void *context) {
+  StringBuffer *sb = sb_new();
+  StringView piece = sv_new_from_cstr(BENCH_APPEND_PIECE);
+  for (size_t i = 0; i < *(size_t *)context; ++i) {
+    sb_append(sb, piece);
+  }
+  bench_sink += sb->len;
+  sb_free(sb);
+}
+
+void bench_string_utils() {
+  FindCase find = {
+      .haystack = sb_new_with_custom_cap(BENCH_HAYSTACK_SIZE + 1),
+      .needle = sv_new_from_cstr("needle in the haystack"),
+  };
+  uint64_t state = BENCH_SEED;
+  char *data = (char *)find.haystack->data;
+  for (size_t i = 0; i < BENCH_HAYSTACK_SIZE; ++i) {
+    data[i] = (char)('a' + bench_random(&state) % 26);
+  }
+  memcpy(data + BENCH_HAYSTACK_SIZE - find.needle.len, find.needle.data,
+         find.needle.len);
+  find.haystack->len = BENCH_HAYSTACK_SIZE;
+  data[BENCH_HAYSTACK_SIZE] = '\0';
+  bench_run("sv_find/1MB", BENCH_HAYSTACK_SIZE, _sv_find_cb, &find);
+  sb_free(find.haystack);
+
+  size_t pieces = BENCH_HAYSTACK_SIZE / strlen(BENCH_APPEND_PIECE);
+  bench_run("sb_append/16B*64K", BENCH_HAYSTACK_SIZE, _sb_append_cb, &pieces);
+}
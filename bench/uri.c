@@ -0,0 +1,66 @@
+#include <stdio.h>
+
+#include "../src/uri.h"
+#include "bench.h"
+
+#define BENCH_QUERY_PAIRS 32
+
+static const char *bench_uri_input =
+    "https://api.example.com/v2/users/12345/orders?status=open&limit=50"
+    "&sort=-created_at&fields=id,total,items#summary";
+
+static void _uri_parse_cb(void *context) {
+  UriComponents components = {0};
+  uri_parse(*(StringView *)context, &components);
+  bench_sink += components.path.len;
+}
+
+static void _uri_query_parse_cb(void *context) {
+  UriQueryPairs *qp = uri_query_new();
+  uri_query_parse(qp, *(StringView *)context);
+  bench_sink += qp->size;
+  uri_query_free(qp);
+}
+
+typedef struct {
+  UriQueryPairs *qp;
+  StringView keys[BENCH_QUERY_PAIRS];
+} QueryGetCase;
+
+static void _uri_query_get_cb(void *context) {
+  QueryGetCase *c = context;
+  for (size_t i = 0; i < BENCH_QUERY_PAIRS; ++i) {
+    bench_sink += uri_query_get(c->qp, c->keys[i]).len;
+  }
+}
+
+void bench_uri() {
+  StringView uri = sv_new_from_cstr(bench_uri_input);
+  bench_run("uri_parse", uri.len, _uri_parse_cb, &uri);
+
+  StringBuffer *query = sb_new();
+  char pair[64];
+  for (size_t i = 0; i < BENCH_QUERY_PAIRS; ++i) {
+    int len = snprintf(pair, sizeof(pair), "%sparam_%zu=value_%zu",
+                       i > 0 ? "&" : "", i, i * 7919);
+    sb_append(query, sv_new(pair, (size_t)len));
+  }
+  StringView query_view = sv_new(query->data, query->len);
+  bench_run("uri_query_parse/32", query->len, _uri_query_parse_cb,
+            &query_view);
+
+  QueryGetCase get = {.qp = uri_query_new()};
+  uri_query_parse(get.qp, query_view);
+  StringBuffer *keys[BENCH_QUERY_PAIRS];
+  for (size_t i = 0; i < BENCH_QUERY_PAIRS; ++i) {
+    int len = snprintf(pair, sizeof(pair), "param_%zu", i);
+    keys[i] = sb_new_from_sv(sv_new(pair, (size_t)len));
+    get.keys[i] = sv_new(keys[i]->data, keys[i]->len);
+  }
+  bench_run("uri_query_get*32", 0, _uri_query_get_cb, &get);
+  for (size_t i = 0; i < BENCH_QUERY_PAIRS; ++i) {
+    sb_free(keys[i]);
+  }
+  uri_query_free(get.qp);
+  sb_free(query);
+}
@@ -3,8 +3,13 @@
 #ifndef _ALLOCATOR_H
 #define _ALLOCATOR_H
 
+// site is the "file:line" of the allocating call (MEM_SITE) or NULL,
+// allocators that do not attribute allocations ignore it. free gets the size
+// the block was allocated with, 0 when the caller does not know it. realloc is
+// optional, only the default allocator of mem.h needs it.
 typedef struct {
-  void *(*alloc)(size_t bytes, void *context);
+  void *(*alloc)(size_t bytes, const char *site, void *context);
+  void *(*realloc)(void *ptr, size_t bytes, const char *site, void *context);
   void *(*free)(size_t bytes, void *ptr, void *context);
   void *context;
 } Allocator;
@@ -0,0 +1,118 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "arena.h"
+#include "logger.h"
+#include "mem.h"
+
+static size_t arena_align(size_t n) {
+  return (n + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+static ArenaChunk *arena_chunk_new(size_t cap, ArenaChunk *next) {
+  ArenaChunk *chunk = mem_malloc(sizeof(ArenaChunk) + cap);
+  if (chunk == NULL) {
+    logger_log(LOG_FATAL, "arena_chunk_new malloc err");
+  }
+  *chunk = (ArenaChunk){
+      .next = next,
+      .cap = cap,
+      .len = 0,
+  };
+  return chunk;
+}
+
+Arena *arena_new(size_t chunk_size) {
+  Arena *arena = mem_malloc(sizeof(Arena));
+  if (arena == NULL) {
+    logger_log(LOG_FATAL, "arena_new malloc err");
+  }
+  *arena = (Arena){
+      .head = NULL,
+      .chunk_size = chunk_size == 0 ? ARENA_CHUNK_SIZE_INIT : chunk_size,
+      .allocated = 0,
+      .reserved = 0,
+  };
+  return arena;
+}
+
+void *arena_alloc(Arena *arena, size_t bytes) {
+  ArenaChunk *chunk = arena->head;
+  if (chunk != NULL) {
+    uintptr_t base = (uintptr_t)chunk->data;
+    size_t offset = arena_align(base + chunk->len) - base;
+    if (offset + bytes <= chunk->cap) {
+      chunk->len = offset + bytes;
+      arena->allocated += bytes;
+      return chunk->data + offset;
+    }
+  }
+
+  size_t cap = arena->chunk_size;
+  if (cap < bytes + ARENA_ALIGNMENT) {
+    cap = bytes + ARENA_ALIGNMENT;
+  }
+  if (arena->chunk_size < ARENA_CHUNK_SIZE_MAX) {
+    arena->chunk_size *= 2;
+  }
+
+  chunk = arena_chunk_new(cap, arena->head);
+  arena->head = chunk;
+  arena->reserved += sizeof(ArenaChunk) + cap;
+
+  uintptr_t base = (uintptr_t)chunk->data;
+  size_t offset = arena_align(base) - base;
+  chunk->len = offset + bytes;
+  arena->allocated += bytes;
+  return chunk->data + offset;
+}
+
+void arena_reset(Arena *arena) {
+  if (arena->head == NULL) {
+    return;
+  }
+  ArenaChunk *chunk = arena->head->next;
+  while (chunk != NULL) {
+    ArenaChunk *next = chunk->next;
+    mem_free(chunk);
+    chunk = next;
+  }
+  arena->head->next = NULL;
+  arena->head->len = 0;
+  arena->allocated = 0;
+  arena->reserved = sizeof(ArenaChunk) + arena->head->cap;
+}
+
+void arena_free(Arena *arena) {
+  if (arena == NULL) {
+    return;
+  }
+  ArenaChunk *chunk = arena->head;
+  while (chunk != NULL) {
+    ArenaChunk *next = chunk->next;
+    mem_free(chunk);
+    chunk = next;
+  }
+  mem_free(arena);
+}
+
+void *_arena_alloc_cb(size_t bytes, const char *site, void *context) {
+  (void)site;
+  return arena_alloc((Arena *)context, bytes);
+}
+
+void *_arena_free_cb(size_t bytes, void *ptr, void *context) {
+  (void)bytes;
+  (void)ptr;
+  (void)context;
+  return NULL;
+}
+
+Allocator arena_allocator(Arena *arena) {
+  return (Allocator){
+      .alloc = _arena_alloc_cb,
+      .realloc = NULL,
+      .free = _arena_free_cb,
+      .context = arena,
+  };
+}
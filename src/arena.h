@@ -0,0 +1,32 @@
+#include <stddef.h>
+
+#include "allocator.h"
+
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#define ARENA_CHUNK_SIZE_INIT (16 * 1024)
+#define ARENA_CHUNK_SIZE_MAX (4 * 1024 * 1024)
+#define ARENA_ALIGNMENT 16
+
+typedef struct ArenaChunk {
+  struct ArenaChunk *next;
+  size_t cap;
+  size_t len;
+  unsigned char data[];
+} ArenaChunk;
+
+typedef struct {
+  ArenaChunk *head;
+  size_t chunk_size;
+  size_t allocated;
+  size_t reserved;
+} Arena;
+
+Arena *arena_new(size_t chunk_size);
+void *arena_alloc(Arena *arena, size_t bytes);
+void arena_reset(Arena *arena);
+void arena_free(Arena *arena);
+Allocator arena_allocator(Arena *arena);
+
+#endif // _ARENA_H
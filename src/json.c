@@ -1,8 +1,18 @@
 #include <ctype.h>
+#include <inttypes.h>
+#include <limits.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "json.h"
+#include "json_escape.h"
 #include "logger.h"
+#include "mem.h"
+
+#ifdef __SSE2__
+#define JSON_OBJECT_SSE2
+#include <emmintrin.h>
+#endif
 
 // TODO
 // https://www.crockford.com/mckeeman.html
@@ -11,48 +21,132 @@
 // assert last char is valid
 // CD json_stringify
 
+// Allocations without an allocator are attributed to the calling site.
+#define json_alloc(allocator, bytes) json_alloc_at(allocator, bytes, MEM_SITE)
+
+static void *json_alloc_at(Allocator *allocator, size_t bytes,
+                           const char *site) {
+  void *ptr = allocator == NULL ? mem_malloc_at(bytes, site)
+                                : allocator->alloc(bytes, site,
+                                                   allocator->context);
+  if (ptr == NULL) {
+    logger_log(LOG_FATAL, "json_alloc mem alloc err");
+  }
+  return ptr;
+}
+
+static void json_dealloc(Allocator *allocator, void *ptr, size_t bytes) {
+  if (allocator == NULL) {
+    mem_free(ptr);
+  } else {
+    allocator->free(bytes, ptr, allocator->context);
+  }
+}
+
+// With an allocator the struct and its data share one block.
+StringBuffer *json_sb_new(Allocator *allocator, const char *data,
+                          size_t len) {
+  if (allocator == NULL) {
+    StringBuffer *sb = sb_new_with_custom_cap(len + 1);
+    memcpy((char *)sb->data, data, len);
+    sb->len = len;
+    ((char *)sb->data)[len] = '\0';
+    return sb;
+  }
+  StringBuffer *sb = json_alloc(allocator, sizeof(StringBuffer) + len + 1);
+  char *buf = (char *)(sb + 1);
+  memcpy(buf, data, len);
+  buf[len] = '\0';
+  *sb = (StringBuffer){
+      .data = buf,
+      .cap = len + 1,
+      .len = len,
+  };
+  return sb;
+}
+
+void json_sb_free(Allocator *allocator, StringBuffer *sb) {
+  if (sb == NULL) {
+    return;
+  }
+  if (allocator == NULL) {
+    sb_free(sb);
+  } else {
+    json_dealloc(allocator, sb, sizeof(StringBuffer) + sb->cap);
+  }
+}
+
 Lexer lexer_new(StringBuffer *input) {
   return (Lexer){
       .input = input,
+      .allocator = NULL,
+      .zero_copy = false,
+      .intern_keys = false,
+      .keys = NULL,
+      .cur = input->data,
+      .next = input->data,
+      .end = input->data + input->len,
       .ch = JSON_END_OF_INPUT,
-      .idx = 0,
-      .read_idx = 0,
-      .location =
-          (Location){
-              .line = 1,
-              .offset = 0,
-          },
   };
 }
 
 void lexer_advance(Lexer *lexer) {
-  if (lexer->read_idx >= lexer->input->len) {
+  lexer->cur = lexer->next;
+  if (lexer->next < lexer->end) {
+    lexer->ch = *lexer->next++;
+  } else {
     lexer->ch = JSON_END_OF_INPUT;
+  }
+}
+
+void lexer_seek(Lexer *lexer, const char *pos) {
+  if (pos < lexer->end) {
+    lexer->cur = pos;
+    lexer->next = pos + 1;
+    lexer->ch = *pos;
   } else {
-    if (lexer->ch == '\n') {
-      lexer->location.line++;
-      lexer->location.offset = 0;
-    } else {
-      lexer->location.offset++;
-    }
-    lexer->ch = lexer->input->data[lexer->read_idx];
+    lexer->cur = lexer->end;
+    lexer->next = lexer->end;
+    lexer->ch = JSON_END_OF_INPUT;
+  }
+}
+
+// Counts lines up to the cursor, only called when reporting an error.
+Location lexer_location(Lexer *lexer) {
+  const char *data = lexer->input->data;
+  const char *line_start = data;
+  Location location = {.line = 1};
+  for (const char *p = data;
+       (p = memchr(p, '\n', (size_t)(lexer->cur - p))) != NULL; ++p) {
+    location.line++;
+    line_start = p + 1;
   }
-  lexer->idx = lexer->read_idx;
-  lexer->read_idx++;
+  location.offset = (size_t)(lexer->cur - line_start) + 1;
+  return location;
+}
+
+static bool lexer_is_whitespace(char ch) {
+  return ch == ' ' || ch == '\r' || ch == '\t' || ch == '\n';
 }
 
 void lexer_skip_whitespace(Lexer *lexer) {
-  while (lexer->ch == ' ' || lexer->ch == '\r' || lexer->ch == '\t' ||
-         lexer->ch == '\n') {
-    lexer_advance(lexer);
+  if (!lexer_is_whitespace(lexer->ch)) {
+    return;
   }
+  const char *p = lexer->next;
+  const char *end = lexer->end;
+  while (p < end && lexer_is_whitespace(*p)) {
+    p++;
+  }
+  lexer_seek(lexer, p);
 }
 
 bool lexer_eat(Lexer *lexer, char ch) {
   if (lexer->ch != ch) {
+    Location location = lexer_location(lexer);
     logger_log(LOG_ERROR,
                "JSON_PARSE expected '%c' got '%c' at line %lu on offset %lu",
-               ch, lexer->ch, lexer->location.line, lexer->location.offset);
+               ch, lexer->ch, location.line, location.offset);
     return false;
   }
   lexer_advance(lexer);
@@ -60,69 +154,169 @@ bool lexer_eat(Lexer *lexer, char ch) {
 }
 
 StringBuffer *lexer_read_integer(Lexer *lexer) {
-  size_t start = lexer->idx;
+  size_t start = (size_t)(lexer->cur - lexer->input->data);
   while (isdigit(lexer->ch)) {
     lexer_advance(lexer);
   }
-  size_t end = lexer->idx;
+  size_t end = (size_t)(lexer->cur - lexer->input->data);
   return sb_sub(lexer->input, start, end - 1);
 }
 
 bool is_alpha_lowercase(char ch) { return ch >= 'a' && ch <= 'z'; }
 
 StringBuffer *lexer_read_ident(Lexer *lexer) {
-  size_t start = lexer->idx;
-  while (is_alpha_lowercase(lexer->ch)) {
-    lexer_advance(lexer);
-  }
-  size_t end = lexer->idx;
-  return sb_sub(lexer->input, start, end - 1);
+  StringView ident = lexer_scan_ident(lexer);
+  size_t start = (size_t)(ident.data - lexer->input->data);
+  return sb_sub(lexer->input, start, start + ident.len - 1);
 }
 
-bool is_letter(char ch) {
-  return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_';
+StringBuffer *lexer_read_name(Lexer *lexer) {
+  return lexer_read_string(lexer);
 }
 
-StringBuffer *lexer_read_name(Lexer *lexer) {
+bool lexer_scan_string(Lexer *lexer, StringView *dest, bool *has_escape) {
   if (!lexer_eat(lexer, '"')) {
-    return NULL;
+    return false;
   }
-  size_t start = lexer->idx;
-  while (is_letter(lexer->ch)) {
-    lexer_advance(lexer);
+  const char *start = lexer->cur;
+  const char *end = lexer->end;
+  const char *p = start;
+  *has_escape = false;
+  while (p < end) {
+    p += json_escape_scan(p, (size_t)(end - p));
+    if (p == end || *p == '"') {
+      break;
+    }
+    if (*p != '\\') {
+      lexer_seek(lexer, p);
+      Location location = lexer_location(lexer);
+      logger_log(LOG_ERROR,
+                 "JSON_PARSE unescaped control ch 0x%02x in string at line %lu "
+                 "on offset %lu",
+                 (unsigned char)*p, location.line, location.offset);
+      return false;
+    }
+    *has_escape = true;
+    p = end - p > 2 ? p + 2 : end;
   }
-  size_t end = lexer->idx;
+  lexer_seek(lexer, p);
   if (!lexer_eat(lexer, '"')) {
-    return NULL;
+    return false;
   }
-  return sb_sub(lexer->input, start, end - 1);
+  *dest = sv_new(start, (size_t)(p - start));
+  return true;
 }
 
+// Parses the number in place and moves the lexer past it.
+bool lexer_read_number(Lexer *lexer, JsonNumber *dest) {
+  size_t consumed;
+  if (!json_number_parse(lexer->cur, (size_t)(lexer->end - lexer->cur), dest,
+                         &consumed)) {
+    Location location = lexer_location(lexer);
+    logger_log(LOG_ERROR, "JSON_PARSE invalid number at line %lu on offset %lu",
+               location.line, location.offset);
+    return false;
+  }
+  lexer_seek(lexer, lexer->cur + consumed);
+  return true;
+}
+
+StringView lexer_scan_ident(Lexer *lexer) {
+  const char *start = lexer->cur;
+  const char *p = start;
+  while (p < lexer->end && is_alpha_lowercase(*p)) {
+    p++;
+  }
+  lexer_seek(lexer, p);
+  return sv_new(start, (size_t)(p - start));
+}
+
+static StringBuffer *json_sb_borrow(Allocator *allocator, const char *data,
+                                    size_t len) {
+  StringBuffer *view = json_alloc(allocator, sizeof(StringBuffer));
+  *view = (StringBuffer){
+      .data = data,
+      .cap = 0,
+      .len = len,
+  };
+  return view;
+}
+
+// Zero copy strings borrow the input (cap 0), only strings with escapes are
+// copied so they can be decoded.
 StringBuffer *lexer_read_string(Lexer *lexer) {
-  if (!lexer_eat(lexer, '"')) {
+  StringView raw;
+  bool has_escape;
+  if (!lexer_scan_string(lexer, &raw, &has_escape)) {
     return NULL;
   }
-  size_t start = lexer->idx;
-  while (lexer->ch != '"' && lexer->ch != JSON_END_OF_INPUT) {
-    lexer_advance(lexer);
+
+  const char *data = raw.data;
+  size_t len = raw.len;
+
+  if (!has_escape && lexer->zero_copy) {
+    return json_sb_borrow(lexer->allocator, data, len);
   }
-  size_t end = lexer->idx;
-  if (!lexer_eat(lexer, '"')) {
-    return NULL;
+
+  StringBuffer *string = json_sb_new(lexer->allocator, data, len);
+  if (has_escape) {
+    ssize_t decoded_len =
+        json_unescape(string->data, string->len, (char *)string->data);
+    if (decoded_len < 0) {
+      Location location = lexer_location(lexer);
+      logger_log(LOG_ERROR,
+                 "JSON_PARSE invalid escape in string at line %lu on offset "
+                 "%lu",
+                 location.line, location.offset);
+      json_sb_free(lexer->allocator, string);
+      return NULL;
+    }
+    string->len = (size_t)decoded_len;
+    ((char *)string->data)[string->len] = '\0';
   }
-  return sb_sub(lexer->input, start, end - 1);
+  return string;
 }
 
-Json *json_new() {
-  Json *json = malloc(sizeof(Json));
-  if (json == NULL) {
-    logger_log(LOG_FATAL, "json_new malloc err");
+// Keys without escapes are looked up straight from the input.
+static bool lexer_intern_name(Lexer *lexer, JsonKey *dest) {
+  StringView raw;
+  bool has_escape;
+  if (!lexer_scan_string(lexer, &raw, &has_escape)) {
+    return false;
+  }
+  if (!has_escape) {
+    *dest = json_keys_intern(lexer->keys, raw, lexer->zero_copy);
+    return true;
   }
+  StringBuffer *decoded = sb_new_with_custom_cap(raw.len + 1);
+  ssize_t len = json_unescape(raw.data, raw.len, (char *)decoded->data);
+  if (len < 0) {
+    Location location = lexer_location(lexer);
+    logger_log(LOG_ERROR,
+               "JSON_PARSE invalid escape in string at line %lu on offset %lu",
+               location.line, location.offset);
+    sb_free(decoded);
+    return false;
+  }
+  *dest = json_keys_intern(lexer->keys, sv_new(decoded->data, (size_t)len),
+                           false);
+  sb_free(decoded);
+  return true;
+}
+
+Json *json_new() { return json_new_with_allocator(NULL); }
+
+Json *json_new_with_allocator(Allocator *allocator) {
+  Json *json = json_alloc(allocator, sizeof(Json));
   json->type = JSON_EMPTY;
   return json;
 }
 
-void json_free(Json *json) {
+void json_free(Json *json) { json_free_with_allocator(json, NULL); }
+
+// Arena backed documents are released with the arena, walking them is only
+// needed for allocators with a real free.
+void json_free_with_allocator(Json *json, Allocator *allocator) {
   if (json == NULL) {
     return;
   }
@@ -134,9 +328,10 @@ void json_free(Json *json) {
     json_object_free(json->object);
     break;
   case JSON_STRING:
-    sb_free(json->string);
+    json_sb_free(allocator, json->string);
     break;
   case JSON_INT:
+  case JSON_UINT:
   case JSON_DOUBLE:
   case JSON_TRUE:
   case JSON_FALSE:
@@ -146,14 +341,48 @@ void json_free(Json *json) {
   default:
     logger_log(LOG_FATAL, "json_free invalid json type");
   }
-  free(json);
+  json_dealloc(allocator, json, sizeof(Json));
 }
 
 bool json_parse(StringBuffer *input, Json *dest) {
+  return json_parse_with_allocator(input, dest, NULL);
+}
+
+bool json_parse_with_allocator(StringBuffer *input, Json *dest,
+                               Allocator *allocator) {
+  JsonParseOptions options = {
+      .allocator = allocator,
+      .zero_copy = false,
+      .intern_keys = true,
+  };
+  return json_parse_with_options(input, dest, &options);
+}
+
+bool json_parse_with_options(StringBuffer *input, Json *dest,
+                             JsonParseOptions *options) {
   Lexer lexer = lexer_new(input);
+  lexer.allocator = options->allocator;
+  lexer.zero_copy = options->zero_copy;
+  lexer.intern_keys = options->intern_keys;
+  if (options->keys != NULL) {
+    lexer.keys = options->keys;
+    json_keys_retain(lexer.keys);
+  }
   lexer_advance(&lexer);
 
   bool is_success = json_parse_value(&lexer, dest);
+  if (is_success) {
+    lexer_skip_whitespace(&lexer);
+    if (lexer.cur != lexer.end) {
+      Location location = lexer_location(&lexer);
+      logger_log(LOG_ERROR,
+                 "JSON_PARSE unexpected trailing ch '%c' at line %lu on "
+                 "offset %lu",
+                 lexer.ch, location.line, location.offset);
+      is_success = false;
+    }
+  }
+  json_keys_release(lexer.keys);
 
   return is_success;
 }
@@ -169,56 +398,45 @@ bool json_parse_value(Lexer *lexer, Json *dest) {
     return json_parse_object(lexer, dest);
   default: {
     if (isdigit(lexer->ch) || lexer->ch == '-') {
-      size_t start = lexer->idx;
-      lexer_advance(lexer);
-      while (isdigit(lexer->ch)) {
-        lexer_advance(lexer);
+      JsonNumber number;
+      if (!lexer_read_number(lexer, &number)) {
+        return false;
       }
-      if (lexer->ch == '.') {
-        if (!lexer_eat(lexer, '.')) {
-          return false;
-        }
-        while (isdigit(lexer->ch)) {
-          lexer_advance(lexer);
-        }
-        dest->type = JSON_DOUBLE;
-        StringBuffer *double_str = sb_sub(lexer->input, start, lexer->idx);
-        dest->num_double = atof(double_str->data);
-        sb_free(double_str);
-      } else {
+      if (number.type == JSON_NUMBER_INT) {
         dest->type = JSON_INT;
-        StringBuffer *int_str = sb_sub(lexer->input, start, lexer->idx);
-        dest->num_integer = atoi(int_str->data);
-        sb_free(int_str);
+        dest->num_integer = number.integer;
+      } else if (number.type == JSON_NUMBER_UINT) {
+        dest->type = JSON_UINT;
+        dest->num_unsigned = number.unsigned_integer;
+      } else {
+        dest->type = JSON_DOUBLE;
+        dest->num_double = number.floating;
       }
       return true;
     } else if (is_alpha_lowercase(lexer->ch)) {
-      StringBuffer *ident = lexer_read_ident(lexer);
-      if (sb_compare_sv(ident, sv_new("null", 4))) {
+      StringView ident = lexer_scan_ident(lexer);
+      if (sv_compare(ident, sv_new("null", 4))) {
         dest->type = JSON_NULL;
-        sb_free(ident);
         return true;
-      } else if (sb_compare_sv(ident, sv_new("true", 4))) {
+      } else if (sv_compare(ident, sv_new("true", 4))) {
         dest->type = JSON_TRUE;
-        sb_free(ident);
         return true;
-      } else if (sb_compare_sv(ident, sv_new("false", 5))) {
+      } else if (sv_compare(ident, sv_new("false", 5))) {
         dest->type = JSON_FALSE;
-        sb_free(ident);
         return true;
       } else {
-        sb_free(ident);
+        Location location = lexer_location(lexer);
         logger_log(
             LOG_ERROR,
             "JSON_PARSE invalid keyword '%.*s' at line %lu on offset %lu",
-            ident->len, ident->data, lexer->location.line,
-            lexer->location.offset);
+            (int)ident.len, ident.data, location.line, location.offset);
         return false;
       }
     }
+    Location location = lexer_location(lexer);
     logger_log(LOG_ERROR,
                "JSON_PARSE unexpected ch '%c' at line %lu on offset %lu",
-               lexer->ch, lexer->location.line, lexer->location.offset);
+               lexer->ch, location.line, location.offset);
     return false;
   }
   }
@@ -242,7 +460,7 @@ bool json_parse_array(Lexer *lexer, Json *dest) {
     return false;
   }
 
-  JsonArray *array = json_array_new();
+  JsonArray *array = json_array_new_with_allocator(lexer->allocator);
   dest->type = JSON_ARRAY;
   dest->array = array;
 
@@ -256,9 +474,9 @@ bool json_parse_array(Lexer *lexer, Json *dest) {
   while (true) {
     lexer_skip_whitespace(lexer);
 
-    Json *append = json_new();
+    Json *append = json_new_with_allocator(lexer->allocator);
     if (!json_parse_value(lexer, append)) {
-      json_free(append);
+      json_free_with_allocator(append, lexer->allocator);
       return false;
     }
 
@@ -272,7 +490,6 @@ bool json_parse_array(Lexer *lexer, Json *dest) {
       lexer_advance(lexer);
       return true;
     } else {
-      json_array_free(array);
       return false;
     }
   }
@@ -283,19 +500,30 @@ bool json_parse_array(Lexer *lexer, Json *dest) {
 void json_array_free(JsonArray *a) {
   if (a != NULL && a->items != NULL) {
     for (size_t i = 0; i < a->len; ++i) {
-      json_free(a->items[i]);
+      json_free_with_allocator(a->items[i], a->allocator);
     }
-    free(a->items);
-    free(a);
+    json_dealloc(a->allocator, a->items, a->cap * sizeof(Json *));
+    json_dealloc(a->allocator, a, sizeof(JsonArray));
   }
 }
 
+static void json_object_free_key(JsonObject *o, StringBuffer *key);
+static void json_object_put(JsonObject *o, StringBuffer *key, size_t hash,
+                            Json *value);
+
 bool json_parse_object(Lexer *lexer, Json *dest) {
   if (!lexer_eat(lexer, '{')) {
     return false;
   }
 
-  JsonObject *object = json_object_new(JSON_OBJECT_SIZE_INIT);
+  if (lexer->keys == NULL && lexer->intern_keys) {
+    lexer->keys = json_keys_new(lexer->allocator);
+  }
+  JsonObject *object =
+      lexer->keys != NULL
+          ? json_object_new_with_keys(lexer->keys, lexer->allocator)
+          : json_object_new_with_allocator(JSON_OBJECT_SIZE_INIT,
+                                           lexer->allocator);
   *dest = (Json){
       .type = JSON_OBJECT,
       .object = object,
@@ -308,23 +536,27 @@ bool json_parse_object(Lexer *lexer, Json *dest) {
   }
 
   while (true) {
-    StringBuffer *name = lexer_read_name(lexer);
-    if (name == NULL) {
+    JsonKey name = {0};
+    if (lexer->keys != NULL) {
+      if (!lexer_intern_name(lexer, &name)) {
+        return false;
+      }
+    } else if ((name.key = lexer_read_name(lexer)) == NULL) {
       return false;
     }
     lexer_skip_whitespace(lexer);
     if (!lexer_eat(lexer, ':')) {
-      sb_free(name);
+      json_object_free_key(object, name.key);
       return false;
     }
-    Json *value = json_new();
-    if (value == NULL || !json_parse_value(lexer, value)) {
-      sb_free(name);
-      json_free(value);
+    Json *value = json_new_with_allocator(lexer->allocator);
+    if (!json_parse_value(lexer, value)) {
+      json_object_free_key(object, name.key);
+      json_free_with_allocator(value, lexer->allocator);
       return false;
     }
 
-    json_object_set(object, name, value);
+    json_object_put(object, name.key, name.hash, value);
 
     lexer_skip_whitespace(lexer);
     if (lexer->ch != ',') {
@@ -341,19 +573,16 @@ bool json_parse_object(Lexer *lexer, Json *dest) {
   return true;
 }
 
-JsonArray *json_array_new() {
-  JsonArray *a = malloc(sizeof(JsonArray));
-  if (a == NULL) {
-    logger_log(LOG_FATAL, "json_array_new mem alloc err");
-  }
+JsonArray *json_array_new() { return json_array_new_with_allocator(NULL); }
+
+JsonArray *json_array_new_with_allocator(Allocator *allocator) {
+  JsonArray *a = json_alloc(allocator, sizeof(JsonArray));
   *a = (JsonArray){
       .len = 0,
       .cap = JSON_ARRAY_CAP_INIT,
-      .items = malloc(sizeof(Json *) * JSON_ARRAY_CAP_INIT),
+      .items = json_alloc(allocator, sizeof(Json *) * JSON_ARRAY_CAP_INIT),
+      .allocator = allocator,
   };
-  if (a->items == NULL) {
-    logger_log(LOG_FATAL, "json_array_new->items mem alloc err");
-  }
   return a;
 }
 
@@ -366,97 +595,438 @@ void json_array_append(JsonArray *a, Json *item) {
 }
 
 void json_array_resize(JsonArray *a, size_t new_cap) {
-  a->items = realloc(a->items, new_cap * sizeof(Json *));
-  if (a->items == NULL) {
-    logger_log(LOG_FATAL, "json_array_resize->items mem realloc err");
+  if (a->allocator == NULL) {
+    a->items = mem_realloc(a->items, new_cap * sizeof(Json *));
+    if (a->items == NULL) {
+      logger_log(LOG_FATAL, "json_array_resize->items mem realloc err");
+    }
+  } else {
+    Json **items = json_alloc(a->allocator, new_cap * sizeof(Json *));
+    memcpy(items, a->items,
+           (a->len < new_cap ? a->len : new_cap) * sizeof(Json *));
+    json_dealloc(a->allocator, a->items, a->cap * sizeof(Json *));
+    a->items = items;
   }
   a->cap = new_cap;
 }
 
-JsonObject *json_object_new(size_t size) {
-  JsonObject *o = malloc(sizeof(JsonObject));
-  if (o == NULL) {
-    logger_log(LOG_FATAL, "json_object_new mem alloc err");
+static uint32_t json_object_group_match(const uint8_t *group, uint8_t byte) {
+#ifdef JSON_OBJECT_SSE2
+  __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+  return (uint32_t)_mm_movemask_epi8(
+      _mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)byte)));
+#else
+  uint32_t mask = 0;
+  for (size_t i = 0; i < JSON_OBJECT_GROUP_SIZE; ++i) {
+    mask |= (uint32_t)(group[i] == byte) << i;
+  }
+  return mask;
+#endif
+}
+
+static size_t json_object_table_bytes(size_t cap) {
+  return cap * sizeof(JsonObjectEntry) + cap + JSON_OBJECT_GROUP_SIZE - 1;
+}
+
+// Entries and ctrl bytes share one block.
+static void json_object_alloc_table(JsonObject *o, size_t cap) {
+  unsigned char *block = json_alloc(o->allocator, json_object_table_bytes(cap));
+  o->entries = (JsonObjectEntry *)block;
+  o->ctrl = block + cap * sizeof(JsonObjectEntry);
+  o->cap = cap;
+  memset(o->ctrl, JSON_OBJECT_CTRL_EMPTY, cap + JSON_OBJECT_GROUP_SIZE - 1);
+}
+
+static void json_object_set_ctrl(JsonObject *o, size_t idx, uint8_t byte) {
+  o->ctrl[idx] = byte;
+  if (idx < JSON_OBJECT_GROUP_SIZE - 1) {
+    o->ctrl[o->cap + idx] = byte;
+  }
+}
+
+// Interned keys are unique, so a different pointer is a different key.
+static bool json_object_key_equal(JsonObject *o, StringBuffer *entry_key,
+                                  StringView key) {
+  if (entry_key->data == key.data) {
+    return entry_key->len == key.len;
+  }
+  return o->keys == NULL && sb_compare_sv(entry_key, key);
+}
+
+// Groups are probed triangularly, which visits every group of a power of
+// two table. Without deletions the first empty slot ends the search.
+static size_t json_object_probe(JsonObject *o, StringView key, size_t hash,
+                                bool *found) {
+  size_t mask = o->cap - 1;
+  uint8_t h2 = (uint8_t)(hash & 0x7F);
+  size_t pos = (hash >> 7) & mask;
+  for (size_t stride = JSON_OBJECT_GROUP_SIZE;;
+       stride += JSON_OBJECT_GROUP_SIZE) {
+    const uint8_t *group = o->ctrl + pos;
+    if (found != NULL) {
+      uint32_t match = json_object_group_match(group, h2);
+      while (match) {
+        size_t idx = (pos + (size_t)__builtin_ctz(match)) & mask;
+        JsonObjectEntry *entry = &o->entries[idx];
+        if (entry->hash == hash && json_object_key_equal(o, entry->key, key)) {
+          *found = true;
+          return idx;
+        }
+        match &= match - 1;
+      }
+    }
+    uint32_t empty = json_object_group_match(group, JSON_OBJECT_CTRL_EMPTY);
+    if (empty) {
+      if (found != NULL) {
+        *found = false;
+      }
+      return (pos + (size_t)__builtin_ctz(empty)) & mask;
+    }
+    pos = (pos + stride) & mask;
+  }
+}
+
+// Rehashing uses the stored hashes, keys are not compared again.
+static void json_object_grow(JsonObject *o) {
+  uint8_t *old_ctrl = o->ctrl;
+  JsonObjectEntry *old_entries = o->entries;
+  size_t old_cap = o->cap;
+  json_object_alloc_table(o, old_cap * 2);
+  for (size_t i = 0; i < old_cap; ++i) {
+    if (old_ctrl[i] & JSON_OBJECT_CTRL_EMPTY) {
+      continue;
+    }
+    JsonObjectEntry *entry = &old_entries[i];
+    size_t idx = json_object_probe(o, sv_new(NULL, 0), entry->hash, NULL);
+    json_object_set_ctrl(o, idx, old_ctrl[i]);
+    o->entries[idx] = *entry;
   }
+  json_dealloc(o->allocator, old_entries, json_object_table_bytes(old_cap));
+}
+
+JsonObject *json_object_new(size_t size) {
+  return json_object_new_with_allocator(size, NULL);
+}
+
+JsonObject *json_object_new_with_allocator(size_t size, Allocator *allocator) {
+  JsonObject *o = json_alloc(allocator, sizeof(JsonObject));
   *o = (JsonObject){
-      .size = size,
-      .buckets = calloc(size, sizeof(JsonObjectPair *)),
+      .ctrl = NULL,
+      .entries = NULL,
+      .cap = 0,
+      .len = 0,
+      .allocator = allocator,
+      .keys = NULL,
   };
-  if (o->buckets == NULL) {
-    logger_log(LOG_FATAL, "json_object_new->buckets mem alloc err");
+  if (size > JSON_OBJECT_SMALL_MAX) {
+    size_t cap = JSON_OBJECT_GROUP_SIZE;
+    while (cap < size) {
+      cap *= 2;
+    }
+    json_object_alloc_table(o, cap);
   }
   return o;
 }
 
-void json_object_set(JsonObject *o, StringBuffer *key, Json *value) {
-  size_t hash = json_object_hash(sv_new(key->data, key->len));
-  size_t idx = hash % o->size;
+JsonObject *json_object_new_with_keys(JsonKeys *keys, Allocator *allocator) {
+  JsonObject *o =
+      json_object_new_with_allocator(JSON_OBJECT_SIZE_INIT, allocator);
+  json_keys_retain(keys);
+  o->keys = keys;
+  return o;
+}
+
+static bool json_object_is_small(JsonObject *o) { return o->ctrl == NULL; }
+
+static size_t json_object_bytes(JsonObject *o) {
+  return json_object_is_small(o) ? o->cap * sizeof(JsonObjectEntry)
+                                 : json_object_table_bytes(o->cap);
+}
+
+// Entries of a small object are full up to len, table slots are full when
+// their ctrl byte is not empty.
+static size_t json_object_slots(JsonObject *o) {
+  return json_object_is_small(o) ? o->len : o->cap;
+}
+
+static bool json_object_slot_full(JsonObject *o, size_t i) {
+  return json_object_is_small(o) || !(o->ctrl[i] & JSON_OBJECT_CTRL_EMPTY);
+}
+
+static JsonObjectEntry *json_object_small_find(JsonObject *o, StringView key) {
+  for (size_t i = 0; i < o->len; ++i) {
+    if (json_object_key_equal(o, o->entries[i].key, key)) {
+      return &o->entries[i];
+    }
+  }
+  return NULL;
+}
+
+// Small objects only hash their keys when they outgrow the inline array,
+// interned keys already carry their hash.
+static void json_object_upgrade(JsonObject *o) {
+  JsonObjectEntry *small = o->entries;
+  size_t small_bytes = json_object_bytes(o);
+  json_object_alloc_table(o, JSON_OBJECT_GROUP_SIZE);
+  for (size_t i = 0; i < o->len; ++i) {
+    JsonObjectEntry entry = small[i];
+    if (o->keys == NULL) {
+      entry.hash = json_object_hash(sv_new(entry.key->data, entry.key->len));
+    }
+    size_t idx = json_object_probe(o, sv_new(NULL, 0), entry.hash, NULL);
+    json_object_set_ctrl(o, idx, (uint8_t)(entry.hash & 0x7F));
+    o->entries[idx] = entry;
+  }
+  json_dealloc(o->allocator, small, small_bytes);
+}
+
+static void json_object_free_key(JsonObject *o, StringBuffer *key) {
+  if (o->keys == NULL) {
+    json_sb_free(o->allocator, key);
+  }
+}
+
+static void json_object_small_set(JsonObject *o, StringBuffer *key,
+                                  size_t hash, Json *value) {
+  StringView key_view = sv_new(key->data, key->len);
+  JsonObjectEntry *entry = json_object_small_find(o, key_view);
+  if (entry == NULL) {
+    if (o->len == o->cap) {
+      size_t new_cap = o->cap == 0 ? 2 : o->cap * 2;
+      JsonObjectEntry *entries =
+          json_alloc(o->allocator, new_cap * sizeof(JsonObjectEntry));
+      if (o->entries != NULL) {
+        memcpy(entries, o->entries, o->len * sizeof(JsonObjectEntry));
+        json_dealloc(o->allocator, o->entries, json_object_bytes(o));
+      }
+      o->entries = entries;
+      o->cap = new_cap;
+    }
+    entry = &o->entries[o->len++];
+  } else {
+    json_object_free_key(o, entry->key);
+    json_free_with_allocator(entry->value, o->allocator);
+  }
+  *entry = (JsonObjectEntry){
+      .key = key,
+      .value = value,
+      .hash = hash,
+  };
+}
 
-  JsonObjectPair *new_pair = malloc(sizeof(JsonObjectPair));
-  if (new_pair == NULL) {
-    logger_log(LOG_FATAL, "json_object_set mem alloc err");
+// hash is only read for interned keys, other keys are hashed once the
+// object is a table.
+static void json_object_put(JsonObject *o, StringBuffer *key, size_t hash,
+                            Json *value) {
+  StringView key_view = sv_new(key->data, key->len);
+  if (json_object_is_small(o)) {
+    if (o->len < JSON_OBJECT_SMALL_MAX ||
+        json_object_small_find(o, key_view) != NULL) {
+      json_object_small_set(o, key, hash, value);
+      return;
+    }
+    json_object_upgrade(o);
+  }
+  if ((o->len + 1) * 8 > o->cap * 7) {
+    json_object_grow(o);
+  }
+  if (o->keys == NULL) {
+    hash = json_object_hash(key_view);
+  }
+  bool found;
+  size_t idx = json_object_probe(o, key_view, hash, &found);
+  JsonObjectEntry *entry = &o->entries[idx];
+  if (found) {
+    json_object_free_key(o, entry->key);
+    json_free_with_allocator(entry->value, o->allocator);
+  } else {
+    json_object_set_ctrl(o, idx, (uint8_t)(hash & 0x7F));
+    o->len++;
   }
-  *new_pair = (JsonObjectPair){
-      .next = o->buckets[idx],
+  *entry = (JsonObjectEntry){
       .key = key,
       .value = value,
+      .hash = hash,
   };
-  o->buckets[idx] = new_pair;
 }
 
+// Setting an existing key replaces and frees the previous key and value.
+// The key is copied with the object's allocator, or interned when the object
+// has a key table, so the caller keeps its own buffer.
+void json_object_set(JsonObject *o, StringView key, Json *value) {
+  if (o->keys == NULL) {
+    json_object_put(o, json_sb_new(o->allocator, key.data, key.len), 0,
+                    value);
+    return;
+  }
+  JsonKey interned = json_keys_intern(o->keys, key, false);
+  json_object_put(o, interned.key, interned.hash, value);
+}
+
+// Small objects are scanned by content, that is cheaper than hashing even
+// when their keys are interned.
 Json *json_object_get(JsonObject *o, StringView key) {
-  size_t hash = json_object_hash(key);
-  size_t idx = hash % o->size;
+  return json_object_get_hashed(
+      o, key, json_object_is_small(o) ? 0 : json_object_hash(key));
+}
 
-  JsonObjectPair *curr = o->buckets[idx];
-  while (curr) {
-    if (sb_compare_sv(curr->key, key)) {
-      return curr->value;
+static bool json_keys_find_hashed(JsonKeys *keys, StringView key,
+                                  size_t hash, JsonKey *dest) {
+  bool found;
+  size_t idx = json_object_probe(keys->table, key, hash, &found);
+  if (!found) {
+    return false;
+  }
+  *dest = (JsonKey){.key = keys->table->entries[idx].key, .hash = hash};
+  return true;
+}
+
+// hash is json_object_hash(key), callers looking up the same key many times
+// compute it once. A key missing from the key table is in none of its
+// objects.
+Json *json_object_get_hashed(JsonObject *o, StringView key, size_t hash) {
+  if (json_object_is_small(o)) {
+    for (size_t i = 0; i < o->len; ++i) {
+      if (sb_compare_sv(o->entries[i].key, key)) {
+        return o->entries[i].value;
+      }
     }
-    curr = curr->next;
+    return NULL;
   }
-  return NULL;
+  if (o->keys != NULL) {
+    JsonKey interned;
+    return json_keys_find_hashed(o->keys, key, hash, &interned)
+               ? json_object_get_key(o, interned)
+               : NULL;
+  }
+  bool found;
+  size_t idx = json_object_probe(o, key, hash, &found);
+  return found ? o->entries[idx].value : NULL;
+}
+
+// Skips hashing, with interned keys the lookup only compares pointers. The
+// key has to come from the object's key table, if it has one.
+Json *json_object_get_key(JsonObject *o, JsonKey key) {
+  StringView key_view = sv_new(key.key->data, key.key->len);
+  if (json_object_is_small(o)) {
+    JsonObjectEntry *entry = json_object_small_find(o, key_view);
+    return entry != NULL ? entry->value : NULL;
+  }
+  bool found;
+  size_t idx = json_object_probe(o, key_view, key.hash, &found);
+  return found ? o->entries[idx].value : NULL;
 }
 
+// Multiplicative mixing of 8 byte words with a murmur style finalizer, the
+// table takes its low 7 bits for ctrl and the rest for the position.
 size_t json_object_hash(StringView key) {
-  size_t h = 0;
-  for (size_t i = 0; i < key.len; ++i) {
-    h = 31 * h + key.data[i];
+  const uint64_t m = 0xff51afd7ed558ccdULL;
+  uint64_t h = 0x9e3779b97f4a7c15ULL ^ key.len;
+  const char *p = key.data;
+  size_t n = key.len;
+  for (; n >= 8; n -= 8, p += 8) {
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    h = (h ^ w) * m;
+    h ^= h >> 32;
   }
-  return h;
+  uint64_t tail = 0;
+  memcpy(&tail, p, n);
+  h = (h ^ tail) * m;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return (size_t)h;
 }
 
 void json_object_foreach(JsonObject *o,
                          void (*callback)(StringBuffer *key, Json *value)) {
-  for (size_t i = 0; i < o->size; ++i) {
-    JsonObjectPair *pair = o->buckets[i];
-    while (pair) {
-      callback(pair->key, pair->value);
-      pair = pair->next;
+  for (size_t i = 0; i < json_object_slots(o); ++i) {
+    if (json_object_slot_full(o, i)) {
+      callback(o->entries[i].key, o->entries[i].value);
+    }
+  }
+}
+
+// Iteration cursor for callers that need their own state, i starts at 0.
+bool json_object_next(JsonObject *o, size_t *i, JsonObjectEntry **dest) {
+  for (; *i < json_object_slots(o); ++*i) {
+    if (json_object_slot_full(o, *i)) {
+      *dest = &o->entries[(*i)++];
+      return true;
     }
   }
+  return false;
 }
 
 void json_object_free(JsonObject *o) {
   if (o == NULL) {
     return;
   }
-  for (size_t i = 0; i < o->size; ++i) {
-    JsonObjectPair *curr = o->buckets[i];
-    while (curr != NULL) {
-      JsonObjectPair *next = curr->next;
-      sb_free(curr->key);
-      json_free(curr->value);
-      free(curr);
-      curr = next;
+  for (size_t i = 0; i < json_object_slots(o); ++i) {
+    if (json_object_slot_full(o, i)) {
+      json_object_free_key(o, o->entries[i].key);
+      json_free_with_allocator(o->entries[i].value, o->allocator);
     }
   }
-  free(o->buckets);
-  free(o);
+  if (o->entries != NULL) {
+    json_dealloc(o->allocator, o->entries, json_object_bytes(o));
+  }
+  json_keys_release(o->keys);
+  json_dealloc(o->allocator, o, sizeof(JsonObject));
+}
+
+// The table is an object in table mode whose entries have no values.
+JsonKeys *json_keys_new(Allocator *allocator) {
+  JsonKeys *keys = json_alloc(allocator, sizeof(JsonKeys));
+  *keys = (JsonKeys){
+      .table = json_object_new_with_allocator(JSON_OBJECT_SMALL_MAX + 1,
+                                              allocator),
+  };
+  atomic_init(&keys->refs, 1);
+  return keys;
+}
+
+// Borrowed keys point into the input, which has to outlive the table.
+JsonKey json_keys_intern(JsonKeys *keys, StringView key, bool borrow) {
+  JsonObject *table = keys->table;
+  size_t hash = json_object_hash(key);
+  bool found;
+  size_t idx = json_object_probe(table, key, hash, &found);
+  if (!found) {
+    if ((table->len + 1) * 8 > table->cap * 7) {
+      json_object_grow(table);
+      idx = json_object_probe(table, key, hash, NULL);
+    }
+    json_object_set_ctrl(table, idx, (uint8_t)(hash & 0x7F));
+    table->entries[idx] = (JsonObjectEntry){
+        .key = borrow ? json_sb_borrow(table->allocator, key.data, key.len)
+                      : json_sb_new(table->allocator, key.data, key.len),
+        .value = NULL,
+        .hash = hash,
+    };
+    table->len++;
+  }
+  return (JsonKey){.key = table->entries[idx].key, .hash = hash};
+}
+
+bool json_keys_find(JsonKeys *keys, StringView key, JsonKey *dest) {
+  return json_keys_find_hashed(keys, key, json_object_hash(key), dest);
+}
+
+void json_keys_retain(JsonKeys *keys) { atomic_fetch_add(&keys->refs, 1); }
+
+void json_keys_release(JsonKeys *keys) {
+  if (keys == NULL || atomic_fetch_sub(&keys->refs, 1) > 1) {
+    return;
+  }
+  Allocator *allocator = keys->table->allocator;
+  json_object_free(keys->table);
+  json_dealloc(allocator, keys, sizeof(JsonKeys));
 }
 
 void _json_obj_print_cb(StringBuffer *key, Json *value) {
-  printf("\"%s\":", key->data);
+  printf("\"" SB_FMT "\":", (int)key->len, key->data);
   json_print(value);
   printf(",");
 }
@@ -464,7 +1034,7 @@ void _json_obj_print_cb(StringBuffer *key, Json *value) {
 void json_print(Json *json) {
   switch (json->type) {
   case JSON_STRING:
-    printf("\"%s\"", json->string->data);
+    printf("\"" SB_FMT "\"", (int)json->string->len, json->string->data);
     break;
   case JSON_ARRAY:
     printf("[");
@@ -481,7 +1051,10 @@ void json_print(Json *json) {
     printf("}");
     break;
   case JSON_INT:
-    printf("%d", json->num_integer);
+    printf("%" PRId64, json->num_integer);
+    break;
+  case JSON_UINT:
+    printf("%" PRIu64, json->num_unsigned);
     break;
   case JSON_DOUBLE:
     printf("%f", json->num_double);
@@ -503,6 +1076,16 @@ void json_print(Json *json) {
 }
 
 bool json_object_get_int(JsonObject *o, StringView key, int **dest) {
+  Json *value = json_object_get(o, key);
+  if (value == NULL || value->type != JSON_INT ||
+      value->num_integer < INT_MIN || value->num_integer > INT_MAX) {
+    return false;
+  }
+  **dest = (int)value->num_integer;
+  return true;
+}
+
+bool json_object_get_int64(JsonObject *o, StringView key, int64_t **dest) {
   Json *value = json_object_get(o, key);
   if (value == NULL || value->type != JSON_INT) {
     return false;
@@ -511,6 +1094,21 @@ bool json_object_get_int(JsonObject *o, StringView key, int **dest) {
   return true;
 }
 
+bool json_object_get_uint64(JsonObject *o, StringView key, uint64_t **dest) {
+  Json *value = json_object_get(o, key);
+  if (value == NULL) {
+    return false;
+  }
+  if (value->type == JSON_UINT) {
+    **dest = value->num_unsigned;
+  } else if (value->type == JSON_INT && value->num_integer >= 0) {
+    **dest = (uint64_t)value->num_integer;
+  } else {
+    return false;
+  }
+  return true;
+}
+
 bool json_object_get_double(JsonObject *o, StringView key, double **dest) {
   Json *value = json_object_get(o, key);
   if (value == NULL || value->type != JSON_DOUBLE) {
@@ -567,26 +1165,40 @@ bool json_object_get_object(JsonObject *o, StringView key, JsonObject **dest) {
   return true;
 }
 
+// The file is parsed straight from the page cache, strings are copied out
+// so nothing refers to the mapping once it is gone.
 bool json_parse_file(const char *filename, Json *json) {
-  StringBuffer *content = sb_new();
-  if (!sb_file_read(filename, content)) {
-    sb_free(content);
+  SbFileMap map;
+  if (!sb_file_map(filename, &map)) {
     return false;
   }
-  if (!json_parse(content, json)) {
-    sb_free(content);
-    return false;
-  }
-  sb_free(content);
-  return true;
+  bool is_success = json_parse(&map.content, json);
+  sb_file_unmap(&map);
+  return is_success;
 }
 
-bool json_stringify_value(Json *json, StringBuffer *dest);
-
-bool json_stringify_string(Json *json, StringBuffer *dest) {
+// Clean runs are appended in bulk, only the bytes found by the escape scan
+// are rewritten.
+void json_stringify_escaped(StringBuffer *string, StringBuffer *dest) {
+  const char *p = string->data;
+  size_t len = string->len;
   sb_append_char(dest, '"');
-  sb_append_sb(dest, json->string);
+  while (true) {
+    size_t run = json_escape_scan(p, len);
+    sb_append(dest, sv_new(p, run));
+    if (run == len) {
+      break;
+    }
+    char escaped[JSON_ESCAPE_MAX_GROWTH];
+    sb_append(dest, sv_new(escaped, json_escape_char(p[run], escaped)));
+    p += run + 1;
+    len -= run + 1;
+  }
   sb_append_char(dest, '"');
+}
+
+bool json_stringify_string(Json *json, StringBuffer *dest) {
+  json_stringify_escaped(json->string, dest);
   return true;
 }
 
@@ -614,29 +1226,40 @@ bool json_stringify_object(Json *json, StringBuffer *dest) {
   JsonObject *object = json->object;
   bool first = true;
 
-  for (size_t i = 0; i < object->size; ++i) {
-    JsonObjectPair *pair = object->buckets[i];
-    while (pair) {
-      if (!first) {
-        sb_append_char(dest, ',');
-      } else {
-        first = false;
-      }
-
-      sb_append_char(dest, '"');
-      sb_append_sb(dest, pair->key);
-      sb_append_char(dest, '"');
-      sb_append_char(dest, ':');
-      json_stringify_value(pair->value, dest);
-
-      pair = pair->next;
+  for (size_t i = 0; i < json_object_slots(object); ++i) {
+    if (!json_object_slot_full(object, i)) {
+      continue;
+    }
+    if (!first) {
+      sb_append_char(dest, ',');
+    } else {
+      first = false;
     }
+
+    JsonObjectEntry *entry = &object->entries[i];
+    json_stringify_escaped(entry->key, dest);
+    sb_append_char(dest, ':');
+    json_stringify_value(entry->value, dest);
   }
 
   sb_append_char(dest, '}');
   return true;
 }
 
+// Numbers are formatted straight into the reserved tail of dest.
+static void json_stringify_number(Json *json, StringBuffer *dest) {
+  sb_reserve(dest, JSON_NUMBER_FORMAT_CAP);
+  char *out = (char *)dest->data + dest->len;
+  if (json->type == JSON_INT) {
+    dest->len += json_number_format_int64(json->num_integer, out);
+  } else if (json->type == JSON_UINT) {
+    dest->len += json_number_format_uint64(json->num_unsigned, out);
+  } else {
+    dest->len += json_number_format_double(json->num_double, out);
+  }
+  ((char *)dest->data)[dest->len] = '\0';
+}
+
 bool json_stringify_value(Json *json, StringBuffer *dest) {
   switch (json->type) {
   case JSON_STRING:
@@ -648,16 +1271,11 @@ bool json_stringify_value(Json *json, StringBuffer *dest) {
   case JSON_OBJECT:
     json_stringify_object(json, dest);
     break;
-  case JSON_INT: {
-    char int_str[JSON_INT_STR_CAP];
-    snprintf(int_str, sizeof(int_str), "%d", json->num_integer);
-    sb_append(dest, sv_new_from_cstr(int_str));
-  } break;
-  case JSON_DOUBLE: {
-    char double_str[JSON_DOUBLE_STR_CAP];
-    snprintf(double_str, sizeof(double_str), "%.17g", json->num_double);
-    sb_append(dest, sv_new_from_cstr(double_str));
-  } break;
+  case JSON_INT:
+  case JSON_UINT:
+  case JSON_DOUBLE:
+    json_stringify_number(json, dest);
+    break;
   case JSON_TRUE:
     sb_append(dest, sv_new_from_cstr("true"));
     break;
@@ -685,13 +1303,20 @@ Json *json_new_string(const char *value) {
   return j;
 }
 
-Json *json_new_int(int value) {
+Json *json_new_int(int64_t value) {
   Json *j = json_new();
   j->type = JSON_INT;
   j->num_integer = value;
   return j;
 }
 
+Json *json_new_uint(uint64_t value) {
+  Json *j = json_new();
+  j->type = JSON_UINT;
+  j->num_unsigned = value;
+  return j;
+}
+
 Json *json_new_double(double value) {
   Json *j = json_new();
   j->type = JSON_DOUBLE;
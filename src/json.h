@@ -1,3 +1,7 @@
+#include <stdatomic.h>
+
+#include "allocator.h"
+#include "json_number.h"
 #include "string_utils.h"
 
 #ifndef _JSON_H
@@ -6,32 +10,46 @@
 #define JSON_END_OF_INPUT '\0'
 #define JSON_ARRAY_CAP_INIT 3
 
-#define JSON_INT_STR_CAP 20
-#define JSON_DOUBLE_STR_CAP 40
-
-#define JSON_OBJECT_SIZE_INIT 16
+#define JSON_OBJECT_SIZE_INIT 0
+#define JSON_OBJECT_SMALL_MAX 8
+#define JSON_OBJECT_GROUP_SIZE 16
+#define JSON_OBJECT_CTRL_EMPTY 0x80
 
+// Line and offset are 1 based.
 typedef struct {
   size_t line;
   size_t offset;
 } Location;
 
+// ch is the char at cur, JSON_END_OF_INPUT once cur reaches end. Locations
+// are only computed for error messages.
+typedef struct JsonKeys JsonKeys;
+
 typedef struct {
   StringBuffer *input;
-  Location location;
-  size_t idx;
-  size_t read_idx;
+  Allocator *allocator;
+  bool zero_copy;
+  bool intern_keys;
+  JsonKeys *keys;
+  const char *cur;
+  const char *next;
+  const char *end;
   char ch;
 } Lexer;
 
 Lexer lexer_new(StringBuffer *input);
 void lexer_advance(Lexer *lexer);
+void lexer_seek(Lexer *lexer, const char *pos);
+Location lexer_location(Lexer *lexer);
 void lexer_skip_whitespace(Lexer *lexer);
 bool lexer_eat(Lexer *lexer, char ch);
 StringBuffer *lexer_read_integer(Lexer *lexer);
 StringBuffer *lexer_read_string(Lexer *lexer);
 bool is_alpha_lowercase(char ch);
 StringBuffer *lexer_read_ident(Lexer *lexer);
+bool lexer_scan_string(Lexer *lexer, StringView *dest, bool *has_escape);
+bool lexer_read_number(Lexer *lexer, JsonNumber *dest);
+StringView lexer_scan_ident(Lexer *lexer);
 
 typedef enum {
   JSON_EMPTY = 0,
@@ -43,6 +61,7 @@ typedef enum {
   JSON_NULL,
   JSON_TRUE,
   JSON_FALSE,
+  JSON_UINT,
 } JsonType;
 
 typedef struct JsonArray JsonArray;
@@ -53,7 +72,8 @@ typedef struct Json {
   JsonArray *array;
   JsonObject *object;
   StringBuffer *string;
-  int num_integer;
+  int64_t num_integer;
+  uint64_t num_unsigned;
   double num_double;
 } Json;
 
@@ -61,28 +81,74 @@ typedef struct JsonArray {
   Json **items;
   size_t len;
   size_t cap;
+  Allocator *allocator;
 } JsonArray;
 
-typedef struct JsonObjectPair {
-  struct JsonObjectPair *next;
+typedef struct {
   StringBuffer *key;
   Json *value;
-} JsonObjectPair;
-
+  size_t hash;
+} JsonObjectEntry;
+
+// Up to JSON_OBJECT_SMALL_MAX keys live unhashed in the first len entries
+// and ctrl is NULL. Larger objects are an open addressing table in the
+// Swiss table style, ctrl holds one byte per slot (empty or 7 bits of the
+// hash) and mirrors its first group past cap so any 16 byte group can be
+// loaded without wrapping. Objects with a key table store interned keys,
+// which belong to the table and are compared by pointer.
 typedef struct JsonObject {
-  JsonObjectPair **buckets;
-  size_t size;
+  uint8_t *ctrl;
+  JsonObjectEntry *entries;
+  size_t cap;
+  size_t len;
+  Allocator *allocator;
+  JsonKeys *keys;
 } JsonObject;
 
+typedef struct {
+  StringBuffer *key;
+  size_t hash;
+} JsonKey;
+
+// Per document key intern table, every object parsed with it holds a
+// reference. Keys are stored once with their hash. Lookups and releases may
+// run on any thread, interning into a table shared between documents (parsing
+// with it or json_object_set) must not run on two threads at once.
+struct JsonKeys {
+  JsonObject *table;
+  atomic_size_t refs;
+};
+
+// keys shares one key table between documents and takes precedence over
+// intern_keys, which gives each document its own. The table is created on the
+// first object key, documents without objects do not pay for it.
+typedef struct {
+  Allocator *allocator;
+  bool zero_copy;
+  bool intern_keys;
+  JsonKeys *keys;
+} JsonParseOptions;
+
 Lexer lexer_new(StringBuffer *input);
 
 bool json_parse_file(const char *filename, Json *json);
 
 bool json_stringify(Json *json, StringBuffer *dest);
+bool json_stringify_value(Json *json, StringBuffer *dest);
+void json_stringify_escaped(StringBuffer *string, StringBuffer *dest);
 
 bool json_parse(StringBuffer *input, Json *dest);
+bool json_parse_with_allocator(StringBuffer *input, Json *dest,
+                               Allocator *allocator);
+bool json_parse_with_options(StringBuffer *input, Json *dest,
+                             JsonParseOptions *options);
+StringBuffer *json_sb_new(Allocator *allocator, const char *data, size_t len);
+void json_sb_free(Allocator *allocator, StringBuffer *sb);
+
 Json *json_new();
+Json *json_new_with_allocator(Allocator *allocator);
 void json_free(Json *json);
+void json_free_with_allocator(Json *json, Allocator *allocator);
 void json_print(Json *json);
 
 bool json_parse_string(Lexer *lexer, Json *dest);
@@ -91,12 +157,14 @@ bool json_parse_array(Lexer *lexer, Json *dest);
 bool json_parse_object(Lexer *lexer, Json *dest);
 
 JsonArray *json_array_new();
+JsonArray *json_array_new_with_allocator(Allocator *allocator);
 void json_array_append(JsonArray *a, Json *item);
 void json_array_resize(JsonArray *a, size_t new_cap);
 void json_array_free(JsonArray *a);
 
 Json *json_new_string(const char *value);
-Json *json_new_int(int value);
+Json *json_new_int(int64_t value);
+Json *json_new_uint(uint64_t value);
 Json *json_new_double(double value);
 Json *json_new_bool(bool value);
 Json *json_new_null();
@@ -104,14 +172,27 @@ Json *json_new_object();
 Json *json_new_array();
 
 JsonObject *json_object_new(size_t size);
-void json_object_set(JsonObject *o, StringBuffer *key, Json *value);
+JsonObject *json_object_new_with_allocator(size_t size, Allocator *allocator);
+JsonObject *json_object_new_with_keys(JsonKeys *keys, Allocator *allocator);
+void json_object_set(JsonObject *o, StringView key, Json *value);
 Json *json_object_get(JsonObject *o, StringView key);
+Json *json_object_get_key(JsonObject *o, JsonKey key);
+Json *json_object_get_hashed(JsonObject *o, StringView key, size_t hash);
 size_t json_object_hash(StringView key);
 void json_object_free(JsonObject *o);
 void json_object_foreach(JsonObject *o,
                          void (*callback)(StringBuffer *key, Json *value));
+bool json_object_next(JsonObject *o, size_t *i, JsonObjectEntry **dest);
+
+JsonKeys *json_keys_new(Allocator *allocator);
+JsonKey json_keys_intern(JsonKeys *keys, StringView key, bool borrow);
+bool json_keys_find(JsonKeys *keys, StringView key, JsonKey *dest);
+void json_keys_retain(JsonKeys *keys);
+void json_keys_release(JsonKeys *keys);
 
 bool json_object_get_int(JsonObject *o, StringView key, int **dest);
+bool json_object_get_int64(JsonObject *o, StringView key, int64_t **dest);
+bool json_object_get_uint64(JsonObject *o, StringView key, uint64_t **dest);
 bool json_object_get_double(JsonObject *o, StringView key, double **dest);
 bool json_object_get_string(JsonObject *o, StringView key, StringBuffer **dest);
 bool json_object_get_bool(JsonObject *o, StringView key, bool **dest);
@@ -0,0 +1,518 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "json_binary.h"
+#include "logger.h"
+#include "mem.h"
+
+#define JSON_BINARY_KEYS_CAP_INIT 16
+
+// Offset of every key written so far. Keys point into the source document,
+// which outlives the writer, data is NULL for an empty slot.
+typedef struct {
+  const char *data;
+  size_t len;
+  size_t hash;
+  uint32_t offset;
+} JsonBinaryKeySlot;
+
+typedef struct {
+  StringBuffer *out;
+  size_t start;
+  JsonBinaryKeySlot *keys;
+  size_t keys_cap;
+  size_t keys_len;
+  bool failed;
+} JsonBinaryWriter;
+
+// Offsets are recorded from the magic, dest may already hold data before it.
+static size_t json_binary_offset(JsonBinaryWriter *w) {
+  return w->out->len - w->start;
+}
+
+static void json_binary_put(JsonBinaryWriter *w, const void *data,
+                            size_t len) {
+  sb_append(w->out, sv_new(data, len));
+}
+
+static void json_binary_put_u32(JsonBinaryWriter *w, uint32_t value) {
+  json_binary_put(w, &value, sizeof(value));
+}
+
+// Tables are reserved up front and patched once their values are written.
+static size_t json_binary_reserve(JsonBinaryWriter *w, size_t len) {
+  size_t at = w->out->len;
+  sb_reserve(w->out, len);
+  memset((char *)w->out->data + at, 0, len);
+  w->out->len += len;
+  return at;
+}
+
+static void json_binary_patch_u32(JsonBinaryWriter *w, size_t at,
+                                  size_t value) {
+  uint32_t narrow = (uint32_t)value;
+  memcpy((char *)w->out->data + at, &narrow, sizeof(narrow));
+}
+
+static size_t json_binary_write_string(JsonBinaryWriter *w, StringView s) {
+  size_t offset = json_binary_offset(w);
+  json_binary_put(w, "\"", 1);
+  json_binary_put_u32(w, (uint32_t)s.len);
+  json_binary_put(w, s.data, s.len);
+  json_binary_put(w, "", 1);
+  return offset;
+}
+
+static JsonBinaryKeySlot *json_binary_find_key(JsonBinaryKeySlot *keys,
+                                                size_t cap, StringView key,
+                                                size_t hash) {
+  size_t i = hash & (cap - 1);
+  while (keys[i].data != NULL &&
+         (keys[i].hash != hash || keys[i].len != key.len ||
+          memcmp(keys[i].data, key.data, key.len) != 0)) {
+    i = (i + 1) & (cap - 1);
+  }
+  return &keys[i];
+}
+
+static void json_binary_grow_keys(JsonBinaryWriter *w) {
+  size_t cap = w->keys_cap * 2;
+  JsonBinaryKeySlot *keys = mem_calloc(cap, sizeof(*keys));
+  if (keys == NULL) {
+    logger_log(LOG_FATAL, "json_to_binary malloc err");
+  }
+  for (size_t i = 0; i < w->keys_cap; ++i) {
+    JsonBinaryKeySlot *slot = &w->keys[i];
+    if (slot->data != NULL) {
+      *json_binary_find_key(keys, cap, sv_new(slot->data, slot->len),
+                            slot->hash) = *slot;
+    }
+  }
+  mem_free(w->keys);
+  w->keys = keys;
+  w->keys_cap = cap;
+}
+
+static size_t json_binary_write_key(JsonBinaryWriter *w, StringBuffer *key) {
+  StringView view = sv_new(key->data, key->len);
+  size_t hash = json_object_hash(view);
+  JsonBinaryKeySlot *slot =
+      json_binary_find_key(w->keys, w->keys_cap, view, hash);
+  if (slot->data != NULL) {
+    return slot->offset;
+  }
+  size_t offset = json_binary_write_string(w, view);
+  if ((w->keys_len + 1) * 4 > w->keys_cap * 3) {
+    json_binary_grow_keys(w);
+    slot = json_binary_find_key(w->keys, w->keys_cap, view, hash);
+  }
+  *slot = (JsonBinaryKeySlot){
+      .data = view.data,
+      .len = view.len,
+      .hash = hash,
+      .offset = (uint32_t)offset,
+  };
+  w->keys_len++;
+  return offset;
+}
+
+static int json_binary_compare_keys(StringView a, StringView b) {
+  int cmp = memcmp(a.data, b.data, a.len < b.len ? a.len : b.len);
+  if (cmp != 0) {
+    return cmp;
+  }
+  return a.len < b.len ? -1 : a.len > b.len;
+}
+
+static int json_binary_compare_entries(const void *a, const void *b) {
+  const StringBuffer *ka = (*(JsonObjectEntry *const *)a)->key;
+  const StringBuffer *kb = (*(JsonObjectEntry *const *)b)->key;
+  return json_binary_compare_keys(sv_new(ka->data, ka->len),
+                                  sv_new(kb->data, kb->len));
+}
+
+static size_t json_binary_write_value(JsonBinaryWriter *w, Json *json);
+
+static size_t json_binary_write_array(JsonBinaryWriter *w, JsonArray *a) {
+  size_t offset = json_binary_offset(w);
+  json_binary_put(w, "[", 1);
+  json_binary_put_u32(w, (uint32_t)a->len);
+  size_t table = json_binary_reserve(w, a->len * sizeof(uint32_t));
+  for (size_t i = 0; i < a->len; ++i) {
+    size_t item = json_binary_write_value(w, a->items[i]);
+    json_binary_patch_u32(w, table + i * sizeof(uint32_t), item);
+  }
+  return offset;
+}
+
+static size_t json_binary_write_object(JsonBinaryWriter *w, JsonObject *o) {
+  JsonObjectEntry **entries = mem_malloc((o->len + 1) * sizeof(*entries));
+  if (entries == NULL) {
+    logger_log(LOG_FATAL, "json_to_binary malloc err");
+  }
+  size_t len = 0;
+  size_t i = 0;
+  JsonObjectEntry *entry;
+  while (json_object_next(o, &i, &entry)) {
+    entries[len++] = entry;
+  }
+  qsort(entries, len, sizeof(*entries), json_binary_compare_entries);
+
+  size_t offset = json_binary_offset(w);
+  json_binary_put(w, "{", 1);
+  json_binary_put_u32(w, (uint32_t)len);
+  size_t table = json_binary_reserve(w, len * 2 * sizeof(uint32_t));
+  for (size_t n = 0; n < len; ++n) {
+    size_t key = json_binary_write_key(w, entries[n]->key);
+    size_t value = json_binary_write_value(w, entries[n]->value);
+    json_binary_patch_u32(w, table + n * 2 * sizeof(uint32_t), key);
+    json_binary_patch_u32(w, table + (n * 2 + 1) * sizeof(uint32_t), value);
+  }
+  mem_free(entries);
+  return offset;
+}
+
+static size_t json_binary_write_value(JsonBinaryWriter *w, Json *json) {
+  size_t offset = json_binary_offset(w);
+  switch (json->type) {
+  case JSON_STRING:
+    return json_binary_write_string(
+        w, sv_new(json->string->data, json->string->len));
+  case JSON_ARRAY:
+    return json_binary_write_array(w, json->array);
+  case JSON_OBJECT:
+    return json_binary_write_object(w, json->object);
+  case JSON_INT:
+    json_binary_put(w, "l", 1);
+    json_binary_put(w, &json->num_integer, sizeof(json->num_integer));
+    break;
+  case JSON_UINT:
+    json_binary_put(w, "u", 1);
+    json_binary_put(w, &json->num_unsigned, sizeof(json->num_unsigned));
+    break;
+  case JSON_DOUBLE:
+    json_binary_put(w, "d", 1);
+    json_binary_put(w, &json->num_double, sizeof(json->num_double));
+    break;
+  case JSON_TRUE:
+    json_binary_put(w, "t", 1);
+    break;
+  case JSON_FALSE:
+    json_binary_put(w, "f", 1);
+    break;
+  case JSON_NULL:
+    json_binary_put(w, "n", 1);
+    break;
+  default:
+    w->failed = true;
+    break;
+  }
+  return offset;
+}
+
+static bool json_binary_fail(StringBuffer *dest, size_t start,
+                             const char *reason) {
+  logger_log(LOG_ERROR, "JSON_BINARY %s", reason);
+  dest->len = start;
+  ((char *)dest->data)[start] = '\0';
+  return false;
+}
+
+// The document is appended to dest. Fails for documents past 4GB, offsets
+// are 32 bit, and leaves dest as it was on failure.
+bool json_to_binary(Json *json, StringBuffer *dest) {
+  size_t start = dest->len;
+  JsonBinaryWriter w = {
+      .out = dest,
+      .start = start,
+      .keys = mem_calloc(JSON_BINARY_KEYS_CAP_INIT, sizeof(JsonBinaryKeySlot)),
+      .keys_cap = JSON_BINARY_KEYS_CAP_INIT,
+      .keys_len = 0,
+      .failed = false,
+  };
+  if (w.keys == NULL) {
+    logger_log(LOG_FATAL, "json_to_binary malloc err");
+  }
+  json_binary_put(&w, JSON_BINARY_MAGIC, 4);
+  size_t header_len = json_binary_reserve(&w, sizeof(uint32_t));
+  json_binary_write_value(&w, json);
+  mem_free(w.keys);
+  if (w.failed) {
+    return json_binary_fail(dest, start, "invalid value type");
+  }
+  if (dest->len - start > UINT32_MAX) {
+    return json_binary_fail(dest, start, "document too large");
+  }
+  json_binary_patch_u32(&w, header_len, dest->len - start);
+  return true;
+}
+
+bool json_binary_open(StringView data, JsonBinary *dest) {
+  uint32_t len;
+  if (data.len <= JSON_BINARY_HEADER_SIZE ||
+      memcmp(data.data, JSON_BINARY_MAGIC, 4) != 0 ||
+      (memcpy(&len, data.data + 4, sizeof(len)), len != data.len)) {
+    logger_log(LOG_ERROR, "JSON_BINARY invalid header");
+    return false;
+  }
+  *dest = (JsonBinary){
+      .data = (const unsigned char *)data.data,
+      .len = data.len,
+      .is_mapped = false,
+  };
+  return true;
+}
+
+// The document is used straight from the page cache, nothing is copied.
+bool json_binary_map(const char *path, JsonBinary *dest) {
+  SbFileMap map;
+  if (!sb_file_map(path, &map)) {
+    return false;
+  }
+  if (!json_binary_open(sv_new(map.content.data, map.content.len), dest)) {
+    sb_file_unmap(&map);
+    return false;
+  }
+  dest->is_mapped = true;
+  dest->map = map;
+  return true;
+}
+
+void json_binary_unmap(JsonBinary *doc) {
+  if (doc->is_mapped) {
+    sb_file_unmap(&doc->map);
+  }
+  *doc = (JsonBinary){0};
+}
+
+JsonBinaryValue json_binary_root(const JsonBinary *doc) {
+  return (JsonBinaryValue){.doc = doc, .offset = JSON_BINARY_HEADER_SIZE};
+}
+
+// Every read is bounds checked so a truncated file can not be read past.
+static bool json_binary_has(JsonBinaryValue value, size_t at, size_t len) {
+  return (size_t)value.offset + at + len <= value.doc->len;
+}
+
+static char json_binary_tag(JsonBinaryValue value) {
+  return json_binary_has(value, 0, 1) ? (char)value.doc->data[value.offset]
+                                      : '\0';
+}
+
+static uint32_t json_binary_u32(JsonBinaryValue value, size_t at) {
+  uint32_t result;
+  memcpy(&result, value.doc->data + value.offset + at, sizeof(result));
+  return result;
+}
+
+static bool json_binary_container(JsonBinaryValue value, char tag,
+                                  size_t entry_size, size_t *count) {
+  if (json_binary_tag(value) != tag || !json_binary_has(value, 1, 4)) {
+    return false;
+  }
+  *count = json_binary_u32(value, 1);
+  return json_binary_has(value, 5, *count * entry_size);
+}
+
+static JsonBinaryValue json_binary_at(JsonBinaryValue value, uint32_t offset) {
+  return (JsonBinaryValue){.doc = value.doc, .offset = offset};
+}
+
+// The encoder writes values after their container, an offset pointing back
+// could form a cycle. Keys are shared strings and may point anywhere.
+static bool json_binary_child(JsonBinaryValue parent, uint32_t offset,
+                              JsonBinaryValue *dest) {
+  if (offset <= parent.offset) {
+    return false;
+  }
+  *dest = json_binary_at(parent, offset);
+  return true;
+}
+
+JsonType json_binary_type(JsonBinaryValue value) {
+  switch (json_binary_tag(value)) {
+  case '{':
+    return JSON_OBJECT;
+  case '[':
+    return JSON_ARRAY;
+  case '"':
+    return JSON_STRING;
+  case 'l':
+    return JSON_INT;
+  case 'u':
+    return JSON_UINT;
+  case 'd':
+    return JSON_DOUBLE;
+  case 't':
+    return JSON_TRUE;
+  case 'f':
+    return JSON_FALSE;
+  case 'n':
+    return JSON_NULL;
+  default:
+    return JSON_EMPTY;
+  }
+}
+
+size_t json_binary_len(JsonBinaryValue container) {
+  size_t count = 0;
+  if (!json_binary_container(container, '[', sizeof(uint32_t), &count) &&
+      !json_binary_container(container, '{', 2 * sizeof(uint32_t), &count)) {
+    return 0;
+  }
+  return count;
+}
+
+bool json_binary_array_get(JsonBinaryValue array, size_t i,
+                           JsonBinaryValue *dest) {
+  size_t count;
+  if (!json_binary_container(array, '[', sizeof(uint32_t), &count) ||
+      i >= count) {
+    return false;
+  }
+  return json_binary_child(array, json_binary_u32(array, 5 + i * 4), dest);
+}
+
+bool json_binary_get_string(JsonBinaryValue value, StringView *dest) {
+  if (json_binary_tag(value) != '"' || !json_binary_has(value, 1, 4)) {
+    return false;
+  }
+  uint32_t len = json_binary_u32(value, 1);
+  if (!json_binary_has(value, 5, len)) {
+    return false;
+  }
+  *dest = sv_new((const char *)value.doc->data + value.offset + 5, len);
+  return true;
+}
+
+bool json_binary_object_at(JsonBinaryValue object, size_t i, StringView *key,
+                           JsonBinaryValue *value) {
+  size_t count;
+  if (!json_binary_container(object, '{', 2 * sizeof(uint32_t), &count) ||
+      i >= count) {
+    return false;
+  }
+  JsonBinaryValue key_value =
+      json_binary_at(object, json_binary_u32(object, 5 + i * 8));
+  return json_binary_child(object, json_binary_u32(object, 5 + i * 8 + 4),
+                           value) &&
+         json_binary_get_string(key_value, key);
+}
+
+// Members are sorted by key bytes, so lookups never hash.
+bool json_binary_object_get(JsonBinaryValue object, StringView key,
+                            JsonBinaryValue *dest) {
+  size_t lo = 0;
+  size_t hi = json_binary_len(object);
+  if (json_binary_tag(object) != '{') {
+    return false;
+  }
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    StringView member;
+    JsonBinaryValue value;
+    if (!json_binary_object_at(object, mid, &member, &value)) {
+      return false;
+    }
+    int cmp = json_binary_compare_keys(member, key);
+    if (cmp == 0) {
+      *dest = value;
+      return true;
+    } else if (cmp < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return false;
+}
+
+static bool json_binary_get_word(JsonBinaryValue value, char tag,
+                                 void *dest) {
+  if (json_binary_tag(value) != tag || !json_binary_has(value, 1, 8)) {
+    return false;
+  }
+  memcpy(dest, value.doc->data + value.offset + 1, 8);
+  return true;
+}
+
+bool json_binary_get_int64(JsonBinaryValue value, int64_t *dest) {
+  return json_binary_get_word(value, 'l', dest);
+}
+
+bool json_binary_get_uint64(JsonBinaryValue value, uint64_t *dest) {
+  return json_binary_get_word(value, 'u', dest);
+}
+
+bool json_binary_get_double(JsonBinaryValue value, double *dest) {
+  return json_binary_get_word(value, 'd', dest);
+}
+
+bool json_binary_get_bool(JsonBinaryValue value, bool *dest) {
+  char tag = json_binary_tag(value);
+  if (tag != 't' && tag != 'f') {
+    return false;
+  }
+  *dest = tag == 't';
+  return true;
+}
+
+// Builds a regular heap backed tree, for callers that need to modify it.
+bool json_from_binary(JsonBinaryValue value, Json *dest) {
+  *dest = (Json){.type = json_binary_type(value)};
+  switch (dest->type) {
+  case JSON_STRING: {
+    StringView string;
+    if (!json_binary_get_string(value, &string)) {
+      return false;
+    }
+    dest->string = sb_new_from_sv(string);
+    return true;
+  }
+  case JSON_INT:
+    return json_binary_get_int64(value, &dest->num_integer);
+  case JSON_UINT:
+    return json_binary_get_uint64(value, &dest->num_unsigned);
+  case JSON_DOUBLE:
+    return json_binary_get_double(value, &dest->num_double);
+  case JSON_TRUE:
+  case JSON_FALSE:
+  case JSON_NULL:
+    return true;
+  case JSON_ARRAY: {
+    dest->array = json_array_new();
+    size_t len = json_binary_len(value);
+    for (size_t i = 0; i < len; ++i) {
+      JsonBinaryValue item;
+      Json *node = json_new();
+      json_array_append(dest->array, node);
+      if (!json_binary_array_get(value, i, &item) ||
+          !json_from_binary(item, node)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  case JSON_OBJECT: {
+    size_t len = json_binary_len(value);
+    dest->object = json_object_new(len);
+    for (size_t i = 0; i < len; ++i) {
+      StringView key;
+      JsonBinaryValue member;
+      if (!json_binary_object_at(value, i, &key, &member)) {
+        return false;
+      }
+      Json *node = json_new();
+      json_object_set(dest->object, key, node);
+      if (!json_from_binary(member, node)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  default:
+    logger_log(LOG_ERROR, "JSON_BINARY invalid tag at offset %u",
+               value.offset);
+    return false;
+  }
+}
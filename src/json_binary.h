@@ -0,0 +1,57 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "json.h"
+
+#ifndef _JSON_BINARY_H
+#define _JSON_BINARY_H
+
+#define JSON_BINARY_MAGIC "JSB1"
+#define JSON_BINARY_HEADER_SIZE 8
+
+// Header is the magic and the u32 total length, the root value follows.
+// Values start with the tag chars of the tape, numbers are host order.
+//   '"'          u32 length, the bytes and a '\0'
+//   'l' 'u' 'd'  int64, uint64 or double
+//   '['          u32 count, u32 offset of every item
+//   '{'          u32 count, u32 key and value offsets sorted by key
+//   't' 'f' 'n'  nothing
+// Offsets are from the start of the magic and every key is stored once,
+// lookups are a binary search over the sorted member table. Values always
+// come after their container, readers reject offsets that point back.
+typedef struct {
+  const unsigned char *data;
+  size_t len;
+  bool is_mapped;
+  SbFileMap map;
+} JsonBinary;
+
+typedef struct {
+  const JsonBinary *doc;
+  uint32_t offset;
+} JsonBinaryValue;
+
+bool json_to_binary(Json *json, StringBuffer *dest);
+bool json_from_binary(JsonBinaryValue value, Json *dest);
+
+bool json_binary_open(StringView data, JsonBinary *dest);
+bool json_binary_map(const char *path, JsonBinary *dest);
+void json_binary_unmap(JsonBinary *doc);
+JsonBinaryValue json_binary_root(const JsonBinary *doc);
+
+JsonType json_binary_type(JsonBinaryValue value);
+size_t json_binary_len(JsonBinaryValue container);
+bool json_binary_array_get(JsonBinaryValue array, size_t i,
+                           JsonBinaryValue *dest);
+bool json_binary_object_get(JsonBinaryValue object, StringView key,
+                            JsonBinaryValue *dest);
+bool json_binary_object_at(JsonBinaryValue object, size_t i, StringView *key,
+                           JsonBinaryValue *value);
+
+bool json_binary_get_string(JsonBinaryValue value, StringView *dest);
+bool json_binary_get_int64(JsonBinaryValue value, int64_t *dest);
+bool json_binary_get_uint64(JsonBinaryValue value, uint64_t *dest);
+bool json_binary_get_double(JsonBinaryValue value, double *dest);
+bool json_binary_get_bool(JsonBinaryValue value, bool *dest);
+
+#endif // _JSON_BINARY_H
@@ -0,0 +1,409 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json_cache.h"
+#include "logger.h"
+#include "mem.h"
+
+static bool json_is_container(Json *json) {
+  return json->type == JSON_ARRAY || json->type == JSON_OBJECT;
+}
+
+static uint64_t json_hash_mix(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+static size_t json_cache_home(JsonCacheContext *ctx, Json *json) {
+  return json_hash_mix((uint64_t)(uintptr_t)json) & (ctx->cap - 1);
+}
+
+static size_t json_cache_probe(JsonCacheContext *ctx, Json *json) {
+  size_t i = json_cache_home(ctx, json);
+  while (ctx->slots[i].node != NULL && ctx->slots[i].node != json) {
+    i = (i + 1) & (ctx->cap - 1);
+  }
+  return i;
+}
+
+JsonCacheContext *json_cache_context_new() {
+  JsonCacheContext *ctx = mem_malloc(sizeof(JsonCacheContext));
+  if (ctx == NULL) {
+    logger_log(LOG_FATAL, "json_cache_context_new malloc err");
+  }
+  *ctx = (JsonCacheContext){.entries = arena_new(0)};
+  return ctx;
+}
+
+void json_cache_context_free(JsonCacheContext *ctx) {
+  if (ctx == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < ctx->cap; ++i) {
+    if (ctx->slots[i].node != NULL) {
+      sb_free(ctx->slots[i].cache->text);
+    }
+  }
+  mem_free(ctx->slots);
+  arena_free(ctx->entries);
+  mem_free(ctx);
+}
+
+JsonCache *json_cache_get(JsonCacheContext *ctx, Json *json) {
+  if (ctx->len == 0) {
+    return NULL;
+  }
+  return ctx->slots[json_cache_probe(ctx, json)].cache;
+}
+
+static void json_cache_grow(JsonCacheContext *ctx) {
+  JsonCacheSlot *old = ctx->slots;
+  size_t old_cap = ctx->cap;
+  ctx->cap = old_cap == 0 ? JSON_CACHE_CAP_INIT : old_cap * 2;
+  ctx->slots = mem_calloc(ctx->cap, sizeof(JsonCacheSlot));
+  if (ctx->slots == NULL) {
+    logger_log(LOG_FATAL, "json_cache_grow malloc err");
+  }
+  for (size_t i = 0; i < old_cap; ++i) {
+    if (old[i].node != NULL) {
+      ctx->slots[json_cache_probe(ctx, old[i].node)] = old[i];
+    }
+  }
+  mem_free(old);
+}
+
+// Entries never move, pointers to them stay valid while the walks below add
+// the entries of children.
+static JsonCache *json_cache_entry(JsonCacheContext *ctx, Json *json,
+                                   Json *parent) {
+  if ((ctx->len + 1) * 4 > ctx->cap * 3) {
+    json_cache_grow(ctx);
+  }
+  JsonCacheSlot *slot = &ctx->slots[json_cache_probe(ctx, json)];
+  if (slot->node == NULL) {
+    JsonCache *cache = ctx->free;
+    if (cache != NULL) {
+      ctx->free = cache->next_free;
+    } else {
+      cache = arena_alloc(ctx->entries, sizeof(JsonCache));
+    }
+    *cache = (JsonCache){.node = json, .dirty = true};
+    *slot = (JsonCacheSlot){.node = json, .cache = cache};
+    ctx->len++;
+  }
+  if (parent != NULL) {
+    slot->cache->parent = parent;
+  }
+  return slot->cache;
+}
+
+// Backward shift deletion, entries after the hole move up unless their home
+// slot lies between the hole and them.
+static void json_cache_remove(JsonCacheContext *ctx, Json *json) {
+  size_t mask = ctx->cap - 1;
+  size_t hole = json_cache_probe(ctx, json);
+  if (ctx->slots[hole].node == NULL) {
+    return;
+  }
+  JsonCache *cache = ctx->slots[hole].cache;
+  sb_free(cache->text);
+  cache->text = NULL;
+  cache->next_free = ctx->free;
+  ctx->free = cache;
+  ctx->len--;
+  for (size_t j = (hole + 1) & mask; ctx->slots[j].node != NULL;
+       j = (j + 1) & mask) {
+    size_t home = json_cache_home(ctx, ctx->slots[j].node);
+    if (((j - home) & mask) >= ((j - hole) & mask)) {
+      ctx->slots[hole] = ctx->slots[j];
+      hole = j;
+    }
+  }
+  ctx->slots[hole] = (JsonCacheSlot){0};
+}
+
+// Drops the entries of root and every container below it.
+void json_cache_forget(JsonCacheContext *ctx, Json *root) {
+  if (ctx->len == 0 || !json_is_container(root)) {
+    return;
+  }
+  if (root->type == JSON_ARRAY) {
+    for (size_t i = 0; i < root->array->len; ++i) {
+      json_cache_forget(ctx, root->array->items[i]);
+    }
+  } else {
+    size_t i = 0;
+    JsonObjectEntry *entry;
+    while (json_object_next(root->object, &i, &entry)) {
+      json_cache_forget(ctx, entry->value);
+    }
+  }
+  json_cache_remove(ctx, root);
+}
+
+// Marks container and the containers above it as changed. A dirty container
+// always has dirty ancestors, so the walk stops at the first one already
+// marked. Containers without an entry were added since the last walk and
+// their ancestors were touched then.
+void json_cache_touch(JsonCacheContext *ctx, Json *container) {
+  for (Json *node = container; node != NULL;) {
+    JsonCache *cache = json_cache_get(ctx, node);
+    if (cache == NULL || (cache->dirty && !cache->hash_valid)) {
+      return;
+    }
+    cache->dirty = true;
+    cache->hash_valid = false;
+    node = cache->parent;
+  }
+}
+
+static void json_cache_adopt(JsonCacheContext *ctx, Json *parent, Json *child) {
+  JsonCache *cache = json_cache_get(ctx, child);
+  if (cache != NULL) {
+    cache->parent = parent;
+  }
+}
+
+// json_object_set frees a replaced value, its entries go with it.
+void json_cache_object_set(JsonCacheContext *ctx, Json *object, StringView key,
+                           Json *value) {
+  Json *old = json_object_get(object->object, key);
+  if (old != NULL && old != value) {
+    json_cache_forget(ctx, old);
+  }
+  json_object_set(object->object, key, value);
+  json_cache_adopt(ctx, object, value);
+  json_cache_touch(ctx, object);
+}
+
+void json_cache_array_append(JsonCacheContext *ctx, Json *array, Json *item) {
+  json_array_append(array->array, item);
+  json_cache_adopt(ctx, array, item);
+  json_cache_touch(ctx, array);
+}
+
+// The removed item belongs to the caller and keeps its entries, so it can
+// be inserted again. It has to be forgotten before it is freed.
+Json *json_cache_array_remove(JsonCacheContext *ctx, Json *array, size_t i) {
+  JsonArray *a = array->array;
+  Json *item = a->items[i];
+  memmove(&a->items[i], &a->items[i + 1], (a->len - i - 1) * sizeof(Json *));
+  a->len--;
+  json_cache_touch(ctx, array);
+  return item;
+}
+
+typedef struct {
+  JsonCacheContext *ctx;
+  StringBuffer *out;
+  const char *prev;
+} JsonCacheWriter;
+
+static void json_cache_emit(JsonCacheWriter *w, Json *json, JsonCache *cache,
+                            Json *parent, size_t parent_epoch,
+                            size_t parent_start, size_t base);
+
+// A child copied from the previous output has to have been emitted by this
+// container in its previous emit, otherwise its offset is stale.
+static void json_cache_emit_child(JsonCacheWriter *w, Json *child, Json *json,
+                                  JsonCache *cache, size_t prev_epoch,
+                                  size_t start, size_t base) {
+  if (!json_is_container(child)) {
+    json_stringify_value(child, w->out);
+    return;
+  }
+  JsonCache *child_cache = json_cache_entry(w->ctx, child, json);
+  size_t child_base = base != JSON_CACHE_NO_BASE &&
+                              child_cache->owner == json &&
+                              child_cache->parent_epoch == prev_epoch
+                          ? base + child_cache->offset
+                          : JSON_CACHE_NO_BASE;
+  json_cache_emit(w, child, child_cache, json, cache->epoch, start,
+                  child_base);
+}
+
+// base is where the text of json starts in the previous output. Clean
+// containers with a known base are copied from there in one piece, the
+// others are re-emitted around their children.
+static void json_cache_emit(JsonCacheWriter *w, Json *json, JsonCache *cache,
+                            Json *parent, size_t parent_epoch,
+                            size_t parent_start, size_t base) {
+  size_t start = w->out->len;
+  if (base != JSON_CACHE_NO_BASE && !cache->dirty) {
+    sb_append(w->out, sv_new(w->prev + base, cache->len));
+  } else if (json->type == JSON_ARRAY) {
+    size_t prev_epoch = cache->epoch++;
+    sb_append_char(w->out, '[');
+    for (size_t i = 0; i < json->array->len; ++i) {
+      if (i > 0) {
+        sb_append_char(w->out, ',');
+      }
+      json_cache_emit_child(w, json->array->items[i], json, cache, prev_epoch,
+                            start, base);
+    }
+    sb_append_char(w->out, ']');
+  } else {
+    size_t prev_epoch = cache->epoch++;
+    sb_append_char(w->out, '{');
+    size_t i = 0;
+    JsonObjectEntry *entry;
+    bool first = true;
+    while (json_object_next(json->object, &i, &entry)) {
+      if (!first) {
+        sb_append_char(w->out, ',');
+      }
+      first = false;
+      json_stringify_escaped(entry->key, w->out);
+      sb_append_char(w->out, ':');
+      json_cache_emit_child(w, entry->value, json, cache, prev_epoch, start,
+                            base);
+    }
+    sb_append_char(w->out, '}');
+  }
+  cache->len = w->out->len - start;
+  cache->dirty = false;
+  cache->owner = parent;
+  cache->parent_epoch = parent_epoch;
+  cache->offset = start - parent_start;
+}
+
+// Same output as json_stringify. The root keeps its last output and only
+// containers touched since then are emitted again, everything else is
+// copied over from the previous text.
+bool json_stringify_cached(JsonCacheContext *ctx, Json *root,
+                           StringBuffer *dest) {
+  if (!json_is_container(root)) {
+    return json_stringify(root, dest);
+  }
+  JsonCache *cache = json_cache_entry(ctx, root, NULL);
+  JsonCacheWriter w = {
+      .ctx = ctx,
+      .out = sb_new_with_custom_cap(cache->text != NULL ? cache->text->len + 1
+                                                        : SB_INITIAL_CAP),
+      .prev = cache->text != NULL ? cache->text->data : NULL,
+  };
+  size_t base = cache->text != NULL && cache->owner == NULL
+                    ? 0
+                    : JSON_CACHE_NO_BASE;
+  json_cache_emit(&w, root, cache, NULL, 0, 0, base);
+  sb_free(cache->text);
+  cache->text = w.out;
+  sb_append(dest, sv_new(w.out->data, w.out->len));
+  return true;
+}
+
+static uint64_t json_hash_at(JsonCacheContext *ctx, Json *json, Json *parent);
+
+static uint64_t json_hash_members(JsonCacheContext *ctx, Json *json,
+                                  uint64_t h) {
+  if (json->type == JSON_ARRAY) {
+    for (size_t i = 0; i < json->array->len; ++i) {
+      Json *item = json->array->items[i];
+      h = json_hash_mix(h * 31 + json_hash_at(ctx, item, json));
+    }
+    return h;
+  }
+  uint64_t members = 0;
+  size_t i = 0;
+  JsonObjectEntry *entry;
+  while (json_object_next(json->object, &i, &entry)) {
+    members += json_hash_mix(
+        json_object_hash(sv_new(entry->key->data, entry->key->len)) ^
+        json_hash_at(ctx, entry->value, json));
+  }
+  return json_hash_mix(h ^ members);
+}
+
+static uint64_t json_hash_at(JsonCacheContext *ctx, Json *json, Json *parent) {
+  uint64_t h = json_hash_mix((uint64_t)json->type + 1);
+  switch (json->type) {
+  case JSON_STRING:
+    return json_hash_mix(
+        h ^ json_object_hash(sv_new(json->string->data, json->string->len)));
+  case JSON_INT:
+    return json_hash_mix(h ^ (uint64_t)json->num_integer);
+  case JSON_UINT:
+    return json_hash_mix(h ^ json->num_unsigned);
+  case JSON_DOUBLE: {
+    uint64_t bits;
+    double value = json->num_double == 0.0 ? 0.0 : json->num_double;
+    memcpy(&bits, &value, sizeof(bits));
+    return json_hash_mix(h ^ bits);
+  }
+  case JSON_ARRAY:
+  case JSON_OBJECT:
+    break;
+  default:
+    return h;
+  }
+
+  if (ctx == NULL) {
+    return json_hash_members(ctx, json, h);
+  }
+  JsonCache *cache = json_cache_entry(ctx, json, parent);
+  if (!cache->hash_valid) {
+    cache->hash = json_hash_members(ctx, json, h);
+    cache->hash_valid = true;
+  }
+  return cache->hash;
+}
+
+// Structural hash, member order does not matter for objects. Container
+// hashes are cached in ctx until the container is touched, without a
+// context every call walks the whole value.
+uint64_t json_hash(JsonCacheContext *ctx, Json *json) {
+  return json_hash_at(ctx, json, NULL);
+}
+
+// Different hashes answer without a walk. Equal hashes are confirmed member
+// by member, which stops at the first subtree whose hashes differ.
+bool json_equal(JsonCacheContext *ctx, Json *a, Json *b) {
+  if (a == b) {
+    return true;
+  }
+  if (a->type != b->type || json_hash(ctx, a) != json_hash(ctx, b)) {
+    return false;
+  }
+  switch (a->type) {
+  case JSON_STRING:
+    return sb_compare(a->string, b->string);
+  case JSON_INT:
+    return a->num_integer == b->num_integer;
+  case JSON_UINT:
+    return a->num_unsigned == b->num_unsigned;
+  case JSON_DOUBLE:
+    return a->num_double == b->num_double;
+  case JSON_ARRAY:
+    if (a->array->len != b->array->len) {
+      return false;
+    }
+    for (size_t i = 0; i < a->array->len; ++i) {
+      if (!json_equal(ctx, a->array->items[i], b->array->items[i])) {
+        return false;
+      }
+    }
+    return true;
+  case JSON_OBJECT: {
+    if (a->object->len != b->object->len) {
+      return false;
+    }
+    size_t i = 0;
+    JsonObjectEntry *entry;
+    while (json_object_next(a->object, &i, &entry)) {
+      Json *other = json_object_get(
+          b->object, sv_new(entry->key->data, entry->key->len));
+      if (other == NULL || !json_equal(ctx, entry->value, other)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  default:
+    return true;
+  }
+}
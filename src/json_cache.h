@@ -0,0 +1,72 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "json.h"
+
+#ifndef _JSON_CACHE_H
+#define _JSON_CACHE_H
+
+#define JSON_CACHE_NO_BASE SIZE_MAX
+#define JSON_CACHE_CAP_INIT 16
+
+// Per container state for the cached stringify and hashes. parent is the
+// container node was last seen in. offset is where the text starts relative
+// to the text of owner, which is only valid while owner is still at
+// parent_epoch, epoch counts how often the container was re-emitted. A root
+// keeps the whole last output in text. next_free links forgotten entries.
+typedef struct JsonCache {
+  Json *node;
+  Json *parent;
+  Json *owner;
+  size_t parent_epoch;
+  size_t epoch;
+  size_t offset;
+  size_t len;
+  uint64_t hash;
+  bool dirty;
+  bool hash_valid;
+  StringBuffer *text;
+  struct JsonCache *next_free;
+} JsonCache;
+
+typedef struct {
+  Json *node;
+  JsonCache *cache;
+} JsonCacheSlot;
+
+// Side table from container nodes to their JsonCache, open addressing with
+// linear probing. Entries come from the context's arena in the order the
+// walks meet the containers, so later walks read them mostly in sequence.
+// The documents are not changed and may live in an arena themselves, all
+// cache memory belongs to the context.
+//
+// Changes have to go through the json_cache_* wrappers, or be followed by
+// json_cache_touch on the container holding the changed value. Nodes freed
+// by other means have to be dropped with json_cache_forget first, a new node
+// could otherwise inherit their entry.
+typedef struct {
+  JsonCacheSlot *slots;
+  size_t cap;
+  size_t len;
+  Arena *entries;
+  JsonCache *free;
+} JsonCacheContext;
+
+JsonCacheContext *json_cache_context_new();
+void json_cache_context_free(JsonCacheContext *ctx);
+JsonCache *json_cache_get(JsonCacheContext *ctx, Json *json);
+void json_cache_forget(JsonCacheContext *ctx, Json *root);
+
+void json_cache_touch(JsonCacheContext *ctx, Json *container);
+void json_cache_object_set(JsonCacheContext *ctx, Json *object, StringView key,
+                           Json *value);
+void json_cache_array_append(JsonCacheContext *ctx, Json *array, Json *item);
+Json *json_cache_array_remove(JsonCacheContext *ctx, Json *array, size_t i);
+
+bool json_stringify_cached(JsonCacheContext *ctx, Json *root,
+                           StringBuffer *dest);
+uint64_t json_hash(JsonCacheContext *ctx, Json *json);
+bool json_equal(JsonCacheContext *ctx, Json *a, Json *b);
+
+#endif // _JSON_CACHE_H
@@ -0,0 +1,263 @@
+#include <ctype.h>
+#include <string.h>
+
+#include "json_decode.h"
+#include "json_escape.h"
+#include "json_sax.h"
+#include "logger.h"
+
+typedef struct {
+  Lexer lexer;
+  Arena *arena;
+} JsonDecoder;
+
+static bool json_decode_error(JsonDecoder *d, const char *expected) {
+  Location location = lexer_location(&d->lexer);
+  logger_log(LOG_ERROR, "JSON_DECODE expected %s at line %lu on offset %lu",
+             expected, location.line, location.offset);
+  return false;
+}
+
+static size_t json_decode_size(JsonDecodeType type, const JsonSchema *schema) {
+  switch (type) {
+  case JSON_DECODE_INT64:
+    return sizeof(int64_t);
+  case JSON_DECODE_UINT64:
+    return sizeof(uint64_t);
+  case JSON_DECODE_DOUBLE:
+    return sizeof(double);
+  case JSON_DECODE_BOOL:
+    return sizeof(bool);
+  case JSON_DECODE_STRING:
+    return sizeof(StringView);
+  case JSON_DECODE_OBJECT:
+    return schema->size;
+  default:
+    return sizeof(JsonDecodedArray);
+  }
+}
+
+// Fields usually come in declaration order, so the search starts right after
+// the last match.
+static const JsonField *json_decode_find(const JsonSchema *schema,
+                                         StringView key, size_t *hint) {
+  for (size_t n = 0; n < schema->len; ++n) {
+    size_t i = *hint + n < schema->len ? *hint + n : *hint + n - schema->len;
+    const JsonField *field = &schema->fields[i];
+    if (field->key.len == key.len &&
+        memcmp(field->key.data, key.data, key.len) == 0) {
+      *hint = i + 1 < schema->len ? i + 1 : 0;
+      return field;
+    }
+  }
+  return NULL;
+}
+
+// Strings borrow the input, only escaped ones are decoded into the arena.
+static bool json_decode_string(JsonDecoder *d, StringView *dest) {
+  if (d->lexer.ch != '"') {
+    return json_decode_error(d, "string");
+  }
+  bool has_escape;
+  if (!lexer_scan_string(&d->lexer, dest, &has_escape)) {
+    return false;
+  }
+  if (!has_escape) {
+    return true;
+  }
+  char *decoded = arena_alloc(d->arena, dest->len + 1);
+  ssize_t len = json_unescape(dest->data, dest->len, decoded);
+  if (len < 0) {
+    return json_decode_error(d, "valid escapes");
+  }
+  decoded[len] = '\0';
+  *dest = sv_new(decoded, (size_t)len);
+  return true;
+}
+
+static bool json_decode_number(JsonDecoder *d, JsonNumber *dest) {
+  if (d->lexer.ch != '-' && !isdigit((unsigned char)d->lexer.ch)) {
+    return json_decode_error(d, "number");
+  }
+  return lexer_read_number(&d->lexer, dest);
+}
+
+static bool json_decode_value(JsonDecoder *d, JsonDecodeType type,
+                              JsonDecodeType item, const JsonSchema *schema,
+                              void *dest);
+
+static bool json_decode_object(JsonDecoder *d, const JsonSchema *schema,
+                               char *dest) {
+  Lexer *lexer = &d->lexer;
+  if (lexer->ch != '{') {
+    return json_decode_error(d, "object");
+  }
+  lexer_advance(lexer);
+  lexer_skip_whitespace(lexer);
+  if (lexer->ch == '}') {
+    lexer_advance(lexer);
+    return true;
+  }
+  size_t hint = 0;
+  while (true) {
+    lexer_skip_whitespace(lexer);
+    StringView key;
+    if (!json_decode_string(d, &key)) {
+      return false;
+    }
+    lexer_skip_whitespace(lexer);
+    if (!lexer_eat(lexer, ':')) {
+      return false;
+    }
+    const JsonField *field = json_decode_find(schema, key, &hint);
+    if (field == NULL) {
+      JsonSaxHandler skip = {0};
+      if (!json_sax_parse_value(lexer, &skip)) {
+        return false;
+      }
+    } else if (!json_decode_value(d, field->type, field->item, field->schema,
+                                  dest + field->offset)) {
+      return false;
+    }
+    lexer_skip_whitespace(lexer);
+    if (lexer->ch != ',') {
+      break;
+    }
+    lexer_advance(lexer);
+  }
+  return lexer_eat(lexer, '}');
+}
+
+// Items are decoded in place into an arena block that doubles when full.
+static bool json_decode_array(JsonDecoder *d, JsonDecodeType item,
+                              const JsonSchema *schema,
+                              JsonDecodedArray *dest) {
+  Lexer *lexer = &d->lexer;
+  if (lexer->ch != '[') {
+    return json_decode_error(d, "array");
+  }
+  if (item == JSON_DECODE_ARRAY) {
+    logger_log(LOG_ERROR, "JSON_DECODE arrays of arrays are not supported");
+    return false;
+  }
+  lexer_advance(lexer);
+  lexer_skip_whitespace(lexer);
+  *dest = (JsonDecodedArray){0};
+  if (lexer->ch == ']') {
+    lexer_advance(lexer);
+    return true;
+  }
+  size_t size = json_decode_size(item, schema);
+  size_t cap = 0;
+  char *items = NULL;
+  while (true) {
+    if (dest->len == cap) {
+      cap = cap == 0 ? JSON_DECODE_ARRAY_CAP_INIT : cap * 2;
+      char *grown = arena_alloc(d->arena, cap * size);
+      if (dest->len > 0) {
+        memcpy(grown, items, dest->len * size);
+      }
+      items = grown;
+      dest->items = items;
+    }
+    char *slot = items + dest->len * size;
+    memset(slot, 0, size);
+    if (!json_decode_value(d, item, item, schema, slot)) {
+      return false;
+    }
+    dest->len++;
+    lexer_skip_whitespace(lexer);
+    if (lexer->ch != ',') {
+      break;
+    }
+    lexer_advance(lexer);
+  }
+  return lexer_eat(lexer, ']');
+}
+
+// null leaves the destination as it is.
+static bool json_decode_value(JsonDecoder *d, JsonDecodeType type,
+                              JsonDecodeType item, const JsonSchema *schema,
+                              void *dest) {
+  Lexer *lexer = &d->lexer;
+  lexer_skip_whitespace(lexer);
+  if (lexer->ch == 'n') {
+    return sv_compare(lexer_scan_ident(lexer), sv_new("null", 4)) ||
+           json_decode_error(d, "null");
+  }
+  JsonNumber number;
+  switch (type) {
+  case JSON_DECODE_INT64:
+    if (!json_decode_number(d, &number)) {
+      return false;
+    }
+    if (number.type != JSON_NUMBER_INT) {
+      return json_decode_error(d, "int64");
+    }
+    *(int64_t *)dest = number.integer;
+    return true;
+  case JSON_DECODE_UINT64:
+    if (!json_decode_number(d, &number)) {
+      return false;
+    }
+    if (number.type == JSON_NUMBER_UINT) {
+      *(uint64_t *)dest = number.unsigned_integer;
+    } else if (number.type == JSON_NUMBER_INT && number.integer >= 0) {
+      *(uint64_t *)dest = (uint64_t)number.integer;
+    } else {
+      return json_decode_error(d, "uint64");
+    }
+    return true;
+  case JSON_DECODE_DOUBLE:
+    if (!json_decode_number(d, &number)) {
+      return false;
+    }
+    *(double *)dest = number.type == JSON_NUMBER_DOUBLE ? number.floating
+                      : number.type == JSON_NUMBER_INT
+                          ? (double)number.integer
+                          : (double)number.unsigned_integer;
+    return true;
+  case JSON_DECODE_BOOL: {
+    StringView ident = lexer_scan_ident(lexer);
+    if (sv_compare(ident, sv_new("true", 4))) {
+      *(bool *)dest = true;
+    } else if (sv_compare(ident, sv_new("false", 5))) {
+      *(bool *)dest = false;
+    } else {
+      return json_decode_error(d, "bool");
+    }
+    return true;
+  }
+  case JSON_DECODE_STRING:
+    return json_decode_string(d, dest);
+  case JSON_DECODE_OBJECT:
+    return json_decode_object(d, schema, dest);
+  case JSON_DECODE_ARRAY:
+    return json_decode_array(d, item, schema, dest);
+  default:
+    return false;
+  }
+}
+
+// Decodes an object straight into dest as described by schema, no Json nodes
+// are built. Keys missing from the schema are skipped, fields missing from
+// the input keep their value. Arrays and escaped strings are allocated from
+// arena, every other string points into input.
+bool json_decode(StringView input, const JsonSchema *schema, void *dest,
+                 Arena *arena) {
+  StringBuffer borrowed = {.data = input.data, .cap = 0, .len = input.len};
+  JsonDecoder d = {
+      .lexer = lexer_new(&borrowed),
+      .arena = arena,
+  };
+  lexer_advance(&d.lexer);
+  if (!json_decode_value(&d, JSON_DECODE_OBJECT, JSON_DECODE_OBJECT, schema,
+                         dest)) {
+    return false;
+  }
+  lexer_skip_whitespace(&d.lexer);
+  if (d.lexer.cur != d.lexer.end) {
+    return json_decode_error(&d, "end of input");
+  }
+  return true;
+}
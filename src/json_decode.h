@@ -0,0 +1,73 @@
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "arena.h"
+#include "json.h"
+
+#ifndef _JSON_DECODE_H
+#define _JSON_DECODE_H
+
+#define JSON_DECODE_ARRAY_CAP_INIT 4
+
+// C types written for each kind: int64_t, uint64_t, double, bool,
+// StringView, a nested struct and JsonDecodedArray.
+typedef enum {
+  JSON_DECODE_INT64,
+  JSON_DECODE_UINT64,
+  JSON_DECODE_DOUBLE,
+  JSON_DECODE_BOOL,
+  JSON_DECODE_STRING,
+  JSON_DECODE_OBJECT,
+  JSON_DECODE_ARRAY,
+} JsonDecodeType;
+
+typedef struct JsonSchema JsonSchema;
+
+// item is the element kind of an array, schema describes nested objects and
+// arrays of objects. Arrays of arrays are not supported.
+typedef struct {
+  StringView key;
+  JsonDecodeType type;
+  size_t offset;
+  JsonDecodeType item;
+  const JsonSchema *schema;
+} JsonField;
+
+struct JsonSchema {
+  const JsonField *fields;
+  size_t len;
+  size_t size;
+};
+
+typedef struct {
+  void *items;
+  size_t len;
+} JsonDecodedArray;
+
+#define JSON_FIELD_KEY(T, member, name, decode_type)                           \
+  {                                                                            \
+    .key = {name, sizeof(name) - 1}, .type = decode_type,                      \
+    .offset = offsetof(T, member)                                              \
+  }
+#define JSON_FIELD(T, member, decode_type)                                     \
+  JSON_FIELD_KEY(T, member, #member, decode_type)
+#define JSON_FIELD_OBJECT(T, member, nested)                                   \
+  {                                                                            \
+    .key = {#member, sizeof(#member) - 1}, .type = JSON_DECODE_OBJECT,         \
+    .offset = offsetof(T, member), .schema = &(nested)                         \
+  }
+#define JSON_FIELD_ARRAY(T, member, item_type, nested)                         \
+  {                                                                            \
+    .key = {#member, sizeof(#member) - 1}, .type = JSON_DECODE_ARRAY,          \
+    .offset = offsetof(T, member), .item = item_type, .schema = nested         \
+  }
+#define JSON_SCHEMA(T, field_list)                                             \
+  {                                                                            \
+    .fields = field_list,                                                      \
+    .len = sizeof(field_list) / sizeof((field_list)[0]), .size = sizeof(T)     \
+  }
+
+bool json_decode(StringView input, const JsonSchema *schema, void *dest,
+                 Arena *arena);
+
+#endif // _JSON_DECODE_H
@@ -0,0 +1,208 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "json_escape.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define JSON_ESCAPE_BLOCK_SIZE 16
+
+static int json_hex_digit(char ch) {
+  if (ch >= '0' && ch <= '9') {
+    return ch - '0';
+  } else if (ch >= 'a' && ch <= 'f') {
+    return ch - 'a' + 10;
+  } else if (ch >= 'A' && ch <= 'F') {
+    return ch - 'A' + 10;
+  }
+  return -1;
+}
+
+static bool json_read_hex4(const char *src, uint32_t *dest) {
+  uint32_t out = 0;
+  for (size_t i = 0; i < 4; ++i) {
+    int digit = json_hex_digit(src[i]);
+    if (digit < 0) {
+      return false;
+    }
+    out = (out << 4) | (uint32_t)digit;
+  }
+  *dest = out;
+  return true;
+}
+
+static size_t json_write_utf8(uint32_t cp, char *dest) {
+  if (cp < 0x80) {
+    dest[0] = (char)cp;
+    return 1;
+  } else if (cp < 0x800) {
+    dest[0] = (char)(0xC0 | (cp >> 6));
+    dest[1] = (char)(0x80 | (cp & 0x3F));
+    return 2;
+  } else if (cp < 0x10000) {
+    dest[0] = (char)(0xE0 | (cp >> 12));
+    dest[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    dest[2] = (char)(0x80 | (cp & 0x3F));
+    return 3;
+  }
+  dest[0] = (char)(0xF0 | (cp >> 18));
+  dest[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+  dest[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+  dest[3] = (char)(0x80 | (cp & 0x3F));
+  return 4;
+}
+
+// Decoded output is never longer than the input so dest may alias src. Runs
+// without escapes are moved in bulk.
+ssize_t json_unescape(const char *src, size_t len, char *dest) {
+  size_t i = 0;
+  size_t out = 0;
+  while (i < len) {
+    size_t run = json_escape_scan(src + i, len - i);
+    if (run > 0) {
+      if (dest + out != src + i) {
+        memmove(dest + out, src + i, run);
+      }
+      out += run;
+      i += run;
+      continue;
+    }
+    if (src[i] != '\\') {
+      dest[out++] = src[i++];
+      continue;
+    }
+    if (i + 1 >= len) {
+      return -1;
+    }
+    char ch = src[i + 1];
+    i += 2;
+    switch (ch) {
+    case '"':
+    case '\\':
+    case '/':
+      dest[out++] = ch;
+      break;
+    case 'b':
+      dest[out++] = '\b';
+      break;
+    case 'f':
+      dest[out++] = '\f';
+      break;
+    case 'n':
+      dest[out++] = '\n';
+      break;
+    case 'r':
+      dest[out++] = '\r';
+      break;
+    case 't':
+      dest[out++] = '\t';
+      break;
+    case 'u': {
+      uint32_t cp;
+      if (i + 4 > len || !json_read_hex4(src + i, &cp)) {
+        return -1;
+      }
+      i += 4;
+      if (cp >= 0xD800 && cp <= 0xDBFF) {
+        uint32_t low;
+        if (i + 6 > len || src[i] != '\\' || src[i + 1] != 'u' ||
+            !json_read_hex4(src + i + 2, &low) || low < 0xDC00 ||
+            low > 0xDFFF) {
+          return -1;
+        }
+        i += 6;
+        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+      } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+        return -1;
+      }
+      out += json_write_utf8(cp, dest + out);
+    } break;
+    default:
+      return -1;
+    }
+  }
+  return (ssize_t)out;
+}
+
+// Index of the first byte that must be escaped on output: '"', '\\' or a
+// control character. len if there is none. The same bytes end a run of plain
+// string body on input, where a raw control character is an error. Checks 16
+// bytes per step where SSE2 is available.
+size_t json_escape_scan(const char *src, size_t len) {
+  size_t i = 0;
+#ifdef __SSE2__
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i control_max = _mm_set1_epi8(0x1F);
+  for (; i + JSON_ESCAPE_BLOCK_SIZE <= len; i += JSON_ESCAPE_BLOCK_SIZE) {
+    __m128i block = _mm_loadu_si128((const __m128i *)(src + i));
+    __m128i control =
+        _mm_cmpeq_epi8(_mm_max_epu8(block, control_max), control_max);
+    int mask = _mm_movemask_epi8(
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, quote),
+                                  _mm_cmpeq_epi8(block, backslash)),
+                     control));
+    if (mask != 0) {
+      return i + (size_t)__builtin_ctz((unsigned)mask);
+    }
+  }
+#endif
+  for (; i < len; ++i) {
+    unsigned char ch = (unsigned char)src[i];
+    if (ch < 0x20 || ch == '"' || ch == '\\') {
+      return i;
+    }
+  }
+  return len;
+}
+
+size_t json_escape_char(char ch, char *dest) {
+  static const char hex[] = "0123456789abcdef";
+  dest[0] = '\\';
+  switch (ch) {
+  case '"':
+  case '\\':
+    dest[1] = ch;
+    return 2;
+  case '\b':
+    dest[1] = 'b';
+    return 2;
+  case '\f':
+    dest[1] = 'f';
+    return 2;
+  case '\n':
+    dest[1] = 'n';
+    return 2;
+  case '\r':
+    dest[1] = 'r';
+    return 2;
+  case '\t':
+    dest[1] = 't';
+    return 2;
+  default:
+    memcpy(dest + 1, "u00", 3);
+    dest[4] = hex[((unsigned char)ch >> 4) & 0xF];
+    dest[5] = hex[(unsigned char)ch & 0xF];
+    return JSON_ESCAPE_MAX_GROWTH;
+  }
+}
+
+// dest needs room for len * JSON_ESCAPE_MAX_GROWTH bytes, no quotes are
+// added.
+size_t json_escape(const char *src, size_t len, char *dest) {
+  size_t i = 0;
+  size_t out = 0;
+  while (i < len) {
+    size_t run = json_escape_scan(src + i, len - i);
+    memcpy(dest + out, src + i, run);
+    out += run;
+    i += run;
+    if (i < len) {
+      out += json_escape_char(src[i++], dest + out);
+    }
+  }
+  return out;
+}
@@ -0,0 +1,15 @@
+#include <stddef.h>
+#include <sys/types.h>
+
+#ifndef _JSON_ESCAPE_H
+#define _JSON_ESCAPE_H
+
+// Longest escape sequence written for one input byte, "\u00XX".
+#define JSON_ESCAPE_MAX_GROWTH 6
+
+ssize_t json_unescape(const char *src, size_t len, char *dest);
+size_t json_escape_scan(const char *src, size_t len);
+size_t json_escape_char(char ch, char *dest);
+size_t json_escape(const char *src, size_t len, char *dest);
+
+#endif // _JSON_ESCAPE_H
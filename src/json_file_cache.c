@@ -0,0 +1,236 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "json_file_cache.h"
+#include "logger.h"
+#include "mem.h"
+
+JsonFileCache *json_file_cache_new(size_t budget) {
+  JsonFileCache *cache = mem_malloc(sizeof(JsonFileCache));
+  JsonFileCacheEntry **buckets =
+      mem_calloc(JSON_FILE_CACHE_BUCKETS_INIT, sizeof(JsonFileCacheEntry *));
+  if (cache == NULL || buckets == NULL) {
+    logger_log(LOG_FATAL, "json_file_cache_new malloc err");
+  }
+  *cache = (JsonFileCache){
+      .buckets = buckets,
+      .nbuckets = JSON_FILE_CACHE_BUCKETS_INIT,
+      .budget = budget,
+  };
+  pthread_mutex_init(&cache->lock, NULL);
+  return cache;
+}
+
+JsonDocument *json_document_retain(JsonDocument *doc) {
+  atomic_fetch_add(&doc->refs, 1);
+  return doc;
+}
+
+void json_document_release(JsonDocument *doc) {
+  if (doc != NULL && atomic_fetch_sub(&doc->refs, 1) == 1) {
+    arena_free(doc->arena);
+    mem_free(doc);
+  }
+}
+
+// The document is parsed into its own arena, so its size is known and it is
+// freed in one go. It is charged for the chunks the arena holds, not just the
+// bytes handed out, small files still cost a whole chunk.
+static JsonDocument *json_document_load(const char *path) {
+  SbFileMap map;
+  if (!sb_file_map(path, &map)) {
+    return NULL;
+  }
+  JsonDocument *doc = mem_malloc(sizeof(JsonDocument));
+  if (doc == NULL) {
+    logger_log(LOG_FATAL, "json_document_load malloc err");
+  }
+  doc->arena = arena_new(0);
+  Allocator allocator = arena_allocator(doc->arena);
+  bool is_success =
+      json_parse_with_allocator(&map.content, &doc->root, &allocator);
+  sb_file_unmap(&map);
+  if (!is_success) {
+    arena_free(doc->arena);
+    mem_free(doc);
+    return NULL;
+  }
+  doc->bytes = sizeof(JsonDocument) + sizeof(Arena) + doc->arena->reserved;
+  atomic_init(&doc->refs, 1);
+  return doc;
+}
+
+static bool json_file_cache_fresh(JsonFileCacheEntry *entry, struct stat *st) {
+  return entry->dev == st->st_dev && entry->ino == st->st_ino &&
+         entry->size == st->st_size &&
+         entry->mtime.tv_sec == st->st_mtim.tv_sec &&
+         entry->mtime.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+static JsonFileCacheEntry *json_file_cache_find(JsonFileCache *cache,
+                                                const char *path,
+                                                size_t hash) {
+  JsonFileCacheEntry *entry = cache->buckets[hash & (cache->nbuckets - 1)];
+  while (entry != NULL &&
+         (entry->hash != hash || strcmp(entry->path, path) != 0)) {
+    entry = entry->bucket_next;
+  }
+  return entry;
+}
+
+static void json_file_cache_unlink(JsonFileCache *cache,
+                                   JsonFileCacheEntry *entry) {
+  if (entry->prev != NULL) {
+    entry->prev->next = entry->next;
+  } else {
+    cache->head = entry->next;
+  }
+  if (entry->next != NULL) {
+    entry->next->prev = entry->prev;
+  } else {
+    cache->tail = entry->prev;
+  }
+  entry->prev = NULL;
+  entry->next = NULL;
+}
+
+static void json_file_cache_push_front(JsonFileCache *cache,
+                                       JsonFileCacheEntry *entry) {
+  entry->next = cache->head;
+  if (cache->head != NULL) {
+    cache->head->prev = entry;
+  } else {
+    cache->tail = entry;
+  }
+  cache->head = entry;
+}
+
+static void json_file_cache_grow(JsonFileCache *cache) {
+  size_t nbuckets = cache->nbuckets * 2;
+  JsonFileCacheEntry **buckets = mem_calloc(nbuckets, sizeof(*buckets));
+  if (buckets == NULL) {
+    logger_log(LOG_FATAL, "json_file_cache_grow malloc err");
+  }
+  for (JsonFileCacheEntry *entry = cache->head; entry != NULL;
+       entry = entry->next) {
+    size_t i = entry->hash & (nbuckets - 1);
+    entry->bucket_next = buckets[i];
+    buckets[i] = entry;
+  }
+  mem_free(cache->buckets);
+  cache->buckets = buckets;
+  cache->nbuckets = nbuckets;
+}
+
+// Drops the cache's reference, handles given out earlier stay valid.
+static void json_file_cache_remove(JsonFileCache *cache,
+                                   JsonFileCacheEntry *entry) {
+  JsonFileCacheEntry **link =
+      &cache->buckets[entry->hash & (cache->nbuckets - 1)];
+  while (*link != entry) {
+    link = &(*link)->bucket_next;
+  }
+  *link = entry->bucket_next;
+  json_file_cache_unlink(cache, entry);
+  cache->len--;
+  cache->bytes -= entry->doc->bytes;
+  json_document_release(entry->doc);
+  mem_free(entry->path);
+  mem_free(entry);
+}
+
+static void json_file_cache_insert(JsonFileCache *cache, const char *path,
+                                   size_t hash, struct stat *st,
+                                   JsonDocument *doc) {
+  JsonFileCacheEntry *entry = mem_malloc(sizeof(JsonFileCacheEntry));
+  size_t path_len = strlen(path);
+  char *path_copy = mem_malloc(path_len + 1);
+  if (entry == NULL || path_copy == NULL) {
+    logger_log(LOG_FATAL, "json_file_cache_insert malloc err");
+  }
+  memcpy(path_copy, path, path_len + 1);
+  *entry = (JsonFileCacheEntry){
+      .path = path_copy,
+      .hash = hash,
+      .dev = st->st_dev,
+      .ino = st->st_ino,
+      .size = st->st_size,
+      .mtime = st->st_mtim,
+      .doc = json_document_retain(doc),
+  };
+  if (cache->len + 1 > cache->nbuckets) {
+    json_file_cache_grow(cache);
+  }
+  size_t i = hash & (cache->nbuckets - 1);
+  entry->bucket_next = cache->buckets[i];
+  cache->buckets[i] = entry;
+  json_file_cache_push_front(cache, entry);
+  cache->len++;
+  cache->bytes += doc->bytes;
+  while (cache->bytes > cache->budget && cache->tail != entry) {
+    json_file_cache_remove(cache, cache->tail);
+    cache->evictions++;
+  }
+}
+
+// Returns a handle the caller releases with json_document_release. The file
+// is checked with stat on every call, a changed path, inode, size or mtime
+// reloads it. Parsing runs without the lock, documents bigger than the
+// whole budget are returned without being cached.
+JsonDocument *json_file_cache_get(JsonFileCache *cache, const char *path) {
+  struct stat st;
+  if (stat(path, &st) != 0) {
+    logger_log(LOG_ERROR, "could not stat file '%s'", path);
+    return NULL;
+  }
+  size_t hash = json_object_hash(sv_new_from_cstr(path));
+
+  pthread_mutex_lock(&cache->lock);
+  JsonFileCacheEntry *entry = json_file_cache_find(cache, path, hash);
+  if (entry != NULL && json_file_cache_fresh(entry, &st)) {
+    json_file_cache_unlink(cache, entry);
+    json_file_cache_push_front(cache, entry);
+    cache->hits++;
+    JsonDocument *doc = json_document_retain(entry->doc);
+    pthread_mutex_unlock(&cache->lock);
+    return doc;
+  }
+  cache->misses++;
+  pthread_mutex_unlock(&cache->lock);
+
+  JsonDocument *doc = json_document_load(path);
+  struct stat after;
+  if (doc == NULL || stat(path, &after) != 0) {
+    json_document_release(doc);
+    return NULL;
+  }
+  if (doc->bytes > cache->budget || st.st_mtim.tv_sec != after.st_mtim.tv_sec ||
+      st.st_mtim.tv_nsec != after.st_mtim.tv_nsec ||
+      st.st_size != after.st_size) {
+    return doc;
+  }
+
+  pthread_mutex_lock(&cache->lock);
+  entry = json_file_cache_find(cache, path, hash);
+  if (entry != NULL && json_file_cache_fresh(entry, &st)) {
+    JsonDocument *cached = json_document_retain(entry->doc);
+    pthread_mutex_unlock(&cache->lock);
+    json_document_release(doc);
+    return cached;
+  }
+  if (entry != NULL) {
+    json_file_cache_remove(cache, entry);
+  }
+  json_file_cache_insert(cache, path, hash, &st, doc);
+  pthread_mutex_unlock(&cache->lock);
+  return doc;
+}
+
+void json_file_cache_free(JsonFileCache *cache) {
+  while (cache->head != NULL) {
+    json_file_cache_remove(cache, cache->head);
+  }
+  mem_free(cache->buckets);
+  pthread_mutex_destroy(&cache->lock);
+  mem_free(cache);
+}
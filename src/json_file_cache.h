@@ -0,0 +1,61 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/stat.h>
+
+#include "arena.h"
+#include "json.h"
+
+#ifndef _JSON_FILE_CACHE_H
+#define _JSON_FILE_CACHE_H
+
+#define JSON_FILE_CACHE_BUCKETS_INIT 16
+
+// A parsed file, read only and shared between threads. The tree lives in
+// arena and goes away with the last reference.
+typedef struct {
+  Json root;
+  Arena *arena;
+  size_t bytes;
+  atomic_size_t refs;
+} JsonDocument;
+
+typedef struct JsonFileCacheEntry {
+  char *path;
+  size_t hash;
+  dev_t dev;
+  ino_t ino;
+  off_t size;
+  struct timespec mtime;
+  JsonDocument *doc;
+  struct JsonFileCacheEntry *bucket_next;
+  struct JsonFileCacheEntry *prev;
+  struct JsonFileCacheEntry *next;
+} JsonFileCacheEntry;
+
+// Entries are found by path through the buckets and kept in LRU order in
+// the list from head (newest) to tail, budget bounds the summed bytes of
+// the cached documents.
+typedef struct {
+  JsonFileCacheEntry **buckets;
+  size_t nbuckets;
+  size_t len;
+  JsonFileCacheEntry *head;
+  JsonFileCacheEntry *tail;
+  size_t bytes;
+  size_t budget;
+  size_t hits;
+  size_t misses;
+  size_t evictions;
+  pthread_mutex_t lock;
+} JsonFileCache;
+
+JsonFileCache *json_file_cache_new(size_t budget);
+void json_file_cache_free(JsonFileCache *cache);
+JsonDocument *json_file_cache_get(JsonFileCache *cache, const char *path);
+
+JsonDocument *json_document_retain(JsonDocument *doc);
+void json_document_release(JsonDocument *doc);
+
+#endif // _JSON_FILE_CACHE_H
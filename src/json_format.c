@@ -0,0 +1,174 @@
+#include <string.h>
+
+#include "json_format.h"
+#include "json_index.h"
+#include "logger.h"
+
+// Feeds the scanner one block, the tail is padded with whitespace and the
+// returned mask covers only the real bytes.
+static uint64_t json_format_scan(JsonScanner *scanner, const char *data,
+                                 size_t n, char *tail, JsonBlock *dest) {
+  if (n < JSON_INDEX_BLOCK_SIZE) {
+    memset(tail, ' ', JSON_INDEX_BLOCK_SIZE);
+    memcpy(tail, data, n);
+    json_scanner_next(scanner, tail, dest);
+    return ((uint64_t)1 << n) - 1;
+  }
+  json_scanner_next(scanner, data, dest);
+  return ~(uint64_t)0;
+}
+
+// Whitespace outside strings is dropped by moving the runs of kept bytes
+// down, the output never overtakes the block being read.
+bool json_minify(StringBuffer *input) {
+  if (sb_is_borrowed(input)) {
+    logger_log(LOG_ERROR, "json_minify can not modify a borrowed buffer");
+    return false;
+  }
+  char *data = (char *)input->data;
+  JsonScanner scanner = json_scanner_new(JSON_INDEX_ISA_AUTO);
+  JsonBlock block;
+  char tail[JSON_INDEX_BLOCK_SIZE];
+  size_t out = 0;
+  for (size_t i = 0; i < input->len; i += JSON_INDEX_BLOCK_SIZE) {
+    size_t n = input->len - i < JSON_INDEX_BLOCK_SIZE ? input->len - i
+                                                      : JSON_INDEX_BLOCK_SIZE;
+    uint64_t valid = json_format_scan(&scanner, data + i, n, tail, &block);
+    uint64_t keep = ~block.whitespace & valid;
+    if (keep == ~(uint64_t)0 && out == i) {
+      out += JSON_INDEX_BLOCK_SIZE;
+      continue;
+    }
+    while (keep) {
+      size_t start = (size_t)__builtin_ctzll(keep);
+      uint64_t rest = ~(keep >> start);
+      size_t run = rest == 0 ? JSON_INDEX_BLOCK_SIZE - start
+                             : (size_t)__builtin_ctzll(rest);
+      memmove(data + out, data + i + start, run);
+      out += run;
+      keep = start + run < JSON_INDEX_BLOCK_SIZE
+                 ? keep & ~(((uint64_t)1 << (start + run)) - 1)
+                 : 0;
+    }
+  }
+  input->len = out;
+  data[out] = '\0';
+  if (json_scanner_in_string(&scanner)) {
+    logger_log(LOG_ERROR, "json_minify unterminated string");
+    return false;
+  }
+  return true;
+}
+
+typedef struct {
+  StringBuffer *dest;
+  size_t indent;
+  size_t depth;
+  bool open_pending;
+} JsonPrettifier;
+
+static void json_prettify_newline(JsonPrettifier *p) {
+  size_t width = p->depth * p->indent;
+  sb_reserve(p->dest, width + 1);
+  char *out = (char *)p->dest->data + p->dest->len;
+  out[0] = '\n';
+  memset(out + 1, ' ', width);
+  out[width + 1] = '\0';
+  p->dest->len += width + 1;
+  p->open_pending = false;
+}
+
+// The line break after an opening bracket waits for the next token so empty
+// containers stay on one line.
+static void json_prettify_run(JsonPrettifier *p, const char *data,
+                              size_t len) {
+  if (len == 0) {
+    return;
+  }
+  if (p->open_pending) {
+    json_prettify_newline(p);
+  }
+  sb_append(p->dest, sv_new(data, len));
+}
+
+static void json_prettify_op(JsonPrettifier *p, char ch) {
+  switch (ch) {
+  case '{':
+  case '[':
+    if (p->open_pending) {
+      json_prettify_newline(p);
+    }
+    sb_append_char(p->dest, ch);
+    p->depth++;
+    p->open_pending = true;
+    break;
+  case '}':
+  case ']':
+    if (p->depth > 0) {
+      p->depth--;
+    }
+    if (p->open_pending) {
+      p->open_pending = false;
+    } else {
+      json_prettify_newline(p);
+    }
+    sb_append_char(p->dest, ch);
+    break;
+  case ',':
+    sb_append_char(p->dest, ',');
+    json_prettify_newline(p);
+    break;
+  case ':':
+    sb_append(p->dest, sv_new(": ", 2));
+    break;
+  default:
+    break;
+  }
+}
+
+static bool json_format_is_op(char ch) {
+  return ch == '{' || ch == '}' || ch == '[' || ch == ']' || ch == ':' ||
+         ch == ',';
+}
+
+// Whitespace and ops outside strings are the only bytes rewritten, the
+// spans between them are copied as they are.
+bool json_prettify(StringView input, size_t indent, StringBuffer *dest) {
+  JsonPrettifier p = {
+      .dest = dest,
+      .indent = indent,
+      .depth = 0,
+      .open_pending = false,
+  };
+  sb_reserve(dest, input.len + input.len / 2);
+  JsonScanner scanner = json_scanner_new(JSON_INDEX_ISA_AUTO);
+  JsonBlock block;
+  char tail[JSON_INDEX_BLOCK_SIZE];
+  size_t copy_from = 0;
+  for (size_t i = 0; i < input.len; i += JSON_INDEX_BLOCK_SIZE) {
+    size_t n = input.len - i < JSON_INDEX_BLOCK_SIZE ? input.len - i
+                                                     : JSON_INDEX_BLOCK_SIZE;
+    uint64_t valid = json_format_scan(&scanner, input.data + i, n, tail,
+                                      &block);
+    uint64_t events =
+        ((block.structural & ~block.quote) | block.whitespace) & valid;
+    while (events) {
+      size_t pos = i + (size_t)__builtin_ctzll(events);
+      events &= events - 1;
+      char ch = input.data[pos];
+      bool is_op = json_format_is_op(ch);
+      if (!is_op && (block.whitespace >> (pos - i) & 1) == 0) {
+        continue;
+      }
+      json_prettify_run(&p, input.data + copy_from, pos - copy_from);
+      copy_from = pos + 1;
+      json_prettify_op(&p, ch);
+    }
+  }
+  json_prettify_run(&p, input.data + copy_from, input.len - copy_from);
+  if (json_scanner_in_string(&scanner)) {
+    logger_log(LOG_ERROR, "json_prettify unterminated string");
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,12 @@
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "string_utils.h"
+
+#ifndef _JSON_FORMAT_H
+#define _JSON_FORMAT_H
+
+bool json_minify(StringBuffer *input);
+bool json_prettify(StringView input, size_t indent, StringBuffer *dest);
+
+#endif // _JSON_FORMAT_H
@@ -0,0 +1,262 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "json_index.h"
+#include "logger.h"
+#include "mem.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define JSON_INDEX_X86
+#include <immintrin.h>
+#endif
+
+static void json_classify_scalar(const char *block, JsonBlockChars *dest) {
+  *dest = (JsonBlockChars){0};
+  for (size_t i = 0; i < JSON_INDEX_BLOCK_SIZE; ++i) {
+    uint64_t bit = (uint64_t)1 << i;
+    switch (block[i]) {
+    case '"':
+      dest->quote |= bit;
+      break;
+    case '\\':
+      dest->backslash |= bit;
+      break;
+    case ' ':
+    case '\t':
+    case '\n':
+    case '\r':
+      dest->whitespace |= bit;
+      break;
+    case '{':
+    case '}':
+    case '[':
+    case ']':
+    case ':':
+    case ',':
+      dest->op |= bit;
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+#ifdef JSON_INDEX_X86
+
+static void json_classify_sse2(const char *block, JsonBlockChars *dest) {
+  *dest = (JsonBlockChars){0};
+  for (size_t i = 0; i < JSON_INDEX_BLOCK_SIZE; i += 16) {
+    __m128i in = _mm_loadu_si128((const __m128i *)(block + i));
+    __m128i ws = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(in, _mm_set1_epi8(' ')),
+                     _mm_cmpeq_epi8(in, _mm_set1_epi8('\t'))),
+        _mm_or_si128(_mm_cmpeq_epi8(in, _mm_set1_epi8('\n')),
+                     _mm_cmpeq_epi8(in, _mm_set1_epi8('\r'))));
+    // '[' and ']' fold onto '{' and '}' once 0x20 is set.
+    __m128i folded = _mm_or_si128(in, _mm_set1_epi8(0x20));
+    __m128i op = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')),
+                     _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+        _mm_or_si128(_mm_cmpeq_epi8(in, _mm_set1_epi8(':')),
+                     _mm_cmpeq_epi8(in, _mm_set1_epi8(','))));
+    dest->whitespace |= (uint64_t)(uint32_t)_mm_movemask_epi8(ws) << i;
+    dest->op |= (uint64_t)(uint32_t)_mm_movemask_epi8(op) << i;
+    dest->quote |=
+        (uint64_t)(uint32_t)_mm_movemask_epi8(
+            _mm_cmpeq_epi8(in, _mm_set1_epi8('"')))
+        << i;
+    dest->backslash |=
+        (uint64_t)(uint32_t)_mm_movemask_epi8(
+            _mm_cmpeq_epi8(in, _mm_set1_epi8('\\')))
+        << i;
+  }
+}
+
+__attribute__((target("avx2"))) static void
+json_classify_avx2(const char *block, JsonBlockChars *dest) {
+  *dest = (JsonBlockChars){0};
+  for (size_t i = 0; i < JSON_INDEX_BLOCK_SIZE; i += 32) {
+    __m256i in = _mm256_loadu_si256((const __m256i *)(block + i));
+    __m256i ws = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(in, _mm256_set1_epi8(' ')),
+                        _mm256_cmpeq_epi8(in, _mm256_set1_epi8('\t'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(in, _mm256_set1_epi8('\n')),
+                        _mm256_cmpeq_epi8(in, _mm256_set1_epi8('\r'))));
+    __m256i folded = _mm256_or_si256(in, _mm256_set1_epi8(0x20));
+    __m256i op = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')),
+                        _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(in, _mm256_set1_epi8(':')),
+                        _mm256_cmpeq_epi8(in, _mm256_set1_epi8(','))));
+    dest->whitespace |= (uint64_t)(uint32_t)_mm256_movemask_epi8(ws) << i;
+    dest->op |= (uint64_t)(uint32_t)_mm256_movemask_epi8(op) << i;
+    dest->quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+                       _mm256_cmpeq_epi8(in, _mm256_set1_epi8('"')))
+                   << i;
+    dest->backslash |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+                           _mm256_cmpeq_epi8(in, _mm256_set1_epi8('\\')))
+                       << i;
+  }
+}
+
+#endif // JSON_INDEX_X86
+
+bool json_index_isa_supported(JsonIndexIsa isa) {
+  switch (isa) {
+  case JSON_INDEX_ISA_AUTO:
+  case JSON_INDEX_ISA_SCALAR:
+    return true;
+#ifdef JSON_INDEX_X86
+  case JSON_INDEX_ISA_SSE2:
+    return __builtin_cpu_supports("sse2");
+  case JSON_INDEX_ISA_AVX2:
+    return __builtin_cpu_supports("avx2");
+#endif
+  default:
+    return false;
+  }
+}
+
+// A forced isa the cpu lacks falls back to the next narrower kernel instead
+// of faulting on an illegal instruction.
+JsonScanner json_scanner_new(JsonIndexIsa isa) {
+  JsonScanner scanner = {
+      .classify = json_classify_scalar,
+  };
+#ifdef JSON_INDEX_X86
+  if (isa == JSON_INDEX_ISA_AUTO) {
+    isa = JSON_INDEX_ISA_AVX2;
+  }
+  if (isa == JSON_INDEX_ISA_AVX2 && !json_index_isa_supported(isa)) {
+    isa = JSON_INDEX_ISA_SSE2;
+  }
+  if (isa == JSON_INDEX_ISA_SSE2 && !json_index_isa_supported(isa)) {
+    isa = JSON_INDEX_ISA_SCALAR;
+  }
+  if (isa == JSON_INDEX_ISA_SSE2) {
+    scanner.classify = json_classify_sse2;
+  } else if (isa == JSON_INDEX_ISA_AVX2) {
+    scanner.classify = json_classify_avx2;
+  }
+#else
+  (void)isa;
+#endif
+  return scanner;
+}
+
+// Bits of chars escaped by an odd run of backslashes.
+static uint64_t json_scanner_escaped(JsonScanner *scanner,
+                                     uint64_t backslash) {
+  const uint64_t even_bits = 0x5555555555555555ULL;
+  backslash &= ~scanner->prev_escaped;
+  uint64_t follows_escape = backslash << 1 | scanner->prev_escaped;
+  uint64_t odd_starts = backslash & ~even_bits & ~follows_escape;
+  uint64_t even_sequences;
+  scanner->prev_escaped =
+      __builtin_add_overflow(odd_starts, backslash, &even_sequences);
+  uint64_t invert_mask = even_sequences << 1;
+  return (even_bits ^ invert_mask) & follows_escape;
+}
+
+static uint64_t json_prefix_xor(uint64_t x) {
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+}
+
+// Structural bits are ops and quotes outside of strings plus the first byte
+// of every number or keyword.
+void json_scanner_next(JsonScanner *scanner, const char *block,
+                       JsonBlock *dest) {
+  JsonBlockChars chars;
+  scanner->classify(block, &chars);
+
+  uint64_t escaped = json_scanner_escaped(scanner, chars.backslash);
+  uint64_t quote = chars.quote & ~escaped;
+  uint64_t in_string = json_prefix_xor(quote) ^ scanner->prev_in_string;
+  scanner->prev_in_string = (uint64_t)((int64_t)in_string >> 63);
+
+  uint64_t op = chars.op & ~in_string;
+  uint64_t whitespace = chars.whitespace & ~in_string;
+  uint64_t scalar = ~(op | whitespace | quote | in_string);
+  uint64_t follows_scalar = scalar << 1 | scanner->prev_scalar;
+  scanner->prev_scalar = scalar >> 63;
+
+  *dest = (JsonBlock){
+      .structural = op | quote | (scalar & ~follows_scalar),
+      .quote = quote,
+      .in_string = in_string,
+      .whitespace = whitespace,
+  };
+}
+
+bool json_scanner_in_string(JsonScanner *scanner) {
+  return scanner->prev_in_string != 0;
+}
+
+static void json_index_reserve(JsonIndex *index, size_t extra) {
+  if (index->len + extra <= index->cap) {
+    return;
+  }
+  size_t new_cap = index->cap * 2 + extra;
+  index->positions = mem_realloc(index->positions, new_cap * sizeof(uint32_t));
+  if (index->positions == NULL) {
+    logger_log(LOG_FATAL, "json_index_reserve realloc err");
+  }
+  index->cap = new_cap;
+}
+
+static void json_index_flatten(JsonIndex *index, uint64_t bits, size_t base) {
+  json_index_reserve(index, JSON_INDEX_BLOCK_SIZE);
+  uint32_t *out = index->positions + index->len;
+  while (bits) {
+    *out++ = (uint32_t)(base + (size_t)__builtin_ctzll(bits));
+    bits &= bits - 1;
+  }
+  index->len = (size_t)(out - index->positions);
+}
+
+bool json_index_build(StringView input, JsonIndex *index) {
+  return json_index_build_isa(input, index, JSON_INDEX_ISA_AUTO);
+}
+
+// Fails for inputs with an unterminated string or too large for 32 bit
+// offsets, callers then parse without an index.
+bool json_index_build_isa(StringView input, JsonIndex *index,
+                          JsonIndexIsa isa) {
+  *index = (JsonIndex){0};
+  if (input.len >= UINT32_MAX) {
+    return false;
+  }
+  json_index_reserve(index, input.len / 8 + JSON_INDEX_BLOCK_SIZE);
+
+  JsonScanner scanner = json_scanner_new(isa);
+  JsonBlock block;
+  size_t i = 0;
+  for (; i + JSON_INDEX_BLOCK_SIZE <= input.len; i += JSON_INDEX_BLOCK_SIZE) {
+    json_scanner_next(&scanner, input.data + i, &block);
+    json_index_flatten(index, block.structural, i);
+  }
+  if (i < input.len) {
+    char tail[JSON_INDEX_BLOCK_SIZE];
+    memset(tail, ' ', sizeof(tail));
+    memcpy(tail, input.data + i, input.len - i);
+    json_scanner_next(&scanner, tail, &block);
+    json_index_flatten(index, block.structural, i);
+  }
+
+  if (json_scanner_in_string(&scanner)) {
+    json_index_free(index);
+    return false;
+  }
+  return true;
+}
+
+void json_index_free(JsonIndex *index) {
+  mem_free(index->positions);
+  *index = (JsonIndex){0};
+}
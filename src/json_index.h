@@ -0,0 +1,58 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "string_utils.h"
+
+#ifndef _JSON_INDEX_H
+#define _JSON_INDEX_H
+
+#define JSON_INDEX_BLOCK_SIZE 64
+
+typedef enum {
+  JSON_INDEX_ISA_AUTO = 0,
+  JSON_INDEX_ISA_SCALAR,
+  JSON_INDEX_ISA_SSE2,
+  JSON_INDEX_ISA_AVX2,
+} JsonIndexIsa;
+
+// Raw character classes of one 64 byte block, bit i is byte i.
+typedef struct {
+  uint64_t quote;
+  uint64_t backslash;
+  uint64_t whitespace;
+  uint64_t op;
+} JsonBlockChars;
+
+typedef struct {
+  uint64_t structural;
+  uint64_t quote;
+  uint64_t in_string;
+  uint64_t whitespace;
+} JsonBlock;
+
+// Carries escape, string and scalar state between consecutive blocks.
+typedef struct {
+  void (*classify)(const char *block, JsonBlockChars *dest);
+  uint64_t prev_escaped;
+  uint64_t prev_in_string;
+  uint64_t prev_scalar;
+} JsonScanner;
+
+// Offsets of every structural char, quote and scalar start in the input.
+typedef struct {
+  uint32_t *positions;
+  size_t len;
+  size_t cap;
+} JsonIndex;
+
+bool json_index_isa_supported(JsonIndexIsa isa);
+JsonScanner json_scanner_new(JsonIndexIsa isa);
+void json_scanner_next(JsonScanner *scanner, const char *block,
+                       JsonBlock *dest);
+bool json_scanner_in_string(JsonScanner *scanner);
+
+bool json_index_build(StringView input, JsonIndex *index);
+bool json_index_build_isa(StringView input, JsonIndex *index, JsonIndexIsa isa);
+void json_index_free(JsonIndex *index);
+
+#endif // _JSON_INDEX_H
@@ -0,0 +1,253 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "dynamic_array.h"
+#include "json_lines.h"
+#include "logger.h"
+#include "mem.h"
+
+typedef struct {
+  Json value;
+  size_t offset;
+} JsonLine;
+
+typedef DYNAMIC_ARRAY(JsonLine) JsonLineValues;
+
+// Values of a chunk stay in its arena until they are delivered.
+typedef struct {
+  size_t start;
+  size_t end;
+  Arena *arena;
+  Allocator allocator;
+  JsonLineValues values;
+  bool done;
+} JsonLinesChunk;
+
+typedef DYNAMIC_ARRAY(JsonLinesChunk) JsonLinesChunks;
+
+// In order mode workers claim at most window chunks past next_delivery and
+// wait on delivered otherwise, finished chunks waiting for an earlier one are
+// bounded by the thread count instead of the input size.
+typedef struct {
+  StringView input;
+  JsonLinesHandler *handler;
+  JsonLinesChunks chunks;
+  size_t next_chunk;
+  atomic_size_t next_delivery;
+  size_t window;
+  atomic_bool failed;
+  pthread_mutex_t lock;
+  pthread_mutex_t delivery_lock;
+  pthread_cond_t delivered;
+} JsonLinesJob;
+
+// Chunks end right after a newline so no line is split between workers.
+static void json_lines_split(JsonLinesJob *job, size_t nthreads) {
+  StringView input = job->input;
+  size_t target = input.len / (nthreads * JSON_LINES_CHUNKS_PER_THREAD);
+  if (target < JSON_LINES_CHUNK_MIN) {
+    target = JSON_LINES_CHUNK_MIN;
+  } else if (target > JSON_LINES_CHUNK_MAX) {
+    target = JSON_LINES_CHUNK_MAX;
+  }
+  JsonLinesChunks *chunks = &job->chunks;
+  size_t start = 0;
+  while (start < input.len) {
+    size_t end = input.len;
+    if (input.len - start > target) {
+      const char *newline = memchr(input.data + start + target, '\n',
+                                   input.len - start - target);
+      if (newline != NULL) {
+        end = (size_t)(newline - input.data) + 1;
+      }
+    }
+    JsonLinesChunk chunk = {.start = start, .end = end};
+    da_append(chunks, chunk);
+    start = end;
+  }
+}
+
+// Exactly one value per line, only whitespace may follow it.
+static bool json_lines_parse_line(StringBuffer *line, JsonKeys *keys,
+                                  Allocator *allocator, Json *dest) {
+  Lexer lexer = lexer_new(line);
+  lexer.allocator = allocator;
+  lexer.zero_copy = true;
+  lexer.keys = keys;
+  lexer_advance(&lexer);
+  if (!json_parse_value(&lexer, dest)) {
+    return false;
+  }
+  lexer_skip_whitespace(&lexer);
+  return lexer.cur == lexer.end;
+}
+
+// Lines of a chunk share one key table. Empty lines are skipped and a
+// trailing '\r' is dropped.
+static bool json_lines_parse_chunk(JsonLinesJob *job, JsonLinesChunk *chunk) {
+  chunk->arena = arena_new(0);
+  chunk->allocator = arena_allocator(chunk->arena);
+  JsonKeys *keys = json_keys_new(&chunk->allocator);
+  JsonLineValues *values = &chunk->values;
+  const char *data = job->input.data;
+  size_t pos = chunk->start;
+  while (pos < chunk->end) {
+    const char *newline = memchr(data + pos, '\n', chunk->end - pos);
+    size_t line_end =
+        newline != NULL ? (size_t)(newline - data) : chunk->end;
+    size_t len = line_end - pos;
+    if (len > 0 && data[line_end - 1] == '\r') {
+      len--;
+    }
+    if (len > 0) {
+      StringBuffer line = {.data = data + pos, .cap = 0, .len = len};
+      JsonLine parsed = {.offset = pos};
+      if (!json_lines_parse_line(&line, keys, &chunk->allocator,
+                                 &parsed.value)) {
+        logger_log(LOG_ERROR, "JSON_LINES invalid value at byte %lu", pos);
+        json_keys_release(keys);
+        return false;
+      }
+      da_append(values, parsed);
+    }
+    pos = line_end + 1;
+  }
+  json_keys_release(keys);
+  return true;
+}
+
+static void json_lines_chunk_free(JsonLinesChunk *chunk) {
+  JsonLineValues *values = &chunk->values;
+  da_free(values);
+  *values = (JsonLineValues){0};
+  arena_free(chunk->arena);
+  chunk->arena = NULL;
+}
+
+static void json_lines_emit(JsonLinesJob *job, JsonLinesChunk *chunk) {
+  JsonLinesHandler *handler = job->handler;
+  for (size_t i = 0; i < chunk->values.len && !job->failed; ++i) {
+    JsonLine *line = &chunk->values.items[i];
+    if (!handler->on_value(&line->value, line->offset, handler->context)) {
+      job->failed = true;
+    }
+  }
+  json_lines_chunk_free(chunk);
+}
+
+// Called with the delivery lock held. In order mode whoever completes the
+// oldest pending chunk delivers every finished chunk after it as well.
+static void json_lines_deliver(JsonLinesJob *job, size_t i) {
+  if (!job->handler->ordered) {
+    json_lines_emit(job, &job->chunks.items[i]);
+    return;
+  }
+  while (job->next_delivery < job->chunks.len &&
+         job->chunks.items[job->next_delivery].done) {
+    json_lines_emit(job, &job->chunks.items[job->next_delivery++]);
+  }
+}
+
+static void *json_lines_worker(void *arg) {
+  JsonLinesJob *job = arg;
+  while (true) {
+    pthread_mutex_lock(&job->lock);
+    size_t i = job->next_chunk++;
+    while (job->handler->ordered && !job->failed && i < job->chunks.len &&
+           i >= job->next_delivery + job->window) {
+      pthread_cond_wait(&job->delivered, &job->lock);
+    }
+    bool stop = job->failed || i >= job->chunks.len;
+    pthread_mutex_unlock(&job->lock);
+    if (stop) {
+      return NULL;
+    }
+
+    JsonLinesChunk *chunk = &job->chunks.items[i];
+    bool is_success = json_lines_parse_chunk(job, chunk);
+
+    pthread_mutex_lock(&job->delivery_lock);
+    chunk->done = true;
+    json_lines_deliver(job, i);
+    if (!is_success) {
+      job->failed = true;
+    }
+    pthread_mutex_unlock(&job->delivery_lock);
+
+    // Taking the lock orders the wakeup after the waiters' check.
+    if (job->handler->ordered) {
+      pthread_mutex_lock(&job->lock);
+      pthread_cond_broadcast(&job->delivered);
+      pthread_mutex_unlock(&job->lock);
+    }
+  }
+}
+
+// nthreads 0 uses every online cpu. Values of one chunk are parsed into its
+// own arena. Delivery is serialized under its own lock, so a slow handler
+// does not keep the other workers from claiming chunks.
+bool json_parse_lines(StringView input, size_t nthreads,
+                      JsonLinesHandler *handler) {
+  if (nthreads == 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    nthreads = cpus > 0 ? (size_t)cpus : 1;
+  }
+  JsonLinesJob job = {
+      .input = input,
+      .handler = handler,
+      .window = nthreads * JSON_LINES_REORDER_CHUNKS_PER_THREAD,
+  };
+  pthread_mutex_init(&job.lock, NULL);
+  pthread_mutex_init(&job.delivery_lock, NULL);
+  pthread_cond_init(&job.delivered, NULL);
+  json_lines_split(&job, nthreads);
+  if (nthreads > job.chunks.len) {
+    nthreads = job.chunks.len;
+  }
+
+  pthread_t *threads = mem_malloc(nthreads * sizeof(pthread_t));
+  if (nthreads > 0 && threads == NULL) {
+    logger_log(LOG_FATAL, "json_parse_lines malloc err");
+  }
+  size_t started = 0;
+  for (; started + 1 < nthreads; ++started) {
+    if (pthread_create(&threads[started], NULL, json_lines_worker, &job) !=
+        0) {
+      logger_log(LOG_WARNING, "json_parse_lines could not start a thread");
+      break;
+    }
+  }
+  json_lines_worker(&job);
+  for (size_t i = 0; i < started; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+  mem_free(threads);
+
+  for (size_t i = 0; i < job.chunks.len; ++i) {
+    if (job.chunks.items[i].arena != NULL) {
+      json_lines_chunk_free(&job.chunks.items[i]);
+    }
+  }
+  JsonLinesChunks *chunks = &job.chunks;
+  da_free(chunks);
+  pthread_mutex_destroy(&job.lock);
+  pthread_mutex_destroy(&job.delivery_lock);
+  pthread_cond_destroy(&job.delivered);
+  return !job.failed;
+}
+
+bool json_parse_lines_parallel(const char *path, size_t nthreads,
+                               JsonLinesHandler *handler) {
+  SbFileMap map;
+  if (!sb_file_map(path, &map)) {
+    return false;
+  }
+  bool is_success = json_parse_lines(
+      sv_new(map.content.data, map.content.len), nthreads, handler);
+  sb_file_unmap(&map);
+  return is_success;
+}
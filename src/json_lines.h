@@ -0,0 +1,30 @@
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "json.h"
+
+#ifndef _JSON_LINES_H
+#define _JSON_LINES_H
+
+#define JSON_LINES_CHUNKS_PER_THREAD 8
+#define JSON_LINES_CHUNK_MIN (64 * 1024)
+#define JSON_LINES_CHUNK_MAX (4 * 1024 * 1024)
+#define JSON_LINES_REORDER_CHUNKS_PER_THREAD 2
+
+// offset is the byte offset of the line in the input. The value lives in
+// the chunk's arena and is only valid during the call. Calls never overlap,
+// returning false stops the parse.
+typedef bool (*JsonLinesCallback)(Json *value, size_t offset, void *context);
+
+typedef struct {
+  JsonLinesCallback on_value;
+  void *context;
+  bool ordered;
+} JsonLinesHandler;
+
+bool json_parse_lines_parallel(const char *path, size_t nthreads,
+                               JsonLinesHandler *handler);
+bool json_parse_lines(StringView input, size_t nthreads,
+                      JsonLinesHandler *handler);
+
+#endif // _JSON_LINES_H
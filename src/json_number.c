@@ -0,0 +1,549 @@
+#include <locale.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json_number.h"
+#include "json_number_pow10.h"
+#include "json_number_pow5.h"
+#include "logger.h"
+#include "mem.h"
+
+#define JSON_DOUBLE_MANTISSA_BITS 52
+#define JSON_DOUBLE_INFINITE_POWER 0x7FF
+#define JSON_DOUBLE_EXPONENT_BIAS (0x3FF + JSON_DOUBLE_MANTISSA_BITS)
+#define JSON_DOUBLE_HIDDEN_BIT ((uint64_t)1 << JSON_DOUBLE_MANTISSA_BITS)
+
+#ifdef __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 json_uint128;
+#endif
+
+static const double json_pow10_exact[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static bool json_is_digit(char ch) { return ch >= '0' && ch <= '9'; }
+
+static uint64_t json_mul_64x64(uint64_t a, uint64_t b, uint64_t *hi) {
+#ifdef __SIZEOF_INT128__
+  json_uint128 r = (json_uint128)a * b;
+  *hi = (uint64_t)(r >> 64);
+  return (uint64_t)r;
+#else
+  uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+  uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+  uint64_t lo_lo = a_lo * b_lo;
+  uint64_t hi_lo = a_hi * b_lo;
+  uint64_t lo_hi = a_lo * b_hi;
+  uint64_t hi_hi = a_hi * b_hi;
+  uint64_t cross = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi;
+  *hi = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+  return (cross << 32) | (uint32_t)lo_lo;
+#endif
+}
+
+// Eisel-Lemire, returns the unsigned bit pattern of w * 10^q rounded to
+// nearest even. Exact for w below 10^19.
+static uint64_t json_eisel_lemire(int64_t q, uint64_t w) {
+  if (w == 0 || q < JSON_POW5_MIN_EXP) {
+    return 0;
+  }
+  if (q > JSON_POW5_MAX_EXP) {
+    return (uint64_t)JSON_DOUBLE_INFINITE_POWER << JSON_DOUBLE_MANTISSA_BITS;
+  }
+
+  int lz = __builtin_clzll(w);
+  w <<= lz;
+
+  size_t idx = 2 * (size_t)(q - JSON_POW5_MIN_EXP);
+  uint64_t hi;
+  uint64_t lo = json_mul_64x64(w, json_pow5_128[idx], &hi);
+  const uint64_t precision_mask = UINT64_MAX >> (JSON_DOUBLE_MANTISSA_BITS + 3);
+  if ((hi & precision_mask) == precision_mask) {
+    uint64_t second_hi;
+    json_mul_64x64(w, json_pow5_128[idx + 1], &second_hi);
+    lo += second_hi;
+    if (second_hi > lo) {
+      hi++;
+    }
+  }
+
+  int upperbit = (int)(hi >> 63);
+  int shift = upperbit + 64 - JSON_DOUBLE_MANTISSA_BITS - 3;
+  uint64_t mantissa = hi >> shift;
+  int64_t power2 = (((152170 + 65536) * q) >> 16) + 63 + upperbit - lz + 1023;
+
+  if (power2 <= 0) {
+    if (-power2 + 1 >= 64) {
+      return 0;
+    }
+    mantissa >>= -power2 + 1;
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    // Rounding up may carry into the smallest normal exponent.
+    power2 = mantissa < ((uint64_t)1 << JSON_DOUBLE_MANTISSA_BITS) ? 0 : 1;
+    return (mantissa & (((uint64_t)1 << JSON_DOUBLE_MANTISSA_BITS) - 1)) |
+           (uint64_t)power2 << JSON_DOUBLE_MANTISSA_BITS;
+  }
+
+  // Exactly halfway between two doubles, round down to even.
+  if (lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 &&
+      (mantissa << shift) == hi) {
+    mantissa &= ~(uint64_t)1;
+  }
+
+  mantissa += mantissa & 1;
+  mantissa >>= 1;
+  if (mantissa >= ((uint64_t)2 << JSON_DOUBLE_MANTISSA_BITS)) {
+    mantissa = (uint64_t)1 << JSON_DOUBLE_MANTISSA_BITS;
+    power2++;
+  }
+  mantissa &= ~((uint64_t)1 << JSON_DOUBLE_MANTISSA_BITS);
+  if (power2 >= JSON_DOUBLE_INFINITE_POWER) {
+    return (uint64_t)JSON_DOUBLE_INFINITE_POWER << JSON_DOUBLE_MANTISSA_BITS;
+  }
+  return mantissa | (uint64_t)power2 << JSON_DOUBLE_MANTISSA_BITS;
+}
+
+static double json_bits_to_double(uint64_t bits, bool negative) {
+  bits |= (uint64_t)negative << 63;
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static bool json_decimal_to_double(uint64_t w, int64_t q, bool truncated,
+                                   bool negative, double *dest) {
+  if (!truncated && w <= ((uint64_t)1 << 53) && q >= -22 && q <= 22) {
+    double value = (double)w;
+    value = q < 0 ? value / json_pow10_exact[-q] : value * json_pow10_exact[q];
+    *dest = negative ? -value : value;
+    return true;
+  }
+  uint64_t bits = json_eisel_lemire(q, w);
+  // Dropped digits put the value between w and w + 1.
+  if (truncated && json_eisel_lemire(q, w + 1) != bits) {
+    return false;
+  }
+  *dest = json_bits_to_double(bits, negative);
+  return true;
+}
+
+static locale_t json_c_locale;
+static pthread_once_t json_c_locale_once = PTHREAD_ONCE_INIT;
+
+static void json_c_locale_init(void) {
+  json_c_locale = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+  if (json_c_locale == (locale_t)0) {
+    logger_log(LOG_FATAL, "json_c_locale_init newlocale err");
+  }
+}
+
+// JSON always uses '.' as the decimal point, plain strtod would follow the
+// LC_NUMERIC of the host program and stop at it under a comma locale. The
+// C locale is only switched in for this thread and for this call.
+static double json_strtod_fallback(const char *data, size_t len) {
+  char stack_buf[JSON_NUMBER_FALLBACK_CAP];
+  char *buf = stack_buf;
+  if (len >= sizeof(stack_buf)) {
+    buf = mem_malloc(len + 1);
+    if (buf == NULL) {
+      logger_log(LOG_FATAL, "json_strtod_fallback malloc err");
+    }
+  }
+  memcpy(buf, data, len);
+  buf[len] = '\0';
+  pthread_once(&json_c_locale_once, json_c_locale_init);
+  locale_t prev_locale = uselocale(json_c_locale);
+  double value = strtod(buf, NULL);
+  uselocale(prev_locale);
+  if (buf != stack_buf) {
+    mem_free(buf);
+  }
+  return value;
+}
+
+// Parses one RFC 8259 number from the start of data without copying it.
+// Integers that fit are kept exact, larger ones become doubles.
+bool json_number_parse(const char *data, size_t len, JsonNumber *dest,
+                       size_t *consumed) {
+  const char *p = data;
+  const char *end = data + len;
+
+  bool negative = p < end && *p == '-';
+  if (negative) {
+    p++;
+  }
+  const char *int_start = p;
+  if (p >= end || !json_is_digit(*p)) {
+    return false;
+  }
+  if (*p == '0') {
+    p++;
+  } else {
+    while (p < end && json_is_digit(*p)) {
+      p++;
+    }
+  }
+  const char *int_end = p;
+
+  const char *frac_start = p;
+  const char *frac_end = p;
+  if (p < end && *p == '.') {
+    p++;
+    frac_start = p;
+    while (p < end && json_is_digit(*p)) {
+      p++;
+    }
+    frac_end = p;
+    if (frac_start == frac_end) {
+      return false;
+    }
+  }
+
+  bool has_exp = false;
+  int64_t exp = 0;
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    has_exp = true;
+    p++;
+    bool exp_negative = false;
+    if (p < end && (*p == '+' || *p == '-')) {
+      exp_negative = *p == '-';
+      p++;
+    }
+    if (p >= end || !json_is_digit(*p)) {
+      return false;
+    }
+    while (p < end && json_is_digit(*p)) {
+      if (exp < 100000) {
+        exp = exp * 10 + (*p - '0');
+      }
+      p++;
+    }
+    if (exp_negative) {
+      exp = -exp;
+    }
+  }
+  *consumed = (size_t)(p - data);
+
+  if (frac_start == frac_end && !has_exp) {
+    uint64_t value = 0;
+    bool overflow = false;
+    for (const char *d = int_start; d < int_end && !overflow; ++d) {
+      overflow = __builtin_mul_overflow(value, 10, &value) ||
+                 __builtin_add_overflow(value, (uint64_t)(*d - '0'), &value);
+    }
+    if (!overflow) {
+      if (!negative && value <= (uint64_t)INT64_MAX) {
+        dest->type = JSON_NUMBER_INT;
+        dest->integer = (int64_t)value;
+        return true;
+      } else if (!negative) {
+        dest->type = JSON_NUMBER_UINT;
+        dest->unsigned_integer = value;
+        return true;
+      } else if (value <= (uint64_t)INT64_MAX + 1) {
+        dest->type = JSON_NUMBER_INT;
+        dest->integer = (int64_t)(0 - value);
+        return true;
+      }
+    }
+  }
+
+  uint64_t w = 0;
+  size_t digits = 0;
+  int64_t q = exp;
+  bool truncated = false;
+  for (const char *d = int_start; d < int_end; ++d) {
+    if (w == 0 && *d == '0') {
+      continue;
+    }
+    if (digits < JSON_NUMBER_MAX_DIGITS) {
+      w = w * 10 + (uint64_t)(*d - '0');
+      digits++;
+    } else {
+      q++;
+      truncated = truncated || *d != '0';
+    }
+  }
+  for (const char *d = frac_start; d < frac_end; ++d) {
+    if (w == 0 && *d == '0') {
+      q--;
+      continue;
+    }
+    if (digits < JSON_NUMBER_MAX_DIGITS) {
+      w = w * 10 + (uint64_t)(*d - '0');
+      digits++;
+      q--;
+    } else {
+      truncated = truncated || *d != '0';
+    }
+  }
+
+  dest->type = JSON_NUMBER_DOUBLE;
+  if (!json_decimal_to_double(w, q, truncated, negative, &dest->floating)) {
+    dest->floating = json_strtod_fallback(data, *consumed);
+  }
+  return true;
+}
+
+static const char json_digit_pairs[] = "00010203040506070809"
+                                       "10111213141516171819"
+                                       "20212223242526272829"
+                                       "30313233343536373839"
+                                       "40414243444546474849"
+                                       "50515253545556575859"
+                                       "60616263646566676869"
+                                       "70717273747576777879"
+                                       "80818283848586878889"
+                                       "90919293949596979899";
+
+size_t json_number_format_uint64(uint64_t value, char *dest) {
+  char buf[20];
+  char *p = buf + sizeof(buf);
+  while (value >= 100) {
+    size_t pair = (size_t)(value % 100) * 2;
+    value /= 100;
+    *--p = json_digit_pairs[pair + 1];
+    *--p = json_digit_pairs[pair];
+  }
+  if (value >= 10) {
+    *--p = json_digit_pairs[value * 2 + 1];
+    *--p = json_digit_pairs[value * 2];
+  } else {
+    *--p = (char)('0' + value);
+  }
+  size_t len = (size_t)(buf + sizeof(buf) - p);
+  memcpy(dest, p, len);
+  return len;
+}
+
+size_t json_number_format_int64(int64_t value, char *dest) {
+  if (value < 0) {
+    *dest = '-';
+    return 1 + json_number_format_uint64(0 - (uint64_t)value, dest + 1);
+  }
+  return json_number_format_uint64((uint64_t)value, dest);
+}
+
+// Grisu2 over a 64 bit significand f with binary exponent e.
+typedef struct {
+  uint64_t f;
+  int e;
+} JsonDiyFp;
+
+static JsonDiyFp json_diy_fp_mul(JsonDiyFp a, JsonDiyFp b) {
+  uint64_t hi;
+  uint64_t lo = json_mul_64x64(a.f, b.f, &hi);
+  return (JsonDiyFp){hi + (lo >> 63), a.e + b.e + 64};
+}
+
+static JsonDiyFp json_diy_fp_normalize(JsonDiyFp x) {
+  int shift = __builtin_clzll(x.f);
+  return (JsonDiyFp){x.f << shift, x.e - shift};
+}
+
+// Boundaries halfway to the neighbouring doubles, sharing plus's exponent.
+static void json_diy_fp_boundaries(JsonDiyFp v, JsonDiyFp *minus,
+                                   JsonDiyFp *plus) {
+  *plus = json_diy_fp_normalize((JsonDiyFp){(v.f << 1) + 1, v.e - 1});
+  *minus = v.f == JSON_DOUBLE_HIDDEN_BIT
+               ? (JsonDiyFp){(v.f << 2) - 1, v.e - 2}
+               : (JsonDiyFp){(v.f << 1) - 1, v.e - 1};
+  minus->f <<= minus->e - plus->e;
+  minus->e = plus->e;
+}
+
+// Picks the cached 10^-k that moves e into [-60, -32].
+static JsonDiyFp json_cached_pow10(int e, int *k) {
+  double dk = (-61 - e) * 0.30102999566398114 + 347;
+  int ik = (int)dk;
+  if (dk - ik > 0.0) {
+    ik++;
+  }
+  size_t idx = (size_t)((ik >> 3) + 1);
+  *k = -(JSON_POW10_CACHED_MIN_EXP + (int)idx * JSON_POW10_CACHED_STEP);
+  return (JsonDiyFp){json_pow10_cached_significand[idx],
+                     json_pow10_cached_exponent[idx]};
+}
+
+static const uint64_t json_pow10_u64[] = {
+    1ULL,
+    10ULL,
+    100ULL,
+    1000ULL,
+    10000ULL,
+    100000ULL,
+    1000000ULL,
+    10000000ULL,
+    100000000ULL,
+    1000000000ULL,
+    10000000000ULL,
+    100000000000ULL,
+    1000000000000ULL,
+    10000000000000ULL,
+    100000000000000ULL,
+    1000000000000000ULL,
+    10000000000000000ULL,
+    100000000000000000ULL,
+    1000000000000000000ULL,
+    10000000000000000000ULL,
+};
+
+static void json_grisu_round(char *buf, size_t len, uint64_t delta,
+                             uint64_t rest, uint64_t ten_kappa,
+                             uint64_t wp_w) {
+  while (rest < wp_w && delta - rest >= ten_kappa &&
+         (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+    buf[len - 1]--;
+    rest += ten_kappa;
+  }
+}
+
+static size_t json_grisu_digits(JsonDiyFp w, JsonDiyFp mp, uint64_t delta,
+                                char *buf, int *k) {
+  const int one_shift = -mp.e;
+  const uint64_t one_mask = ((uint64_t)1 << one_shift) - 1;
+  const uint64_t wp_w = mp.f - w.f;
+  uint32_t p1 = (uint32_t)(mp.f >> one_shift);
+  uint64_t p2 = mp.f & one_mask;
+  size_t len = 0;
+
+  int kappa = 1;
+  while (kappa < 10 && p1 >= json_pow10_u64[kappa]) {
+    kappa++;
+  }
+  while (kappa > 0) {
+    uint64_t div = json_pow10_u64[kappa - 1];
+    uint32_t d = (uint32_t)(p1 / div);
+    p1 = (uint32_t)(p1 % div);
+    if (d != 0 || len != 0) {
+      buf[len++] = (char)('0' + d);
+    }
+    kappa--;
+    uint64_t rest = ((uint64_t)p1 << one_shift) + p2;
+    if (rest <= delta) {
+      *k += kappa;
+      json_grisu_round(buf, len, delta, rest,
+                       json_pow10_u64[kappa] << one_shift, wp_w);
+      return len;
+    }
+  }
+  for (;;) {
+    p2 *= 10;
+    delta *= 10;
+    char d = (char)(p2 >> one_shift);
+    if (d != 0 || len != 0) {
+      buf[len++] = (char)('0' + d);
+    }
+    p2 &= one_mask;
+    kappa--;
+    if (p2 < delta) {
+      *k += kappa;
+      int idx = -kappa;
+      json_grisu_round(buf, len, delta, p2, (uint64_t)1 << one_shift,
+                       idx < 20 ? wp_w * json_pow10_u64[idx] : 0);
+      return len;
+    }
+  }
+}
+
+// Shortest digits of a positive finite v, v = digits * 10^k.
+static size_t json_grisu2(double value, char *buf, int *k) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  int biased_e = (int)(bits >> JSON_DOUBLE_MANTISSA_BITS);
+  uint64_t significand = bits & (JSON_DOUBLE_HIDDEN_BIT - 1);
+  JsonDiyFp v = biased_e != 0
+                    ? (JsonDiyFp){significand + JSON_DOUBLE_HIDDEN_BIT,
+                                  biased_e - JSON_DOUBLE_EXPONENT_BIAS}
+                    : (JsonDiyFp){significand, 1 - JSON_DOUBLE_EXPONENT_BIAS};
+
+  JsonDiyFp minus, plus;
+  json_diy_fp_boundaries(v, &minus, &plus);
+  JsonDiyFp c_mk = json_cached_pow10(plus.e, k);
+  JsonDiyFp w = json_diy_fp_mul(json_diy_fp_normalize(v), c_mk);
+  JsonDiyFp wp = json_diy_fp_mul(plus, c_mk);
+  JsonDiyFp wm = json_diy_fp_mul(minus, c_mk);
+  wm.f++;
+  wp.f--;
+  return json_grisu_digits(w, wp, wp.f - wm.f, buf, k);
+}
+
+static size_t json_format_exponent(int exp, char *dest) {
+  char *p = dest;
+  if (exp < 0) {
+    *p++ = '-';
+    exp = -exp;
+  }
+  if (exp >= 100) {
+    *p++ = (char)('0' + exp / 100);
+    exp %= 100;
+    *p++ = json_digit_pairs[exp * 2];
+    *p++ = json_digit_pairs[exp * 2 + 1];
+  } else if (exp >= 10) {
+    *p++ = json_digit_pairs[exp * 2];
+    *p++ = json_digit_pairs[exp * 2 + 1];
+  } else {
+    *p++ = (char)('0' + exp);
+  }
+  return (size_t)(p - dest);
+}
+
+// Lays out len digits scaled by 10^k as plain or exponent notation.
+static size_t json_grisu_prettify(char *buf, size_t len, int k) {
+  const int n = (int)len;
+  const int kk = n + k;
+  if (k >= 0 && kk <= 21) {
+    // 1234e7 -> 12340000000.0
+    memset(buf + n, '0', (size_t)k);
+    buf[kk] = '.';
+    buf[kk + 1] = '0';
+    return (size_t)kk + 2;
+  } else if (kk > 0 && kk <= 21) {
+    // 1234e-2 -> 12.34
+    memmove(buf + kk + 1, buf + kk, (size_t)(n - kk));
+    buf[kk] = '.';
+    return len + 1;
+  } else if (kk > -6 && kk <= 0) {
+    // 1234e-6 -> 0.001234
+    size_t offset = (size_t)(2 - kk);
+    memmove(buf + offset, buf, len);
+    buf[0] = '0';
+    buf[1] = '.';
+    memset(buf + 2, '0', offset - 2);
+    return len + offset;
+  } else if (len == 1) {
+    // 1e30
+    buf[1] = 'e';
+    return 2 + json_format_exponent(kk - 1, buf + 2);
+  }
+  // 1234e30 -> 1.234e33
+  memmove(buf + 2, buf + 1, len - 1);
+  buf[1] = '.';
+  buf[len + 1] = 'e';
+  return len + 2 + json_format_exponent(kk - 1, buf + len + 2);
+}
+
+// Shortest digits that read back to the same double, NaN and infinities
+// have no JSON form and become null.
+size_t json_number_format_double(double value, char *dest) {
+  if (value != value || value - value != 0) {
+    memcpy(dest, "null", 4);
+    return 4;
+  }
+  char *p = dest;
+  if (signbit(value)) {
+    *p++ = '-';
+    value = -value;
+  }
+  if (value == 0) {
+    memcpy(p, "0.0", 3);
+    return (size_t)(p - dest) + 3;
+  }
+  int k;
+  size_t len = json_grisu2(value, p, &k);
+  return (size_t)(p - dest) + json_grisu_prettify(p, len, k);
+}
@@ -0,0 +1,32 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef _JSON_NUMBER_H
+#define _JSON_NUMBER_H
+
+#define JSON_NUMBER_MAX_DIGITS 19
+#define JSON_NUMBER_FALLBACK_CAP 128
+// Upper bound for any formatted number, no terminator is written.
+#define JSON_NUMBER_FORMAT_CAP 32
+
+typedef enum {
+  JSON_NUMBER_INT,
+  JSON_NUMBER_UINT,
+  JSON_NUMBER_DOUBLE,
+} JsonNumberType;
+
+typedef struct {
+  JsonNumberType type;
+  int64_t integer;
+  uint64_t unsigned_integer;
+  double floating;
+} JsonNumber;
+
+bool json_number_parse(const char *data, size_t len, JsonNumber *dest,
+                       size_t *consumed);
+size_t json_number_format_int64(int64_t value, char *dest);
+size_t json_number_format_uint64(uint64_t value, char *dest);
+size_t json_number_format_double(double value, char *dest);
+
+#endif // _JSON_NUMBER_H
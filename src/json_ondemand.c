@@ -0,0 +1,249 @@
+#include <string.h>
+
+#include "json_escape.h"
+#include "json_ondemand.h"
+#include "json_sax.h"
+#include "logger.h"
+
+static char json_od_char(JsonOdDocument *doc, size_t pos) {
+  return doc->input->data[doc->index.positions[pos]];
+}
+
+// The input is validated once here, navigation then trusts the index.
+bool json_od_open(StringBuffer *input, JsonOdDocument *doc) {
+  *doc = (JsonOdDocument){.input = input};
+  if (!json_index_build(sv_new(input->data, input->len), &doc->index)) {
+    logger_log(LOG_ERROR, "JSON_PARSE unterminated string or input too large");
+    return false;
+  }
+
+  Lexer lexer = lexer_new(input);
+  lexer_advance(&lexer);
+  JsonSaxHandler handler = {0};
+  bool is_success = json_sax_parse_value(&lexer, &handler);
+  if (is_success) {
+    lexer_skip_whitespace(&lexer);
+    if (lexer.cur != lexer.end) {
+      Location location = lexer_location(&lexer);
+      logger_log(LOG_ERROR,
+                 "JSON_PARSE unexpected trailing ch '%c' at line %lu on "
+                 "offset %lu",
+                 lexer.ch, location.line, location.offset);
+      is_success = false;
+    }
+  }
+  if (!is_success) {
+    json_index_free(&doc->index);
+  }
+  return is_success;
+}
+
+void json_od_close(JsonOdDocument *doc) {
+  json_index_free(&doc->index);
+  sb_free(doc->scratch);
+  sb_free(doc->key_scratch);
+  doc->scratch = NULL;
+  doc->key_scratch = NULL;
+}
+
+JsonOdValue json_od_root(JsonOdDocument *doc) {
+  return (JsonOdValue){.doc = doc, .pos = 0};
+}
+
+// Index entry right after the value at pos. Strings own two entries and
+// containers are skipped by counting brackets, nothing in them is decoded.
+static size_t json_od_skip(JsonOdDocument *doc, size_t pos) {
+  const char *data = doc->input->data;
+  const uint32_t *positions = doc->index.positions;
+  char ch = data[positions[pos]];
+  if (ch == '"') {
+    return pos + 2;
+  } else if (ch != '{' && ch != '[') {
+    return pos + 1;
+  }
+  size_t depth = 1;
+  while (depth > 0) {
+    ch = data[positions[++pos]];
+    if (ch == '{' || ch == '[') {
+      depth++;
+    } else if (ch == '}' || ch == ']') {
+      depth--;
+    }
+  }
+  return pos + 1;
+}
+
+static StringView json_od_string_at(JsonOdDocument *doc, size_t pos,
+                                    StringBuffer **scratch) {
+  const uint32_t *positions = doc->index.positions;
+  const char *start = doc->input->data + positions[pos] + 1;
+  size_t len = positions[pos + 1] - positions[pos] - 1;
+  if (memchr(start, '\\', len) == NULL) {
+    return sv_new(start, len);
+  }
+  if (*scratch == NULL) {
+    *scratch = sb_new_with_custom_cap(len + 1);
+  } else if ((*scratch)->cap < len + 1) {
+    sb_resize(*scratch, len + 1);
+  }
+  ssize_t decoded_len = json_unescape(start, len, (char *)(*scratch)->data);
+  (*scratch)->len = decoded_len < 0 ? 0 : (size_t)decoded_len;
+  return sv_new((*scratch)->data, (*scratch)->len);
+}
+
+static bool json_od_number(JsonOdValue value, JsonNumber *dest) {
+  size_t offset = value.doc->index.positions[value.pos];
+  size_t consumed;
+  return json_number_parse(value.doc->input->data + offset,
+                           value.doc->input->len - offset, dest, &consumed);
+}
+
+JsonType json_od_type(JsonOdValue value) {
+  switch (json_od_char(value.doc, value.pos)) {
+  case '{':
+    return JSON_OBJECT;
+  case '[':
+    return JSON_ARRAY;
+  case '"':
+    return JSON_STRING;
+  case 't':
+    return JSON_TRUE;
+  case 'f':
+    return JSON_FALSE;
+  case 'n':
+    return JSON_NULL;
+  default: {
+    JsonNumber number;
+    if (!json_od_number(value, &number)) {
+      return JSON_EMPTY;
+    }
+    return number.type == JSON_NUMBER_INT    ? JSON_INT
+           : number.type == JSON_NUMBER_UINT ? JSON_UINT
+                                             : JSON_DOUBLE;
+  }
+  }
+}
+
+JsonOdIter json_od_iter(JsonOdValue container) {
+  char ch = json_od_char(container.doc, container.pos);
+  return (JsonOdIter){
+      .doc = container.doc,
+      .pos = container.pos + 1,
+      .type = ch == '{'   ? JSON_OBJECT
+              : ch == '[' ? JSON_ARRAY
+                          : JSON_EMPTY,
+  };
+}
+
+static void json_od_iter_step(JsonOdIter *iter, size_t value_pos) {
+  size_t next = json_od_skip(iter->doc, value_pos);
+  iter->pos = json_od_char(iter->doc, next) == ',' ? next + 1 : next;
+}
+
+// Members are laid out as key quote, key quote, ':', value.
+bool json_od_object_next(JsonOdIter *iter, StringView *key,
+                         JsonOdValue *value) {
+  if (iter->type != JSON_OBJECT || json_od_char(iter->doc, iter->pos) == '}') {
+    return false;
+  }
+  *key = json_od_string_at(iter->doc, iter->pos, &iter->doc->key_scratch);
+  *value = (JsonOdValue){.doc = iter->doc, .pos = iter->pos + 3};
+  json_od_iter_step(iter, value->pos);
+  return true;
+}
+
+bool json_od_array_next(JsonOdIter *iter, JsonOdValue *value) {
+  if (iter->type != JSON_ARRAY || json_od_char(iter->doc, iter->pos) == ']') {
+    return false;
+  }
+  *value = (JsonOdValue){.doc = iter->doc, .pos = iter->pos};
+  json_od_iter_step(iter, value->pos);
+  return true;
+}
+
+bool json_od_object_get(JsonOdValue object, StringView key,
+                        JsonOdValue *dest) {
+  JsonOdIter iter = json_od_iter(object);
+  StringView member;
+  JsonOdValue value;
+  while (json_od_object_next(&iter, &member, &value)) {
+    if (sv_compare(member, key)) {
+      *dest = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool json_od_array_get(JsonOdValue array, size_t i, JsonOdValue *dest) {
+  JsonOdIter iter = json_od_iter(array);
+  JsonOdValue value;
+  for (size_t n = 0; json_od_array_next(&iter, &value); ++n) {
+    if (n == i) {
+      *dest = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool json_od_get_string(JsonOdValue value, StringView *dest) {
+  if (json_od_char(value.doc, value.pos) != '"') {
+    return false;
+  }
+  *dest = json_od_string_at(value.doc, value.pos, &value.doc->scratch);
+  return true;
+}
+
+bool json_od_get_int64(JsonOdValue value, int64_t *dest) {
+  JsonNumber number;
+  if (!json_od_number(value, &number) || number.type != JSON_NUMBER_INT) {
+    return false;
+  }
+  *dest = number.integer;
+  return true;
+}
+
+bool json_od_get_uint64(JsonOdValue value, uint64_t *dest) {
+  JsonNumber number;
+  if (!json_od_number(value, &number)) {
+    return false;
+  }
+  if (number.type == JSON_NUMBER_UINT) {
+    *dest = number.unsigned_integer;
+  } else if (number.type == JSON_NUMBER_INT && number.integer >= 0) {
+    *dest = (uint64_t)number.integer;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Integers are widened.
+bool json_od_get_double(JsonOdValue value, double *dest) {
+  JsonNumber number;
+  if (!json_od_number(value, &number)) {
+    return false;
+  }
+  if (number.type == JSON_NUMBER_DOUBLE) {
+    *dest = number.floating;
+  } else if (number.type == JSON_NUMBER_INT) {
+    *dest = (double)number.integer;
+  } else {
+    *dest = (double)number.unsigned_integer;
+  }
+  return true;
+}
+
+bool json_od_get_bool(JsonOdValue value, bool *dest) {
+  char ch = json_od_char(value.doc, value.pos);
+  if (ch != 't' && ch != 'f') {
+    return false;
+  }
+  *dest = ch == 't';
+  return true;
+}
+
+bool json_od_is_null(JsonOdValue value) {
+  return json_od_char(value.doc, value.pos) == 'n';
+}
@@ -0,0 +1,52 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "json.h"
+#include "json_index.h"
+
+#ifndef _JSON_ONDEMAND_H
+#define _JSON_ONDEMAND_H
+
+// A validated document navigated through its structural index, values are
+// only decoded when read. String views point into the input unless they
+// had escapes, decoded ones stay valid until the next read of the same kind.
+typedef struct {
+  StringBuffer *input;
+  JsonIndex index;
+  StringBuffer *scratch;
+  StringBuffer *key_scratch;
+} JsonOdDocument;
+
+// A value is the index entry of its first char.
+typedef struct {
+  JsonOdDocument *doc;
+  size_t pos;
+} JsonOdValue;
+
+// pos is the next member or element, or the closing bracket.
+typedef struct {
+  JsonOdDocument *doc;
+  size_t pos;
+  JsonType type;
+} JsonOdIter;
+
+bool json_od_open(StringBuffer *input, JsonOdDocument *doc);
+void json_od_close(JsonOdDocument *doc);
+JsonOdValue json_od_root(JsonOdDocument *doc);
+
+JsonType json_od_type(JsonOdValue value);
+bool json_od_object_get(JsonOdValue object, StringView key, JsonOdValue *dest);
+bool json_od_array_get(JsonOdValue array, size_t i, JsonOdValue *dest);
+JsonOdIter json_od_iter(JsonOdValue container);
+bool json_od_object_next(JsonOdIter *iter, StringView *key,
+                         JsonOdValue *value);
+bool json_od_array_next(JsonOdIter *iter, JsonOdValue *value);
+
+bool json_od_get_string(JsonOdValue value, StringView *dest);
+bool json_od_get_int64(JsonOdValue value, int64_t *dest);
+bool json_od_get_uint64(JsonOdValue value, uint64_t *dest);
+bool json_od_get_double(JsonOdValue value, double *dest);
+bool json_od_get_bool(JsonOdValue value, bool *dest);
+bool json_od_is_null(JsonOdValue value);
+
+#endif // _JSON_ONDEMAND_H
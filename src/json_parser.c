@@ -0,0 +1,500 @@
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json_escape.h"
+#include "json_parser.h"
+#include "logger.h"
+#include "mem.h"
+
+static bool json_dom_attach(JsonDomBuilder *dom, Json *node) {
+  if (dom->nodes.len == 0) {
+    dom->root = node;
+    return true;
+  }
+  Json *parent = dom->nodes.items[dom->nodes.len - 1];
+  if (parent->type == JSON_ARRAY) {
+    json_array_append(parent->array, node);
+  } else {
+    json_object_set(parent->object, sv_new(dom->key->data, dom->key->len),
+                    node);
+  }
+  return true;
+}
+
+static bool json_dom_push(JsonDomBuilder *dom, Json *node) {
+  json_dom_attach(dom, node);
+  JsonParserNodes *nodes = &dom->nodes;
+  da_append(nodes, node);
+  return true;
+}
+
+bool _json_dom_object_begin_cb(void *context) {
+  JsonDomBuilder *dom = context;
+  Json *node = json_new_with_allocator(dom->allocator);
+  *node = (Json){
+      .type = JSON_OBJECT,
+      .object = json_object_new_with_allocator(JSON_OBJECT_SIZE_INIT,
+                                               dom->allocator),
+  };
+  return json_dom_push(dom, node);
+}
+
+bool _json_dom_array_begin_cb(void *context) {
+  JsonDomBuilder *dom = context;
+  Json *node = json_new_with_allocator(dom->allocator);
+  *node = (Json){
+      .type = JSON_ARRAY,
+      .array = json_array_new_with_allocator(dom->allocator),
+  };
+  return json_dom_push(dom, node);
+}
+
+bool _json_dom_end_cb(void *context) {
+  JsonDomBuilder *dom = context;
+  dom->nodes.len--;
+  return true;
+}
+
+bool _json_dom_key_cb(StringView key, void *context) {
+  JsonDomBuilder *dom = context;
+  if (dom->key == NULL) {
+    dom->key = sb_new();
+  }
+  sb_clear(dom->key);
+  sb_append(dom->key, key);
+  return true;
+}
+
+bool _json_dom_string_cb(StringView value, void *context) {
+  JsonDomBuilder *dom = context;
+  Json *node = json_new_with_allocator(dom->allocator);
+  *node = (Json){
+      .type = JSON_STRING,
+      .string = json_sb_new(dom->allocator, value.data, value.len),
+  };
+  return json_dom_attach(dom, node);
+}
+
+bool _json_dom_int_cb(int64_t value, void *context) {
+  JsonDomBuilder *dom = context;
+  Json *node = json_new_with_allocator(dom->allocator);
+  *node = (Json){
+      .type = JSON_INT,
+      .num_integer = value,
+  };
+  return json_dom_attach(dom, node);
+}
+
+bool _json_dom_uint_cb(uint64_t value, void *context) {
+  JsonDomBuilder *dom = context;
+  Json *node = json_new_with_allocator(dom->allocator);
+  *node = (Json){
+      .type = JSON_UINT,
+      .num_unsigned = value,
+  };
+  return json_dom_attach(dom, node);
+}
+
+bool _json_dom_double_cb(double value, void *context) {
+  JsonDomBuilder *dom = context;
+  Json *node = json_new_with_allocator(dom->allocator);
+  *node = (Json){
+      .type = JSON_DOUBLE,
+      .num_double = value,
+  };
+  return json_dom_attach(dom, node);
+}
+
+bool _json_dom_bool_cb(bool value, void *context) {
+  JsonDomBuilder *dom = context;
+  Json *node = json_new_with_allocator(dom->allocator);
+  node->type = value ? JSON_TRUE : JSON_FALSE;
+  return json_dom_attach(dom, node);
+}
+
+bool _json_dom_null_cb(void *context) {
+  JsonDomBuilder *dom = context;
+  Json *node = json_new_with_allocator(dom->allocator);
+  node->type = JSON_NULL;
+  return json_dom_attach(dom, node);
+}
+
+static JsonParser *json_parser_alloc() {
+  JsonParser *parser = mem_malloc(sizeof(JsonParser));
+  if (parser == NULL) {
+    logger_log(LOG_FATAL, "json_parser_new malloc err");
+  }
+  *parser = (JsonParser){
+      .state = JSON_PARSER_VALUE,
+      .token = sb_new(),
+  };
+  return parser;
+}
+
+JsonParser *json_parser_new(Allocator *allocator) {
+  JsonParser *parser = json_parser_alloc();
+  parser->dom.allocator = allocator;
+  parser->handler = (JsonSaxHandler){
+      .on_object_begin = _json_dom_object_begin_cb,
+      .on_object_end = _json_dom_end_cb,
+      .on_array_begin = _json_dom_array_begin_cb,
+      .on_array_end = _json_dom_end_cb,
+      .on_key = _json_dom_key_cb,
+      .on_string = _json_dom_string_cb,
+      .on_int = _json_dom_int_cb,
+      .on_uint = _json_dom_uint_cb,
+      .on_double = _json_dom_double_cb,
+      .on_bool = _json_dom_bool_cb,
+      .on_null = _json_dom_null_cb,
+      .context = &parser->dom,
+  };
+  return parser;
+}
+
+JsonParser *json_parser_new_with_handler(JsonSaxHandler *handler) {
+  JsonParser *parser = json_parser_alloc();
+  parser->handler = *handler;
+  return parser;
+}
+
+void json_parser_free(JsonParser *parser) {
+  if (parser == NULL) {
+    return;
+  }
+  json_free_with_allocator(parser->dom.root, parser->dom.allocator);
+  sb_free(parser->dom.key);
+  JsonParserNodes *nodes = &parser->dom.nodes;
+  da_free(nodes);
+  JsonParserFrames *frames = &parser->frames;
+  da_free(frames);
+  sb_free(parser->token);
+  mem_free(parser);
+}
+
+static bool json_parser_fail(JsonParser *parser, const char *reason, char ch) {
+  logger_log(LOG_ERROR, "JSON_PARSE %s '%c' at byte %lu", reason, ch,
+             parser->offset);
+  parser->state = JSON_PARSER_ERROR;
+  return false;
+}
+
+static void json_parser_value_done(JsonParser *parser) {
+  parser->state = parser->frames.len == 0 ? JSON_PARSER_DONE
+                                          : JSON_PARSER_AFTER_VALUE;
+}
+
+static bool json_parser_emit_string(JsonParser *parser, StringView value) {
+  JsonSaxHandler *handler = &parser->handler;
+  if (parser->string_has_escape) {
+    if (parser->token->len == 0) {
+      sb_append(parser->token, value);
+    }
+    ssize_t len = json_unescape(parser->token->data, parser->token->len,
+                                (char *)parser->token->data);
+    if (len < 0) {
+      return json_parser_fail(parser, "invalid escape in string", '\\');
+    }
+    value = sv_new(parser->token->data, (size_t)len);
+  }
+
+  bool is_success;
+  if (parser->token_is_key) {
+    is_success =
+        handler->on_key == NULL || handler->on_key(value, handler->context);
+    parser->state = JSON_PARSER_COLON;
+  } else {
+    is_success = handler->on_string == NULL ||
+                 handler->on_string(value, handler->context);
+    json_parser_value_done(parser);
+  }
+  sb_clear(parser->token);
+  if (!is_success) {
+    parser->state = JSON_PARSER_ERROR;
+  }
+  return is_success;
+}
+
+static bool json_parser_emit_number(JsonParser *parser, StringView number) {
+  JsonNumber value;
+  size_t consumed;
+  if (!json_number_parse(number.data, number.len, &value, &consumed)) {
+    return json_parser_fail(parser, "invalid number at", number.data[0]);
+  }
+  if (consumed != number.len) {
+    return json_parser_fail(parser, "invalid number at", number.data[consumed]);
+  }
+  bool is_success = json_sax_emit_number(&parser->handler, &value);
+  sb_clear(parser->token);
+  json_parser_value_done(parser);
+  if (!is_success) {
+    parser->state = JSON_PARSER_ERROR;
+  }
+  return is_success;
+}
+
+static bool json_parser_emit_literal(JsonParser *parser, StringView ident) {
+  JsonSaxHandler *handler = &parser->handler;
+  bool is_success;
+  if (sv_compare(ident, sv_new("null", 4))) {
+    is_success = handler->on_null == NULL || handler->on_null(handler->context);
+  } else if (sv_compare(ident, sv_new("true", 4))) {
+    is_success =
+        handler->on_bool == NULL || handler->on_bool(true, handler->context);
+  } else if (sv_compare(ident, sv_new("false", 5))) {
+    is_success =
+        handler->on_bool == NULL || handler->on_bool(false, handler->context);
+  } else {
+    return json_parser_fail(parser, "invalid keyword starting with",
+                            ident.data[0]);
+  }
+  sb_clear(parser->token);
+  json_parser_value_done(parser);
+  if (!is_success) {
+    parser->state = JSON_PARSER_ERROR;
+  }
+  return is_success;
+}
+
+static bool json_parser_begin(JsonParser *parser, char ch) {
+  JsonSaxHandler *handler = &parser->handler;
+  JsonParserFrames *frames = &parser->frames;
+  bool is_success;
+  da_append(frames, ch);
+  if (ch == '{') {
+    is_success = handler->on_object_begin == NULL ||
+                 handler->on_object_begin(handler->context);
+    parser->state = JSON_PARSER_OBJECT_FIRST;
+  } else {
+    is_success = handler->on_array_begin == NULL ||
+                 handler->on_array_begin(handler->context);
+    parser->state = JSON_PARSER_ARRAY_FIRST;
+  }
+  if (!is_success) {
+    parser->state = JSON_PARSER_ERROR;
+  }
+  return is_success;
+}
+
+static bool json_parser_end(JsonParser *parser, char ch) {
+  JsonSaxHandler *handler = &parser->handler;
+  char open = ch == '}' ? '{' : '[';
+  if (parser->frames.len == 0 ||
+      parser->frames.items[parser->frames.len - 1] != open) {
+    return json_parser_fail(parser, "unexpected ch", ch);
+  }
+  parser->frames.len--;
+  bool is_success;
+  if (ch == '}') {
+    is_success = handler->on_object_end == NULL ||
+                 handler->on_object_end(handler->context);
+  } else {
+    is_success = handler->on_array_end == NULL ||
+                 handler->on_array_end(handler->context);
+  }
+  json_parser_value_done(parser);
+  if (!is_success) {
+    parser->state = JSON_PARSER_ERROR;
+  }
+  return is_success;
+}
+
+static bool json_parser_value_start(JsonParser *parser, char ch) {
+  if (ch == '"') {
+    parser->state = JSON_PARSER_STRING;
+    parser->token_is_key = false;
+    parser->string_has_escape = false;
+    return true;
+  } else if (ch == '{' || ch == '[') {
+    return json_parser_begin(parser, ch);
+  } else if (isdigit(ch) || ch == '-') {
+    parser->state = JSON_PARSER_NUMBER;
+    return true;
+  } else if (is_alpha_lowercase(ch)) {
+    parser->state = JSON_PARSER_LITERAL;
+    return true;
+  }
+  return json_parser_fail(parser, "unexpected ch", ch);
+}
+
+static bool json_is_whitespace(char ch) {
+  return ch == ' ' || ch == '\r' || ch == '\t' || ch == '\n';
+}
+
+static bool json_is_number_char(char ch) {
+  return isdigit(ch) || ch == '-' || ch == '+' || ch == '.' || ch == 'e' ||
+         ch == 'E';
+}
+
+bool json_parser_feed(JsonParser *parser, StringView chunk) {
+  size_t i = 0;
+  while (i < chunk.len) {
+    char ch = chunk.data[i];
+
+    switch (parser->state) {
+    case JSON_PARSER_STRING: {
+      size_t start = i;
+      while (i < chunk.len) {
+        char c = chunk.data[i];
+        if (parser->string_escape) {
+          parser->string_escape = false;
+        } else if (c == '\\') {
+          parser->string_escape = true;
+          parser->string_has_escape = true;
+        } else if (c == '"') {
+          break;
+        } else if ((unsigned char)c < 0x20) {
+          parser->offset += i - start;
+          return json_parser_fail(parser, "unescaped control ch in string", c);
+        }
+        i++;
+      }
+      StringView span = sv_new(chunk.data + start, i - start);
+      if (i == chunk.len) {
+        sb_append(parser->token, span);
+        parser->offset += i - start;
+        return true;
+      }
+      i++;
+      parser->offset += i - start;
+      if (parser->token->len > 0) {
+        sb_append(parser->token, span);
+        span = sv_new(parser->token->data, parser->token->len);
+      }
+      if (!json_parser_emit_string(parser, span)) {
+        return false;
+      }
+      continue;
+    }
+    case JSON_PARSER_NUMBER:
+    case JSON_PARSER_LITERAL: {
+      bool is_number = parser->state == JSON_PARSER_NUMBER;
+      size_t start = i;
+      while (i < chunk.len && (is_number ? json_is_number_char(chunk.data[i])
+                                         : is_alpha_lowercase(chunk.data[i]))) {
+        i++;
+      }
+      StringView span = sv_new(chunk.data + start, i - start);
+      parser->offset += i - start;
+      if (i == chunk.len) {
+        sb_append(parser->token, span);
+        continue;
+      }
+      if (parser->token->len > 0) {
+        sb_append(parser->token, span);
+        span = sv_new(parser->token->data, parser->token->len);
+      }
+      bool is_success = is_number ? json_parser_emit_number(parser, span)
+                                  : json_parser_emit_literal(parser, span);
+      if (!is_success) {
+        return false;
+      }
+      continue;
+    }
+    case JSON_PARSER_ERROR:
+      return false;
+    default:
+      break;
+    }
+
+    i++;
+    parser->offset++;
+    if (json_is_whitespace(ch)) {
+      continue;
+    }
+
+    switch (parser->state) {
+    case JSON_PARSER_VALUE:
+      if (!json_parser_value_start(parser, ch)) {
+        return false;
+      }
+      break;
+    case JSON_PARSER_ARRAY_FIRST:
+      if (ch == ']') {
+        if (!json_parser_end(parser, ch)) {
+          return false;
+        }
+      } else if (!json_parser_value_start(parser, ch)) {
+        return false;
+      }
+      break;
+    case JSON_PARSER_OBJECT_FIRST:
+    case JSON_PARSER_KEY:
+      if (ch == '}' && parser->state == JSON_PARSER_OBJECT_FIRST) {
+        if (!json_parser_end(parser, ch)) {
+          return false;
+        }
+      } else if (ch == '"') {
+        parser->state = JSON_PARSER_STRING;
+        parser->token_is_key = true;
+        parser->string_has_escape = false;
+      } else {
+        return json_parser_fail(parser, "expected key got", ch);
+      }
+      break;
+    case JSON_PARSER_COLON:
+      if (ch != ':') {
+        return json_parser_fail(parser, "expected ':' got", ch);
+      }
+      parser->state = JSON_PARSER_VALUE;
+      break;
+    case JSON_PARSER_AFTER_VALUE:
+      if (ch == ',') {
+        parser->state =
+            parser->frames.items[parser->frames.len - 1] == '{'
+                ? JSON_PARSER_KEY
+                : JSON_PARSER_VALUE;
+      } else if (ch == ']' || ch == '}') {
+        if (!json_parser_end(parser, ch)) {
+          return false;
+        }
+      } else {
+        return json_parser_fail(parser, "unexpected ch", ch);
+      }
+      break;
+    case JSON_PARSER_DONE:
+      return json_parser_fail(parser, "unexpected trailing ch", ch);
+    default:
+      return json_parser_fail(parser, "unreachable state at", ch);
+    }
+
+    if (parser->state == JSON_PARSER_NUMBER ||
+        parser->state == JSON_PARSER_LITERAL) {
+      i--;
+      parser->offset--;
+    }
+  }
+  return true;
+}
+
+bool json_parser_finish(JsonParser *parser, Json *dest) {
+  if (parser->state == JSON_PARSER_NUMBER ||
+      parser->state == JSON_PARSER_LITERAL) {
+    StringView token = sv_new(parser->token->data, parser->token->len);
+    bool is_success = parser->state == JSON_PARSER_NUMBER
+                          ? json_parser_emit_number(parser, token)
+                          : json_parser_emit_literal(parser, token);
+    if (!is_success) {
+      return false;
+    }
+  }
+  if (parser->state != JSON_PARSER_DONE) {
+    if (parser->state != JSON_PARSER_ERROR) {
+      logger_log(LOG_ERROR, "JSON_PARSE unexpected end of input at byte %lu",
+                 parser->offset);
+      parser->state = JSON_PARSER_ERROR;
+    }
+    return false;
+  }
+  if (dest != NULL && parser->dom.root != NULL) {
+    *dest = *parser->dom.root;
+    Allocator *allocator = parser->dom.allocator;
+    if (allocator == NULL) {
+      mem_free(parser->dom.root);
+    } else {
+      allocator->free(sizeof(Json), parser->dom.root, allocator->context);
+    }
+    parser->dom.root = NULL;
+  }
+  return true;
+}
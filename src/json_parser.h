@@ -0,0 +1,52 @@
+#include "dynamic_array.h"
+#include "json.h"
+#include "json_sax.h"
+
+#ifndef _JSON_PARSER_H
+#define _JSON_PARSER_H
+
+typedef enum {
+  JSON_PARSER_VALUE,
+  JSON_PARSER_ARRAY_FIRST,
+  JSON_PARSER_OBJECT_FIRST,
+  JSON_PARSER_KEY,
+  JSON_PARSER_COLON,
+  JSON_PARSER_AFTER_VALUE,
+  JSON_PARSER_STRING,
+  JSON_PARSER_NUMBER,
+  JSON_PARSER_LITERAL,
+  JSON_PARSER_DONE,
+  JSON_PARSER_ERROR,
+} JsonParserState;
+
+typedef DYNAMIC_ARRAY(char) JsonParserFrames;
+typedef DYNAMIC_ARRAY(Json *) JsonParserNodes;
+
+typedef struct {
+  Allocator *allocator;
+  Json *root;
+  JsonParserNodes nodes;
+  StringBuffer *key;
+} JsonDomBuilder;
+
+// Push parser, keeps its state between chunks so tokens may be split
+// anywhere. Without a handler it builds a Json tree for json_parser_finish.
+typedef struct {
+  JsonParserState state;
+  JsonParserFrames frames;
+  StringBuffer *token;
+  bool token_is_key;
+  bool string_escape;
+  bool string_has_escape;
+  size_t offset;
+  JsonSaxHandler handler;
+  JsonDomBuilder dom;
+} JsonParser;
+
+JsonParser *json_parser_new(Allocator *allocator);
+JsonParser *json_parser_new_with_handler(JsonSaxHandler *handler);
+bool json_parser_feed(JsonParser *parser, StringView chunk);
+bool json_parser_finish(JsonParser *parser, Json *dest);
+void json_parser_free(JsonParser *parser);
+
+#endif // _JSON_PARSER_H
@@ -0,0 +1,312 @@
+#include <ctype.h>
+#include <stdlib.h>
+
+#include "json_escape.h"
+#include "json_pointer.h"
+#include "json_sax.h"
+#include "logger.h"
+#include "mem.h"
+
+// Array indexes are "0" or digits without a leading zero.
+static bool json_pointer_parse_index(StringView token, size_t *dest) {
+  if (token.len == 0 || (token.data[0] == '0' && token.len > 1)) {
+    return false;
+  }
+  size_t index = 0;
+  for (size_t i = 0; i < token.len; ++i) {
+    if (!isdigit(token.data[i]) ||
+        index > (SIZE_MAX - (size_t)(token.data[i] - '0')) / 10) {
+      return false;
+    }
+    index = index * 10 + (size_t)(token.data[i] - '0');
+  }
+  *dest = index;
+  return true;
+}
+
+static bool json_pointer_decode(StringView raw, JsonPointerToken *dest) {
+  StringBuffer *key = sb_new_with_custom_cap(raw.len + 1);
+  char *out = (char *)key->data;
+  for (size_t i = 0; i < raw.len; ++i) {
+    if (raw.data[i] != '~') {
+      *out++ = raw.data[i];
+    } else if (i + 1 < raw.len && raw.data[i + 1] == '0') {
+      *out++ = '~';
+      i++;
+    } else if (i + 1 < raw.len && raw.data[i + 1] == '1') {
+      *out++ = '/';
+      i++;
+    } else {
+      sb_free(key);
+      return false;
+    }
+  }
+  key->len = (size_t)(out - key->data);
+  *out = '\0';
+  StringView view = sv_new(key->data, key->len);
+  *dest = (JsonPointerToken){
+      .key = key,
+      .hash = json_object_hash(view),
+  };
+  dest->is_index = json_pointer_parse_index(view, &dest->index);
+  return true;
+}
+
+// Keys are decoded and hashed once here so evaluation never rehashes.
+JsonPointer *json_pointer_compile(StringView pointer) {
+  if (pointer.len > 0 && pointer.data[0] != '/') {
+    logger_log(LOG_ERROR, "JSON_POINTER must start with '/': '%.*s'",
+               (int)pointer.len, pointer.data);
+    return NULL;
+  }
+  size_t count = 0;
+  for (size_t i = 0; i < pointer.len; ++i) {
+    count += pointer.data[i] == '/';
+  }
+  JsonPointer *p = mem_malloc(sizeof(JsonPointer));
+  if (p == NULL) {
+    logger_log(LOG_FATAL, "json_pointer_compile malloc err");
+  }
+  *p = (JsonPointer){
+      .tokens = count > 0 ? mem_malloc(count * sizeof(JsonPointerToken)) : NULL,
+      .len = 0,
+  };
+  if (count > 0 && p->tokens == NULL) {
+    logger_log(LOG_FATAL, "json_pointer_compile->tokens malloc err");
+  }
+
+  size_t start = 1;
+  while (p->len < count) {
+    size_t end = start;
+    while (end < pointer.len && pointer.data[end] != '/') {
+      end++;
+    }
+    StringView raw = sv_new(pointer.data + start, end - start);
+    if (!json_pointer_decode(raw, &p->tokens[p->len])) {
+      logger_log(LOG_ERROR, "JSON_POINTER invalid escape in '%.*s'",
+                 (int)pointer.len, pointer.data);
+      json_pointer_free(p);
+      return NULL;
+    }
+    p->len++;
+    start = end + 1;
+  }
+  return p;
+}
+
+void json_pointer_free(JsonPointer *pointer) {
+  if (pointer == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < pointer->len; ++i) {
+    sb_free(pointer->tokens[i].key);
+  }
+  mem_free(pointer->tokens);
+  mem_free(pointer);
+}
+
+Json *json_pointer_get(JsonPointer *pointer, Json *root) {
+  Json *current = root;
+  for (size_t i = 0; i < pointer->len && current != NULL; ++i) {
+    JsonPointerToken *token = &pointer->tokens[i];
+    if (current->type == JSON_OBJECT) {
+      current = json_object_get_hashed(
+          current->object, sv_new(token->key->data, token->key->len),
+          token->hash);
+    } else if (current->type == JSON_ARRAY && token->is_index &&
+               token->index < current->array->len) {
+      current = current->array->items[token->index];
+    } else {
+      current = NULL;
+    }
+  }
+  return current;
+}
+
+// Candidate lists are a stack of pointer indexes, each level puts the
+// lists for its children right after its own.
+typedef struct {
+  Lexer lexer;
+  JsonPointer **pointers;
+  StringView *dest;
+  size_t remaining;
+  StringBuffer *scratch;
+} JsonPointerScan;
+
+static bool json_pointer_scan_value(JsonPointerScan *s, size_t depth,
+                                    size_t *candidates, size_t count);
+
+static bool json_pointer_scan_key(JsonPointerScan *s, StringView *dest) {
+  bool has_escape;
+  if (!lexer_scan_string(&s->lexer, dest, &has_escape)) {
+    return false;
+  }
+  if (!has_escape) {
+    return true;
+  }
+  if (s->scratch == NULL) {
+    s->scratch = sb_new_with_custom_cap(dest->len + 1);
+  } else if (s->scratch->cap < dest->len + 1) {
+    sb_resize(s->scratch, dest->len + 1);
+  }
+  ssize_t len = json_unescape(dest->data, dest->len, (char *)s->scratch->data);
+  if (len < 0) {
+    return false;
+  }
+  *dest = sv_new(s->scratch->data, (size_t)len);
+  return true;
+}
+
+static bool json_pointer_scan_object(JsonPointerScan *s, size_t depth,
+                                     size_t *candidates, size_t count) {
+  Lexer *lexer = &s->lexer;
+  size_t *children = candidates + count;
+  lexer_advance(lexer);
+  lexer_skip_whitespace(lexer);
+  if (lexer->ch == '}') {
+    lexer_advance(lexer);
+    return true;
+  }
+  while (true) {
+    lexer_skip_whitespace(lexer);
+    StringView key;
+    if (!json_pointer_scan_key(s, &key)) {
+      return false;
+    }
+    lexer_skip_whitespace(lexer);
+    if (!lexer_eat(lexer, ':')) {
+      return false;
+    }
+    size_t matched = 0;
+    for (size_t i = 0; i < count; ++i) {
+      if (sb_compare_sv(s->pointers[candidates[i]]->tokens[depth].key, key)) {
+        children[matched++] = candidates[i];
+      }
+    }
+    if (!json_pointer_scan_value(s, depth + 1, children, matched)) {
+      return false;
+    }
+    if (s->remaining == 0) {
+      return true;
+    }
+    lexer_skip_whitespace(lexer);
+    if (lexer->ch != ',') {
+      break;
+    }
+    lexer_advance(lexer);
+  }
+  return lexer_eat(lexer, '}');
+}
+
+static bool json_pointer_scan_array(JsonPointerScan *s, size_t depth,
+                                    size_t *candidates, size_t count) {
+  Lexer *lexer = &s->lexer;
+  size_t *children = candidates + count;
+  lexer_advance(lexer);
+  lexer_skip_whitespace(lexer);
+  if (lexer->ch == ']') {
+    lexer_advance(lexer);
+    return true;
+  }
+  for (size_t index = 0;; ++index) {
+    size_t matched = 0;
+    for (size_t i = 0; i < count; ++i) {
+      JsonPointerToken *token = &s->pointers[candidates[i]]->tokens[depth];
+      if (token->is_index && token->index == index) {
+        children[matched++] = candidates[i];
+      }
+    }
+    if (!json_pointer_scan_value(s, depth + 1, children, matched)) {
+      return false;
+    }
+    if (s->remaining == 0) {
+      return true;
+    }
+    lexer_skip_whitespace(lexer);
+    if (lexer->ch != ',') {
+      break;
+    }
+    lexer_advance(lexer);
+  }
+  return lexer_eat(lexer, ']');
+}
+
+// Values no pointer goes through are skipped with an empty SAX handler.
+static bool json_pointer_scan_value(JsonPointerScan *s, size_t depth,
+                                    size_t *candidates, size_t count) {
+  Lexer *lexer = &s->lexer;
+  lexer_skip_whitespace(lexer);
+  const char *start = lexer->cur;
+  size_t *deeper = candidates + count;
+  size_t deeper_count = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (s->pointers[candidates[i]]->len > depth) {
+      deeper[deeper_count++] = candidates[i];
+    }
+  }
+
+  bool is_success;
+  if (deeper_count > 0 && lexer->ch == '{') {
+    is_success = json_pointer_scan_object(s, depth, deeper, deeper_count);
+  } else if (deeper_count > 0 && lexer->ch == '[') {
+    is_success = json_pointer_scan_array(s, depth, deeper, deeper_count);
+  } else {
+    JsonSaxHandler skip = {0};
+    is_success = json_sax_parse_value(lexer, &skip);
+  }
+  if (!is_success) {
+    return false;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    size_t p = candidates[i];
+    if (s->pointers[p]->len == depth && s->dest[p].data == NULL) {
+      s->dest[p] = sv_new(start, (size_t)(lexer->cur - start));
+      s->remaining--;
+    }
+  }
+  return true;
+}
+
+// One forward pass over the raw input, dest[i] is the raw text of the value
+// pointers[i] refers to or a NULL view. With duplicate keys the first one
+// wins. The scan stops once every pointer is found, so input after the last
+// match is not validated.
+bool json_pointer_extract(StringView input, JsonPointer **pointers,
+                          size_t len, StringView *dest) {
+  size_t max_depth = 0;
+  for (size_t i = 0; i < len; ++i) {
+    dest[i] = sv_new(NULL, 0);
+    if (pointers[i]->len > max_depth) {
+      max_depth = pointers[i]->len;
+    }
+  }
+  size_t *candidates =
+      mem_malloc((2 * max_depth + 3) * (len + 1) * sizeof(size_t));
+  if (candidates == NULL) {
+    logger_log(LOG_FATAL, "json_pointer_extract malloc err");
+  }
+  for (size_t i = 0; i < len; ++i) {
+    candidates[i] = i;
+  }
+
+  StringBuffer borrowed = {.data = input.data, .cap = 0, .len = input.len};
+  JsonPointerScan s = {
+      .lexer = lexer_new(&borrowed),
+      .pointers = pointers,
+      .dest = dest,
+      .remaining = len,
+      .scratch = NULL,
+  };
+  lexer_advance(&s.lexer);
+  bool is_success = json_pointer_scan_value(&s, 0, candidates, len);
+  if (!is_success) {
+    Location location = lexer_location(&s.lexer);
+    logger_log(LOG_ERROR,
+               "JSON_POINTER invalid input at line %lu on offset %lu",
+               location.line, location.offset);
+  }
+  mem_free(candidates);
+  sb_free(s.scratch);
+  return is_success;
+}
@@ -0,0 +1,29 @@
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "json.h"
+
+#ifndef _JSON_POINTER_H
+#define _JSON_POINTER_H
+
+// One reference token of an RFC 6901 pointer, with "~1" and "~0" already
+// decoded. Tokens that are valid array indexes also keep the number.
+typedef struct {
+  StringBuffer *key;
+  size_t hash;
+  size_t index;
+  bool is_index;
+} JsonPointerToken;
+
+typedef struct {
+  JsonPointerToken *tokens;
+  size_t len;
+} JsonPointer;
+
+JsonPointer *json_pointer_compile(StringView pointer);
+void json_pointer_free(JsonPointer *pointer);
+Json *json_pointer_get(JsonPointer *pointer, Json *root);
+bool json_pointer_extract(StringView input, JsonPointer **pointers,
+                          size_t len, StringView *dest);
+
+#endif // _JSON_POINTER_H
@@ -0,0 +1,208 @@
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json_escape.h"
+#include "json_sax.h"
+#include "logger.h"
+
+static bool json_sax_object(Lexer *lexer, JsonSaxHandler *handler,
+                            StringBuffer **scratch);
+static bool json_sax_array(Lexer *lexer, JsonSaxHandler *handler,
+                           StringBuffer **scratch);
+
+// Escaped strings are decoded into a scratch buffer reused for the whole
+// parse, plain ones are passed straight from the input.
+static bool json_sax_string(Lexer *lexer, StringView *dest,
+                            StringBuffer **scratch) {
+  bool has_escape;
+  if (!lexer_scan_string(lexer, dest, &has_escape)) {
+    return false;
+  }
+  if (!has_escape) {
+    return true;
+  }
+  if (*scratch == NULL) {
+    *scratch = sb_new_with_custom_cap(dest->len + 1);
+  } else if ((*scratch)->cap < dest->len + 1) {
+    sb_resize(*scratch, dest->len + 1);
+  }
+  ssize_t len = json_unescape(dest->data, dest->len, (char *)(*scratch)->data);
+  if (len < 0) {
+    Location location = lexer_location(lexer);
+    logger_log(LOG_ERROR,
+               "JSON_PARSE invalid escape in string at line %lu on offset %lu",
+               location.line, location.offset);
+    return false;
+  }
+  (*scratch)->len = (size_t)len;
+  *dest = sv_new((*scratch)->data, (size_t)len);
+  return true;
+}
+
+bool json_sax_emit_number(JsonSaxHandler *handler, JsonNumber *number) {
+  switch (number->type) {
+  case JSON_NUMBER_INT:
+    return handler->on_int == NULL ||
+           handler->on_int(number->integer, handler->context);
+  case JSON_NUMBER_UINT:
+    return handler->on_uint == NULL ||
+           handler->on_uint(number->unsigned_integer, handler->context);
+  case JSON_NUMBER_DOUBLE:
+    return handler->on_double == NULL ||
+           handler->on_double(number->floating, handler->context);
+  }
+  return false;
+}
+
+static bool json_sax_number(Lexer *lexer, JsonSaxHandler *handler) {
+  JsonNumber number;
+  if (!lexer_read_number(lexer, &number)) {
+    return false;
+  }
+  return json_sax_emit_number(handler, &number);
+}
+
+static bool json_sax_value(Lexer *lexer, JsonSaxHandler *handler,
+                           StringBuffer **scratch) {
+  lexer_skip_whitespace(lexer);
+  switch (lexer->ch) {
+  case '"': {
+    StringView string;
+    if (!json_sax_string(lexer, &string, scratch)) {
+      return false;
+    }
+    return handler->on_string == NULL ||
+           handler->on_string(string, handler->context);
+  }
+  case '[':
+    return json_sax_array(lexer, handler, scratch);
+  case '{':
+    return json_sax_object(lexer, handler, scratch);
+  default:
+    if (isdigit(lexer->ch) || lexer->ch == '-') {
+      return json_sax_number(lexer, handler);
+    } else if (is_alpha_lowercase(lexer->ch)) {
+      StringView ident = lexer_scan_ident(lexer);
+      if (sv_compare(ident, sv_new("null", 4))) {
+        return handler->on_null == NULL || handler->on_null(handler->context);
+      } else if (sv_compare(ident, sv_new("true", 4))) {
+        return handler->on_bool == NULL ||
+               handler->on_bool(true, handler->context);
+      } else if (sv_compare(ident, sv_new("false", 5))) {
+        return handler->on_bool == NULL ||
+               handler->on_bool(false, handler->context);
+      }
+      Location location = lexer_location(lexer);
+      logger_log(LOG_ERROR,
+                 "JSON_PARSE invalid keyword '%.*s' at line %lu on offset %lu",
+                 (int)ident.len, ident.data, location.line, location.offset);
+      return false;
+    }
+    Location location = lexer_location(lexer);
+    logger_log(LOG_ERROR,
+               "JSON_PARSE unexpected ch '%c' at line %lu on offset %lu",
+               lexer->ch, location.line, location.offset);
+    return false;
+  }
+}
+
+static bool json_sax_array(Lexer *lexer, JsonSaxHandler *handler,
+                           StringBuffer **scratch) {
+  if (!lexer_eat(lexer, '[')) {
+    return false;
+  }
+  if (handler->on_array_begin != NULL &&
+      !handler->on_array_begin(handler->context)) {
+    return false;
+  }
+
+  lexer_skip_whitespace(lexer);
+  if (lexer->ch != ']') {
+    while (true) {
+      if (!json_sax_value(lexer, handler, scratch)) {
+        return false;
+      }
+      lexer_skip_whitespace(lexer);
+      if (lexer->ch != ',') {
+        break;
+      }
+      lexer_advance(lexer);
+    }
+  }
+
+  if (!lexer_eat(lexer, ']')) {
+    return false;
+  }
+  return handler->on_array_end == NULL ||
+         handler->on_array_end(handler->context);
+}
+
+static bool json_sax_object(Lexer *lexer, JsonSaxHandler *handler,
+                            StringBuffer **scratch) {
+  if (!lexer_eat(lexer, '{')) {
+    return false;
+  }
+  if (handler->on_object_begin != NULL &&
+      !handler->on_object_begin(handler->context)) {
+    return false;
+  }
+
+  lexer_skip_whitespace(lexer);
+  if (lexer->ch != '}') {
+    while (true) {
+      lexer_skip_whitespace(lexer);
+      StringView key;
+      if (!json_sax_string(lexer, &key, scratch)) {
+        return false;
+      }
+      if (handler->on_key != NULL && !handler->on_key(key, handler->context)) {
+        return false;
+      }
+      lexer_skip_whitespace(lexer);
+      if (!lexer_eat(lexer, ':')) {
+        return false;
+      }
+      if (!json_sax_value(lexer, handler, scratch)) {
+        return false;
+      }
+      lexer_skip_whitespace(lexer);
+      if (lexer->ch != ',') {
+        break;
+      }
+      lexer_advance(lexer);
+    }
+  }
+
+  if (!lexer_eat(lexer, '}')) {
+    return false;
+  }
+  return handler->on_object_end == NULL ||
+         handler->on_object_end(handler->context);
+}
+
+bool json_sax_parse_value(Lexer *lexer, JsonSaxHandler *handler) {
+  StringBuffer *scratch = NULL;
+  bool is_success = json_sax_value(lexer, handler, &scratch);
+  sb_free(scratch);
+  return is_success;
+}
+
+bool json_sax_parse(StringBuffer *input, JsonSaxHandler *handler) {
+  Lexer lexer = lexer_new(input);
+  lexer_advance(&lexer);
+
+  bool is_success = json_sax_parse_value(&lexer, handler);
+  if (is_success) {
+    lexer_skip_whitespace(&lexer);
+    if (lexer.cur != lexer.end) {
+      Location location = lexer_location(&lexer);
+      logger_log(LOG_ERROR,
+                 "JSON_PARSE unexpected trailing ch '%c' at line %lu on "
+                 "offset %lu",
+                 lexer.ch, location.line, location.offset);
+      is_success = false;
+    }
+  }
+  return is_success;
+}
@@ -0,0 +1,30 @@
+#include <stdint.h>
+
+#include "json.h"
+
+#ifndef _JSON_SAX_H
+#define _JSON_SAX_H
+
+// Callbacks are optional, returning false from one stops the parse.
+// String and key views are only valid during the callback. on_uint only
+// receives integers above INT64_MAX.
+typedef struct {
+  bool (*on_object_begin)(void *context);
+  bool (*on_object_end)(void *context);
+  bool (*on_array_begin)(void *context);
+  bool (*on_array_end)(void *context);
+  bool (*on_key)(StringView key, void *context);
+  bool (*on_string)(StringView value, void *context);
+  bool (*on_int)(int64_t value, void *context);
+  bool (*on_uint)(uint64_t value, void *context);
+  bool (*on_double)(double value, void *context);
+  bool (*on_bool)(bool value, void *context);
+  bool (*on_null)(void *context);
+  void *context;
+} JsonSaxHandler;
+
+bool json_sax_parse(StringBuffer *input, JsonSaxHandler *handler);
+bool json_sax_parse_value(Lexer *lexer, JsonSaxHandler *handler);
+bool json_sax_emit_number(JsonSaxHandler *handler, JsonNumber *number);
+
+#endif // _JSON_SAX_H
@@ -0,0 +1,401 @@
+#include <string.h>
+
+#include "json_sax.h"
+#include "json_tape.h"
+#include "logger.h"
+
+typedef struct {
+  size_t start;
+  size_t count;
+} JsonTapeFrame;
+
+typedef DYNAMIC_ARRAY(JsonTapeFrame) JsonTapeFrames;
+
+typedef struct {
+  JsonTape *tape;
+  JsonTapeFrames frames;
+} JsonTapeBuilder;
+
+static uint64_t json_tape_word(char tag, uint64_t payload) {
+  return (uint64_t)(unsigned char)tag << JSON_TAPE_TAG_SHIFT |
+         (payload & JSON_TAPE_PAYLOAD_MASK);
+}
+
+static char json_tape_tag(uint64_t word) {
+  return (char)(word >> JSON_TAPE_TAG_SHIFT);
+}
+
+static void json_tape_push(JsonTapeBuilder *builder, uint64_t word) {
+  JsonTapeWords *words = &builder->tape->words;
+  da_append(words, word);
+}
+
+// Every value counts towards the enclosing container, keys do not.
+static void json_tape_count(JsonTapeBuilder *builder) {
+  if (builder->frames.len > 0) {
+    builder->frames.items[builder->frames.len - 1].count++;
+  }
+}
+
+static bool json_tape_begin(JsonTapeBuilder *builder, char tag) {
+  json_tape_count(builder);
+  JsonTapeFrames *frames = &builder->frames;
+  JsonTapeFrame frame = {.start = builder->tape->words.len};
+  da_append(frames, frame);
+  json_tape_push(builder, json_tape_word(tag, 0));
+  return true;
+}
+
+static bool json_tape_end(JsonTapeBuilder *builder, char tag) {
+  JsonTapeFrame frame = builder->frames.items[--builder->frames.len];
+  size_t end = builder->tape->words.len;
+  if (end > JSON_TAPE_END_MASK) {
+    logger_log(LOG_ERROR, "JSON_TAPE document too large");
+    return false;
+  }
+  size_t count =
+      frame.count < JSON_TAPE_COUNT_MAX ? frame.count : JSON_TAPE_COUNT_MAX;
+  uint64_t *start = &builder->tape->words.items[frame.start];
+  *start = json_tape_word(json_tape_tag(*start), (uint64_t)count << 32 | end);
+  json_tape_push(builder, json_tape_word(tag, frame.start));
+  return true;
+}
+
+// Strings carry a 32 bit length prefix, longer ones fail the parse.
+static bool json_tape_push_string(JsonTapeBuilder *builder, StringView value) {
+  if (value.len > UINT32_MAX) {
+    logger_log(LOG_ERROR, "JSON_TAPE string too large");
+    return false;
+  }
+  StringBuffer *strings = builder->tape->strings;
+  json_tape_push(builder, json_tape_word('"', strings->len));
+  uint32_t len = (uint32_t)value.len;
+  sb_append(strings, sv_new((const char *)&len, sizeof(len)));
+  sb_append(strings, value);
+  sb_append_char(strings, '\0');
+  return true;
+}
+
+bool _json_tape_object_begin_cb(void *context) {
+  return json_tape_begin(context, '{');
+}
+
+bool _json_tape_object_end_cb(void *context) {
+  return json_tape_end(context, '}');
+}
+
+bool _json_tape_array_begin_cb(void *context) {
+  return json_tape_begin(context, '[');
+}
+
+bool _json_tape_array_end_cb(void *context) {
+  return json_tape_end(context, ']');
+}
+
+bool _json_tape_key_cb(StringView key, void *context) {
+  return json_tape_push_string(context, key);
+}
+
+bool _json_tape_string_cb(StringView value, void *context) {
+  json_tape_count(context);
+  return json_tape_push_string(context, value);
+}
+
+bool _json_tape_int_cb(int64_t value, void *context) {
+  json_tape_count(context);
+  json_tape_push(context, json_tape_word('l', 0));
+  json_tape_push(context, (uint64_t)value);
+  return true;
+}
+
+bool _json_tape_uint_cb(uint64_t value, void *context) {
+  json_tape_count(context);
+  json_tape_push(context, json_tape_word('u', 0));
+  json_tape_push(context, value);
+  return true;
+}
+
+bool _json_tape_double_cb(double value, void *context) {
+  json_tape_count(context);
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  json_tape_push(context, json_tape_word('d', 0));
+  json_tape_push(context, bits);
+  return true;
+}
+
+bool _json_tape_bool_cb(bool value, void *context) {
+  json_tape_count(context);
+  json_tape_push(context, json_tape_word(value ? 't' : 'f', 0));
+  return true;
+}
+
+bool _json_tape_null_cb(void *context) {
+  json_tape_count(context);
+  json_tape_push(context, json_tape_word('n', 0));
+  return true;
+}
+
+// Strings get a rough share of the input up front, words grow as needed.
+bool json_tape_parse(StringBuffer *input, JsonTape *dest) {
+  *dest = (JsonTape){
+      .strings = sb_new_with_custom_cap(input->len / 2 + 1),
+  };
+  JsonTapeBuilder builder = {.tape = dest};
+  JsonSaxHandler handler = {
+      .on_object_begin = _json_tape_object_begin_cb,
+      .on_object_end = _json_tape_object_end_cb,
+      .on_array_begin = _json_tape_array_begin_cb,
+      .on_array_end = _json_tape_array_end_cb,
+      .on_key = _json_tape_key_cb,
+      .on_string = _json_tape_string_cb,
+      .on_int = _json_tape_int_cb,
+      .on_uint = _json_tape_uint_cb,
+      .on_double = _json_tape_double_cb,
+      .on_bool = _json_tape_bool_cb,
+      .on_null = _json_tape_null_cb,
+      .context = &builder,
+  };
+  bool is_success = json_sax_parse(input, &handler);
+  JsonTapeFrames *frames = &builder.frames;
+  da_free(frames);
+  if (!is_success) {
+    json_tape_free(dest);
+  }
+  return is_success;
+}
+
+void json_tape_free(JsonTape *tape) {
+  JsonTapeWords *words = &tape->words;
+  da_free(words);
+  sb_free(tape->strings);
+  *tape = (JsonTape){0};
+}
+
+JsonTapeValue json_tape_root(JsonTape *tape) {
+  return (JsonTapeValue){.tape = tape, .pos = 0};
+}
+
+static uint64_t json_tape_at(JsonTapeValue value) {
+  return value.tape->words.items[value.pos];
+}
+
+// Index of the word after the value at pos.
+static size_t json_tape_skip(JsonTape *tape, size_t pos) {
+  uint64_t word = tape->words.items[pos];
+  switch (json_tape_tag(word)) {
+  case '{':
+  case '[':
+    return (size_t)(word & JSON_TAPE_END_MASK) + 1;
+  case 'l':
+  case 'u':
+  case 'd':
+    return pos + 2;
+  default:
+    return pos + 1;
+  }
+}
+
+JsonType json_tape_type(JsonTapeValue value) {
+  switch (json_tape_tag(json_tape_at(value))) {
+  case '{':
+    return JSON_OBJECT;
+  case '[':
+    return JSON_ARRAY;
+  case '"':
+    return JSON_STRING;
+  case 'l':
+    return JSON_INT;
+  case 'u':
+    return JSON_UINT;
+  case 'd':
+    return JSON_DOUBLE;
+  case 't':
+    return JSON_TRUE;
+  case 'f':
+    return JSON_FALSE;
+  case 'n':
+    return JSON_NULL;
+  default:
+    return JSON_EMPTY;
+  }
+}
+
+JsonTapeIter json_tape_iter(JsonTapeValue container) {
+  uint64_t word = json_tape_at(container);
+  char tag = json_tape_tag(word);
+  if (tag != '{' && tag != '[') {
+    return (JsonTapeIter){.tape = container.tape};
+  }
+  return (JsonTapeIter){
+      .tape = container.tape,
+      .pos = container.pos + 1,
+      .end = (size_t)(word & JSON_TAPE_END_MASK),
+      .type = tag == '{' ? JSON_OBJECT : JSON_ARRAY,
+  };
+}
+
+// Counts past JSON_TAPE_COUNT_MAX are recovered by walking the container.
+size_t json_tape_len(JsonTapeValue container) {
+  uint64_t word = json_tape_at(container);
+  char tag = json_tape_tag(word);
+  if (tag != '{' && tag != '[') {
+    return 0;
+  }
+  size_t count = (size_t)((word & JSON_TAPE_PAYLOAD_MASK) >> 32);
+  if (count < JSON_TAPE_COUNT_MAX) {
+    return count;
+  }
+  JsonTapeIter iter = json_tape_iter(container);
+  count = 0;
+  while (iter.pos < iter.end) {
+    if (iter.type == JSON_OBJECT) {
+      iter.pos++;
+    }
+    iter.pos = json_tape_skip(iter.tape, iter.pos);
+    count++;
+  }
+  return count;
+}
+
+bool json_tape_object_next(JsonTapeIter *iter, StringView *key,
+                           JsonTapeValue *value) {
+  if (iter->type != JSON_OBJECT || iter->pos >= iter->end) {
+    return false;
+  }
+  json_tape_get_string((JsonTapeValue){iter->tape, iter->pos}, key);
+  *value = (JsonTapeValue){.tape = iter->tape, .pos = iter->pos + 1};
+  iter->pos = json_tape_skip(iter->tape, value->pos);
+  return true;
+}
+
+bool json_tape_array_next(JsonTapeIter *iter, JsonTapeValue *value) {
+  if (iter->type != JSON_ARRAY || iter->pos >= iter->end) {
+    return false;
+  }
+  *value = (JsonTapeValue){.tape = iter->tape, .pos = iter->pos};
+  iter->pos = json_tape_skip(iter->tape, value->pos);
+  return true;
+}
+
+bool json_tape_array_get(JsonTapeValue array, size_t i, JsonTapeValue *dest) {
+  JsonTapeIter iter = json_tape_iter(array);
+  JsonTapeValue value;
+  for (size_t n = 0; json_tape_array_next(&iter, &value); ++n) {
+    if (n == i) {
+      *dest = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool json_tape_object_get(JsonTapeValue object, StringView key,
+                          JsonTapeValue *dest) {
+  JsonTapeIter iter = json_tape_iter(object);
+  StringView member;
+  JsonTapeValue value;
+  while (json_tape_object_next(&iter, &member, &value)) {
+    if (sv_compare(member, key)) {
+      *dest = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool json_tape_get_string(JsonTapeValue value, StringView *dest) {
+  uint64_t word = json_tape_at(value);
+  if (json_tape_tag(word) != '"') {
+    return false;
+  }
+  const char *entry =
+      value.tape->strings->data + (word & JSON_TAPE_PAYLOAD_MASK);
+  uint32_t len;
+  memcpy(&len, entry, sizeof(len));
+  *dest = sv_new(entry + sizeof(len), len);
+  return true;
+}
+
+bool json_tape_get_int64(JsonTapeValue value, int64_t *dest) {
+  if (json_tape_tag(json_tape_at(value)) != 'l') {
+    return false;
+  }
+  *dest = (int64_t)value.tape->words.items[value.pos + 1];
+  return true;
+}
+
+bool json_tape_get_uint64(JsonTapeValue value, uint64_t *dest) {
+  char tag = json_tape_tag(json_tape_at(value));
+  uint64_t raw = tag == 'l' || tag == 'u'
+                     ? value.tape->words.items[value.pos + 1]
+                     : 0;
+  if (tag == 'u' || (tag == 'l' && (int64_t)raw >= 0)) {
+    *dest = raw;
+    return true;
+  }
+  return false;
+}
+
+bool json_tape_get_double(JsonTapeValue value, double *dest) {
+  if (json_tape_tag(json_tape_at(value)) != 'd') {
+    return false;
+  }
+  memcpy(dest, &value.tape->words.items[value.pos + 1], sizeof(*dest));
+  return true;
+}
+
+bool json_tape_get_bool(JsonTapeValue value, bool *dest) {
+  char tag = json_tape_tag(json_tape_at(value));
+  if (tag != 't' && tag != 'f') {
+    return false;
+  }
+  *dest = tag == 't';
+  return true;
+}
+
+bool json_tape_object_get_int64(JsonTapeValue o, StringView key,
+                                int64_t *dest) {
+  JsonTapeValue value;
+  return json_tape_object_get(o, key, &value) &&
+         json_tape_get_int64(value, dest);
+}
+
+bool json_tape_object_get_uint64(JsonTapeValue o, StringView key,
+                                 uint64_t *dest) {
+  JsonTapeValue value;
+  return json_tape_object_get(o, key, &value) &&
+         json_tape_get_uint64(value, dest);
+}
+
+bool json_tape_object_get_double(JsonTapeValue o, StringView key,
+                                 double *dest) {
+  JsonTapeValue value;
+  return json_tape_object_get(o, key, &value) &&
+         json_tape_get_double(value, dest);
+}
+
+bool json_tape_object_get_string(JsonTapeValue o, StringView key,
+                                 StringView *dest) {
+  JsonTapeValue value;
+  return json_tape_object_get(o, key, &value) &&
+         json_tape_get_string(value, dest);
+}
+
+bool json_tape_object_get_bool(JsonTapeValue o, StringView key, bool *dest) {
+  JsonTapeValue value;
+  return json_tape_object_get(o, key, &value) &&
+         json_tape_get_bool(value, dest);
+}
+
+bool json_tape_object_get_array(JsonTapeValue o, StringView key,
+                                JsonTapeValue *dest) {
+  return json_tape_object_get(o, key, dest) &&
+         json_tape_type(*dest) == JSON_ARRAY;
+}
+
+bool json_tape_object_get_object(JsonTapeValue o, StringView key,
+                                 JsonTapeValue *dest) {
+  return json_tape_object_get(o, key, dest) &&
+         json_tape_type(*dest) == JSON_OBJECT;
+}
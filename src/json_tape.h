@@ -0,0 +1,75 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "dynamic_array.h"
+#include "json.h"
+
+#ifndef _JSON_TAPE_H
+#define _JSON_TAPE_H
+
+#define JSON_TAPE_TAG_SHIFT 56
+#define JSON_TAPE_PAYLOAD_MASK (((uint64_t)1 << JSON_TAPE_TAG_SHIFT) - 1)
+#define JSON_TAPE_END_MASK 0xFFFFFFFFULL
+#define JSON_TAPE_COUNT_MAX 0xFFFFFF
+
+typedef DYNAMIC_ARRAY(uint64_t) JsonTapeWords;
+
+// Each word is a tag char in the top byte and a 56 bit payload.
+//   '{' '['  index of the matching end, element count above bit 32
+//   '}' ']'  index of the matching start
+//   '"'      offset of a 32 bit length, the bytes and a '\0' in strings
+//   'l' 'u' 'd'  int64, uint64 or double bits in the following word
+//   't' 'f' 'n'  no payload
+// Object members are a key string followed by the value.
+typedef struct {
+  JsonTapeWords words;
+  StringBuffer *strings;
+} JsonTape;
+
+typedef struct {
+  JsonTape *tape;
+  size_t pos;
+} JsonTapeValue;
+
+typedef struct {
+  JsonTape *tape;
+  size_t pos;
+  size_t end;
+  JsonType type;
+} JsonTapeIter;
+
+bool json_tape_parse(StringBuffer *input, JsonTape *dest);
+void json_tape_free(JsonTape *tape);
+JsonTapeValue json_tape_root(JsonTape *tape);
+
+JsonType json_tape_type(JsonTapeValue value);
+size_t json_tape_len(JsonTapeValue container);
+JsonTapeIter json_tape_iter(JsonTapeValue container);
+bool json_tape_object_next(JsonTapeIter *iter, StringView *key,
+                           JsonTapeValue *value);
+bool json_tape_array_next(JsonTapeIter *iter, JsonTapeValue *value);
+bool json_tape_array_get(JsonTapeValue array, size_t i, JsonTapeValue *dest);
+bool json_tape_object_get(JsonTapeValue object, StringView key,
+                          JsonTapeValue *dest);
+
+bool json_tape_get_string(JsonTapeValue value, StringView *dest);
+bool json_tape_get_int64(JsonTapeValue value, int64_t *dest);
+bool json_tape_get_uint64(JsonTapeValue value, uint64_t *dest);
+bool json_tape_get_double(JsonTapeValue value, double *dest);
+bool json_tape_get_bool(JsonTapeValue value, bool *dest);
+
+bool json_tape_object_get_int64(JsonTapeValue o, StringView key,
+                                int64_t *dest);
+bool json_tape_object_get_uint64(JsonTapeValue o, StringView key,
+                                 uint64_t *dest);
+bool json_tape_object_get_double(JsonTapeValue o, StringView key,
+                                 double *dest);
+bool json_tape_object_get_string(JsonTapeValue o, StringView key,
+                                 StringView *dest);
+bool json_tape_object_get_bool(JsonTapeValue o, StringView key, bool *dest);
+bool json_tape_object_get_array(JsonTapeValue o, StringView key,
+                                JsonTapeValue *dest);
+bool json_tape_object_get_object(JsonTapeValue o, StringView key,
+                                 JsonTapeValue *dest);
+
+#endif // _JSON_TAPE_H
@@ -0,0 +1,233 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include "json_escape.h"
+#include "json_writer.h"
+#include "logger.h"
+#include "mem.h"
+
+static JsonWriter *json_writer_alloc(size_t cap) {
+  if (cap < JSON_WRITER_CAP_MIN) {
+    cap = JSON_WRITER_CAP_MIN;
+  }
+  JsonWriter *w = mem_malloc(sizeof(JsonWriter));
+  if (w == NULL) {
+    logger_log(LOG_FATAL, "json_writer_new malloc err");
+  }
+  *w = (JsonWriter){
+      .buf = mem_malloc(cap),
+      .cap = cap,
+      .len = 0,
+      .sink = NULL,
+      .context = NULL,
+      .fd = -1,
+      .failed = false,
+  };
+  if (w->buf == NULL) {
+    logger_log(LOG_FATAL, "json_writer_new->buf malloc err");
+  }
+  return w;
+}
+
+JsonWriter *json_writer_new(size_t cap, JsonWriterSink sink, void *context) {
+  JsonWriter *w = json_writer_alloc(cap);
+  w->sink = sink;
+  w->context = context;
+  return w;
+}
+
+JsonWriter *json_writer_new_fd(size_t cap, int fd) {
+  JsonWriter *w = json_writer_alloc(cap);
+  w->fd = fd;
+  return w;
+}
+
+// Retries short writes until every iovec is out.
+static bool json_writer_writev(int fd, struct iovec *iov, int count) {
+  while (count > 0) {
+    ssize_t written = writev(fd, iov, count);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      logger_log(LOG_ERROR, "json_writer writev err: %s", strerror(errno));
+      return false;
+    }
+    size_t done = (size_t)written;
+    while (count > 0 && done >= iov->iov_len) {
+      done -= iov->iov_len;
+      iov++;
+      count--;
+    }
+    if (count > 0) {
+      iov->iov_base = (char *)iov->iov_base + done;
+      iov->iov_len -= done;
+    }
+  }
+  return true;
+}
+
+// Sends the buffered bytes followed by data, one writev call for an fd.
+static bool json_writer_emit(JsonWriter *w, const char *data, size_t len) {
+  if (w->failed) {
+    return false;
+  }
+  bool is_success;
+  if (w->sink != NULL) {
+    is_success = (w->len == 0 || w->sink(w->buf, w->len, w->context)) &&
+                 (len == 0 || w->sink(data, len, w->context));
+  } else {
+    struct iovec iov[2] = {
+        {.iov_base = w->buf, .iov_len = w->len},
+        {.iov_base = (void *)data, .iov_len = len},
+    };
+    is_success = json_writer_writev(w->fd, iov, 2);
+  }
+  w->len = 0;
+  w->failed = !is_success;
+  return is_success;
+}
+
+bool json_writer_flush(JsonWriter *w) { return json_writer_emit(w, NULL, 0); }
+
+// Small writes top up the buffer so every flush is a full one.
+bool json_writer_write(JsonWriter *w, const char *data, size_t len) {
+  if (w->failed) {
+    return false;
+  }
+  size_t room = w->cap - w->len;
+  if (len <= room) {
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+    return true;
+  }
+  if (len >= w->cap) {
+    return json_writer_emit(w, data, len);
+  }
+  memcpy(w->buf + w->len, data, room);
+  w->len = w->cap;
+  if (!json_writer_flush(w)) {
+    return false;
+  }
+  memcpy(w->buf, data + room, len - room);
+  w->len = len - room;
+  return true;
+}
+
+void json_writer_free(JsonWriter *w) {
+  if (w == NULL) {
+    return;
+  }
+  mem_free(w->buf);
+  mem_free(w);
+}
+
+static bool json_writer_char(JsonWriter *w, char ch) {
+  if (w->len == w->cap && !json_writer_flush(w)) {
+    return false;
+  }
+  w->buf[w->len++] = ch;
+  return true;
+}
+
+static bool json_writer_cstr(JsonWriter *w, const char *s) {
+  return json_writer_write(w, s, strlen(s));
+}
+
+// Numbers are formatted in place, cap is never below the format size.
+static bool json_write_number(JsonWriter *w, Json *json) {
+  if (w->cap - w->len < JSON_NUMBER_FORMAT_CAP && !json_writer_flush(w)) {
+    return false;
+  }
+  char *out = w->buf + w->len;
+  if (json->type == JSON_INT) {
+    w->len += json_number_format_int64(json->num_integer, out);
+  } else if (json->type == JSON_UINT) {
+    w->len += json_number_format_uint64(json->num_unsigned, out);
+  } else {
+    w->len += json_number_format_double(json->num_double, out);
+  }
+  return true;
+}
+
+static bool json_write_string(JsonWriter *w, StringBuffer *string) {
+  const char *p = string->data;
+  size_t len = string->len;
+  if (!json_writer_char(w, '"')) {
+    return false;
+  }
+  while (true) {
+    size_t run = json_escape_scan(p, len);
+    if (!json_writer_write(w, p, run)) {
+      return false;
+    }
+    if (run == len) {
+      break;
+    }
+    char escaped[JSON_ESCAPE_MAX_GROWTH];
+    if (!json_writer_write(w, escaped, json_escape_char(p[run], escaped))) {
+      return false;
+    }
+    p += run + 1;
+    len -= run + 1;
+  }
+  return json_writer_char(w, '"');
+}
+
+static bool json_write_array(JsonWriter *w, JsonArray *array) {
+  if (!json_writer_char(w, '[')) {
+    return false;
+  }
+  for (size_t i = 0; i < array->len; ++i) {
+    if ((i > 0 && !json_writer_char(w, ',')) ||
+        !json_write(w, array->items[i])) {
+      return false;
+    }
+  }
+  return json_writer_char(w, ']');
+}
+
+static bool json_write_object(JsonWriter *w, JsonObject *object) {
+  if (!json_writer_char(w, '{')) {
+    return false;
+  }
+  size_t i = 0;
+  JsonObjectEntry *entry;
+  for (bool first = true; json_object_next(object, &i, &entry);
+       first = false) {
+    if ((!first && !json_writer_char(w, ',')) ||
+        !json_write_string(w, entry->key) || !json_writer_char(w, ':') ||
+        !json_write(w, entry->value)) {
+      return false;
+    }
+  }
+  return json_writer_char(w, '}');
+}
+
+// Same output as json_stringify. The tail stays buffered until
+// json_writer_flush.
+bool json_write(JsonWriter *w, Json *json) {
+  switch (json->type) {
+  case JSON_STRING:
+    return json_write_string(w, json->string);
+  case JSON_ARRAY:
+    return json_write_array(w, json->array);
+  case JSON_OBJECT:
+    return json_write_object(w, json->object);
+  case JSON_INT:
+  case JSON_UINT:
+  case JSON_DOUBLE:
+    return json_write_number(w, json);
+  case JSON_TRUE:
+    return json_writer_cstr(w, "true");
+  case JSON_FALSE:
+    return json_writer_cstr(w, "false");
+  case JSON_NULL:
+    return json_writer_cstr(w, "null");
+  default:
+    logger_log(LOG_FATAL, "json_write unreachable type");
+  }
+  return false;
+}
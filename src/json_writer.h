@@ -0,0 +1,34 @@
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "json.h"
+
+#ifndef _JSON_WRITER_H
+#define _JSON_WRITER_H
+
+#define JSON_WRITER_CAP_MIN 64
+
+typedef bool (*JsonWriterSink)(const char *data, size_t len, void *context);
+
+// Output is collected in buf and flushed whenever it is full, either to the
+// sink or with writev to fd. Writes larger than buf go out directly
+// together with the buffered bytes. After a failed flush every write fails.
+typedef struct {
+  char *buf;
+  size_t cap;
+  size_t len;
+  JsonWriterSink sink;
+  void *context;
+  int fd;
+  bool failed;
+} JsonWriter;
+
+JsonWriter *json_writer_new(size_t cap, JsonWriterSink sink, void *context);
+JsonWriter *json_writer_new_fd(size_t cap, int fd);
+bool json_writer_write(JsonWriter *w, const char *data, size_t len);
+bool json_writer_flush(JsonWriter *w);
+void json_writer_free(JsonWriter *w);
+
+bool json_write(JsonWriter *w, Json *json);
+
+#endif // _JSON_WRITER_H
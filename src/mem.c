@@ -0,0 +1,291 @@
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+#include "mem.h"
+
+static _Atomic(const Allocator *) mem_allocator = NULL;
+
+void mem_set_allocator(const Allocator *allocator) {
+  if (allocator != NULL && allocator->realloc == NULL) {
+    logger_log(LOG_FATAL, "mem_set_allocator allocator without realloc");
+  }
+  atomic_store_explicit(&mem_allocator, allocator, memory_order_release);
+}
+
+static const Allocator *mem_default(void) {
+  return atomic_load_explicit(&mem_allocator, memory_order_acquire);
+}
+
+void *mem_malloc_at(size_t size, const char *site) {
+  const Allocator *allocator = mem_default();
+  if (allocator == NULL) {
+    return malloc(size);
+  }
+  return allocator->alloc(size, site, allocator->context);
+}
+
+void *mem_calloc_at(size_t count, size_t size, const char *site) {
+  const Allocator *allocator = mem_default();
+  if (allocator == NULL) {
+    return calloc(count, size);
+  }
+  if (size != 0 && count > SIZE_MAX / size) {
+    return NULL;
+  }
+  void *ptr = allocator->alloc(count * size, site, allocator->context);
+  if (ptr != NULL) {
+    memset(ptr, 0, count * size);
+  }
+  return ptr;
+}
+
+void *mem_realloc_at(void *ptr, size_t size, const char *site) {
+  const Allocator *allocator = mem_default();
+  if (allocator == NULL) {
+    return realloc(ptr, size);
+  }
+  return allocator->realloc(ptr, size, site, allocator->context);
+}
+
+void mem_free_at(void *ptr, const char *site) {
+  (void)site;
+  const Allocator *allocator = mem_default();
+  if (allocator == NULL) {
+    free(ptr);
+    return;
+  }
+  allocator->free(0, ptr, allocator->context);
+}
+
+typedef union {
+  struct {
+    size_t size;
+    MemStats *site;
+  } info;
+  max_align_t align;
+} MemProfileHeader;
+
+MemProfile *mem_profile_new() {
+  MemProfile *profile = calloc(1, sizeof(MemProfile));
+  if (profile == NULL) {
+    logger_log(LOG_FATAL, "mem_profile_new malloc err");
+  }
+  profile->other = (MemStats){.name = "other", .subsystem = &profile->other};
+  profile->total.name = "total";
+  pthread_mutex_init(&profile->lock, NULL);
+  return profile;
+}
+
+void mem_profile_free(MemProfile *profile) {
+  if (profile == NULL) {
+    return;
+  }
+  pthread_mutex_destroy(&profile->lock);
+  free(profile);
+}
+
+static size_t mem_profile_file_len(const char *site) {
+  const char *colon = strrchr(site, ':');
+  return colon != NULL ? (size_t)(colon - site) : strlen(site);
+}
+
+static MemStats *mem_profile_subsystem_of(MemProfile *profile,
+                                          const char *site) {
+  size_t len = mem_profile_file_len(site);
+  for (size_t i = 0; i < profile->nsubsystems; ++i) {
+    const char *name = profile->subsystems[i].name;
+    if (mem_profile_file_len(name) == len && strncmp(name, site, len) == 0) {
+      return &profile->subsystems[i];
+    }
+  }
+  if (profile->nsubsystems == MEM_PROFILE_SUBSYSTEMS_MAX) {
+    return &profile->other;
+  }
+  MemStats *subsystem = &profile->subsystems[profile->nsubsystems++];
+  *subsystem = (MemStats){.name = site, .subsystem = subsystem};
+  return subsystem;
+}
+
+// Sites are string literals, so they are looked up by address with linear
+// probing. Called with the lock held.
+static MemStats *mem_profile_site(MemProfile *profile, const char *site) {
+  size_t i = ((uintptr_t)site >> 3) % MEM_PROFILE_SITES_MAX;
+  for (size_t probe = 0; probe < MEM_PROFILE_SITES_MAX; ++probe) {
+    MemStats *stats = &profile->sites[i];
+    if (stats->name == site) {
+      return stats;
+    }
+    if (stats->name == NULL) {
+      if (profile->nsites + 1 == MEM_PROFILE_SITES_MAX) {
+        break;
+      }
+      profile->nsites++;
+      *stats = (MemStats){
+          .name = site,
+          .subsystem = mem_profile_subsystem_of(profile, site),
+      };
+      return stats;
+    }
+    i = (i + 1) % MEM_PROFILE_SITES_MAX;
+  }
+  return &profile->other;
+}
+
+static void mem_stats_add(MemStats *stats, size_t size) {
+  stats->calls++;
+  stats->bytes += size;
+  stats->live += size;
+  if (stats->live > stats->peak) {
+    stats->peak = stats->live;
+  }
+}
+
+static void mem_stats_remove(MemStats *stats, size_t size) {
+  stats->frees++;
+  stats->live -= size;
+}
+
+// Allocations without a site are counted as other.
+static void mem_profile_add(MemProfile *profile, MemProfileHeader *header,
+                            size_t size, const char *site) {
+  pthread_mutex_lock(&profile->lock);
+  MemStats *stats =
+      site != NULL ? mem_profile_site(profile, site) : &profile->other;
+  mem_stats_add(stats, size);
+  if (stats->subsystem != stats) {
+    mem_stats_add(stats->subsystem, size);
+  }
+  mem_stats_add(&profile->total, size);
+  pthread_mutex_unlock(&profile->lock);
+  header->info.size = size;
+  header->info.site = stats;
+}
+
+static void mem_profile_remove(MemProfile *profile, MemProfileHeader *header) {
+  MemStats *stats = header->info.site;
+  size_t size = header->info.size;
+  pthread_mutex_lock(&profile->lock);
+  mem_stats_remove(stats, size);
+  if (stats->subsystem != stats) {
+    mem_stats_remove(stats->subsystem, size);
+  }
+  mem_stats_remove(&profile->total, size);
+  pthread_mutex_unlock(&profile->lock);
+}
+
+static void *_mem_profile_alloc_cb(size_t size, const char *site,
+                                   void *context) {
+  if (size > SIZE_MAX - sizeof(MemProfileHeader)) {
+    return NULL;
+  }
+  MemProfileHeader *header = malloc(sizeof(MemProfileHeader) + size);
+  if (header == NULL) {
+    return NULL;
+  }
+  mem_profile_add(context, header, size, site);
+  return header + 1;
+}
+
+// A realloc counts as a free of the old block and an allocation of the new
+// one, the new size is attributed to the calling site.
+static void *_mem_profile_realloc_cb(void *ptr, size_t size, const char *site,
+                                     void *context) {
+  if (ptr == NULL) {
+    return _mem_profile_alloc_cb(size, site, context);
+  }
+  if (size > SIZE_MAX - sizeof(MemProfileHeader)) {
+    return NULL;
+  }
+  MemProfileHeader *header = (MemProfileHeader *)ptr - 1;
+  MemProfileHeader old = *header;
+  MemProfileHeader *resized = realloc(header, sizeof(MemProfileHeader) + size);
+  if (resized == NULL) {
+    return NULL;
+  }
+  mem_profile_remove(context, &old);
+  mem_profile_add(context, resized, size, site);
+  return resized + 1;
+}
+
+// The size is taken from the header, bytes may be 0.
+static void *_mem_profile_free_cb(size_t bytes, void *ptr, void *context) {
+  (void)bytes;
+  if (ptr == NULL) {
+    return NULL;
+  }
+  MemProfileHeader *header = (MemProfileHeader *)ptr - 1;
+  mem_profile_remove(context, header);
+  free(header);
+  return NULL;
+}
+
+Allocator mem_profile_allocator(MemProfile *profile) {
+  return (Allocator){
+      .alloc = _mem_profile_alloc_cb,
+      .realloc = _mem_profile_realloc_cb,
+      .free = _mem_profile_free_cb,
+      .context = profile,
+  };
+}
+
+// file is matched against the file part of the sites, e.g. "src/json.c".
+const MemStats *mem_profile_subsystem(MemProfile *profile, const char *file) {
+  size_t len = strlen(file);
+  for (size_t i = 0; i < profile->nsubsystems; ++i) {
+    const char *name = profile->subsystems[i].name;
+    if (mem_profile_file_len(name) == len && strncmp(name, file, len) == 0) {
+      return &profile->subsystems[i];
+    }
+  }
+  return NULL;
+}
+
+static void mem_profile_print(FILE *out, const MemStats *stats, int len) {
+  fprintf(out, "%-40.*s %10lu %10lu %12lu %12lu %12lu\n", len, stats->name,
+          stats->calls, stats->frees, stats->bytes, stats->peak, stats->live);
+}
+
+static int _mem_stats_compare_cb(const void *a, const void *b) {
+  size_t x = (*(const MemStats *const *)a)->bytes;
+  size_t y = (*(const MemStats *const *)b)->bytes;
+  return x < y ? 1 : x > y ? -1 : 0;
+}
+
+// Subsystems and sites are listed by bytes allocated, a site with live bytes
+// left once everything is freed is a leak.
+void mem_profile_report(MemProfile *profile, FILE *out) {
+  pthread_mutex_lock(&profile->lock);
+  const MemStats *sorted[MEM_PROFILE_SITES_MAX];
+  fprintf(out, "%-40s %10s %10s %12s %12s %12s\n", "subsystem", "calls",
+          "frees", "bytes", "peak", "live");
+  for (size_t i = 0; i < profile->nsubsystems; ++i) {
+    sorted[i] = &profile->subsystems[i];
+  }
+  qsort(sorted, profile->nsubsystems, sizeof(MemStats *),
+        _mem_stats_compare_cb);
+  for (size_t i = 0; i < profile->nsubsystems; ++i) {
+    mem_profile_print(out, sorted[i],
+                      (int)mem_profile_file_len(sorted[i]->name));
+  }
+  if (profile->other.calls > 0) {
+    mem_profile_print(out, &profile->other, 40);
+  }
+  mem_profile_print(out, &profile->total, 40);
+
+  fprintf(out, "\n%-40s %10s %10s %12s %12s %12s\n", "site", "calls",
+          "frees", "bytes", "peak", "live");
+  size_t len = 0;
+  for (size_t i = 0; i < MEM_PROFILE_SITES_MAX; ++i) {
+    if (profile->sites[i].name != NULL) {
+      sorted[len++] = &profile->sites[i];
+    }
+  }
+  qsort(sorted, len, sizeof(MemStats *), _mem_stats_compare_cb);
+  for (size_t i = 0; i < len; ++i) {
+    mem_profile_print(out, sorted[i], 40);
+  }
+  pthread_mutex_unlock(&profile->lock);
+}
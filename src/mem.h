@@ -0,0 +1,63 @@
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "allocator.h"
+
+#ifndef _MEM_H
+#define _MEM_H
+
+#define MEM_STR(x) #x
+#define MEM_XSTR(x) MEM_STR(x)
+#define MEM_SITE __FILE__ ":" MEM_XSTR(__LINE__)
+
+#define mem_malloc(size) mem_malloc_at(size, MEM_SITE)
+#define mem_calloc(count, size) mem_calloc_at(count, size, MEM_SITE)
+#define mem_realloc(ptr, size) mem_realloc_at(ptr, size, MEM_SITE)
+#define mem_free(ptr) mem_free_at(ptr, MEM_SITE)
+
+#define MEM_PROFILE_SITES_MAX 1024
+#define MEM_PROFILE_SUBSYSTEMS_MAX 64
+
+// Every heap allocation of the library without an explicit Allocator goes
+// through the default one, NULL means the libc functions. It has to provide
+// realloc. The pointer is swapped atomically, but the default has to be set
+// before any threads start and reset only after everything allocated under
+// it is freed.
+void mem_set_allocator(const Allocator *allocator);
+void *mem_malloc_at(size_t size, const char *site);
+void *mem_calloc_at(size_t count, size_t size, const char *site);
+void *mem_realloc_at(void *ptr, size_t size, const char *site);
+void mem_free_at(void *ptr, const char *site);
+
+typedef struct MemStats {
+  const char *name;
+  size_t calls;
+  size_t frees;
+  size_t bytes;
+  size_t live;
+  size_t peak;
+  struct MemStats *subsystem;
+} MemStats;
+
+// Counting allocator, stats are kept per call site, per subsystem (the source
+// file of the site) and in total. Each block carries a small header with
+// its size and site so frees can be attributed. It can be the default
+// allocator or be passed to the json_*_with_allocator functions.
+typedef struct {
+  MemStats sites[MEM_PROFILE_SITES_MAX];
+  size_t nsites;
+  MemStats subsystems[MEM_PROFILE_SUBSYSTEMS_MAX];
+  size_t nsubsystems;
+  MemStats other;
+  MemStats total;
+  pthread_mutex_t lock;
+} MemProfile;
+
+MemProfile *mem_profile_new();
+void mem_profile_free(MemProfile *profile);
+Allocator mem_profile_allocator(MemProfile *profile);
+const MemStats *mem_profile_subsystem(MemProfile *profile, const char *file);
+void mem_profile_report(MemProfile *profile, FILE *out);
+
+#endif // _MEM_H
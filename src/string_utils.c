@@ -1,9 +1,14 @@
 #include <ctype.h>
+#include <fcntl.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "logger.h"
+#include "mem.h"
 #include "string_utils.h"
 
 // TODO
@@ -12,7 +17,7 @@
 // fix +1 errors, double mallocs
 
 const char *cstr(const char *literal) {
-  const char *out = malloc(sizeof(char) * strlen(literal) + 1);
+  const char *out = mem_malloc(sizeof(char) * strlen(literal) + 1);
   if (out == NULL) {
     logger_log(LOG_FATAL, "cstr malloc err");
   }
@@ -141,7 +146,7 @@ StringView sv_trim_right(StringView sv) {
 StringView sv_trim(StringView sv) { return sv_trim_left(sv_trim_right(sv)); }
 
 char *sv_dup(StringView sv) {
-  char *str = malloc(sizeof(char) * sv.len + 1);
+  char *str = mem_malloc(sizeof(char) * sv.len + 1);
   if (str == NULL) {
     logger_log(LOG_FATAL, "sv_dup malloc err");
   }
@@ -150,21 +155,43 @@ char *sv_dup(StringView sv) {
   return str;
 }
 
+// Borrowed buffers (cap 0) point into memory they do not own, resizing one
+// turns it into an owned copy.
+// Callers size new_cap from cap, which is 0 for a borrowed buffer, so its
+// heap copy gets room for the borrowed bytes on top.
 void sb_resize(StringBuffer *sb, size_t new_cap) {
-  sb->data = realloc((char *)sb->data, sizeof(char) * new_cap);
+  if (sb_is_borrowed(sb)) {
+    new_cap += sb->len;
+    char *data = mem_malloc(sizeof(char) * new_cap);
+    if (data == NULL) {
+      logger_log(LOG_FATAL, "sb_resize malloc err");
+    }
+    memcpy(data, sb->data, sb->len < new_cap ? sb->len : new_cap);
+    sb->data = data;
+    sb->cap = new_cap;
+    return;
+  }
+  sb->data = mem_realloc((char *)sb->data, sizeof(char) * new_cap);
   if (sb->data == NULL) {
     logger_log(LOG_FATAL, "sb_resize realloc err");
   }
   sb->cap = new_cap;
 }
 
+// Makes room for extra bytes plus the terminator after len.
+void sb_reserve(StringBuffer *sb, size_t extra) {
+  if (sb->len + extra >= sb->cap) {
+    sb_resize(sb, sb->cap * 2 + extra + 1);
+  }
+}
+
 StringBuffer *sb_new() {
-  StringBuffer *sb = (StringBuffer *)malloc(sizeof(StringBuffer));
+  StringBuffer *sb = (StringBuffer *)mem_malloc(sizeof(StringBuffer));
   if (sb == NULL) {
     logger_log(LOG_FATAL, "sb_new malloc err");
   }
   *sb = (StringBuffer){
-      .data = (char *)malloc(sizeof(char) * SB_INITIAL_CAP),
+      .data = (char *)mem_malloc(sizeof(char) * SB_INITIAL_CAP),
       .cap = SB_INITIAL_CAP,
       .len = 0,
   };
@@ -174,13 +201,17 @@ StringBuffer *sb_new() {
   return sb;
 }
 
+// Owned buffers never have cap 0, that marks a borrowed one.
 StringBuffer *sb_new_with_custom_cap(size_t cap) {
-  StringBuffer *sb = (StringBuffer *)malloc(sizeof(StringBuffer));
+  if (cap == 0) {
+    cap = 1;
+  }
+  StringBuffer *sb = (StringBuffer *)mem_malloc(sizeof(StringBuffer));
   if (sb == NULL) {
     logger_log(LOG_FATAL, "sb_new_with_custom_cap malloc err");
   }
   *sb = (StringBuffer){
-      .data = (char *)malloc(sizeof(char) * cap),
+      .data = (char *)mem_malloc(sizeof(char) * cap),
       .cap = cap,
       .len = 0,
   };
@@ -200,14 +231,14 @@ StringBuffer *sb_new_from_cstr(const char *cstr) {
 }
 
 StringBuffer *sb_new_from_sv(StringView view) {
-  StringBuffer *sb = malloc(sizeof(StringBuffer));
+  StringBuffer *sb = mem_malloc(sizeof(StringBuffer));
   if (sb == NULL) {
     logger_log(LOG_FATAL, "sb_new_from_sv malloc err");
   }
   *sb = (StringBuffer){
       .data = sv_dup(view),
       .len = view.len,
-      .cap = view.len,
+      .cap = view.len + 1,
   };
 
   return sb;
@@ -240,13 +271,19 @@ void sb_print(StringBuffer *sb) {
 
 void sb_free(StringBuffer *sb) {
   if (sb != NULL) {
-    free((char *)sb->data);
-    free(sb);
+    if (!sb_is_borrowed(sb)) {
+      mem_free((char *)sb->data);
+    }
+    mem_free(sb);
     sb = NULL;
   }
 }
 
 void sb_clear(StringBuffer *sb) {
+  if (sb_is_borrowed(sb)) {
+    sb->len = 0;
+    return;
+  }
   memset((char *)sb->data, '\0', sb->len);
   sb->len = 0;
 }
@@ -267,6 +304,8 @@ bool sb_is_valid_cstr(StringBuffer *sb) { return sb->data[sb->len] == '\0'; }
 
 bool sb_is_empty(StringBuffer *sb) { return sb->len == 0; }
 
+bool sb_is_borrowed(StringBuffer *sb) { return sb->cap == 0; }
+
 void sb_append_sb(StringBuffer *sb, StringBuffer *append) {
   if (sb->len + append->len >= sb->cap) {
     sb_resize(sb, sb->cap * 2 + append->len + 1);
@@ -311,6 +350,9 @@ void sb_remove(StringBuffer *sb, size_t idx, size_t count) {
   if (idx >= sb->len) {
     return;
   }
+  if (sb_is_borrowed(sb)) {
+    sb_resize(sb, sb->len + 1);
+  }
   count = idx + count >= sb->len ? sb->len - idx : count;
   memmove((char *)sb->data + idx, sb->data + idx + count, sb->len - count);
   sb->len -= count;
@@ -348,3 +390,55 @@ bool sb_file_read(const char *filename, StringBuffer *buffer) {
   fclose(fh);
   return true;
 }
+
+// dest->content becomes a borrowed, read-only view of the mapped file. There
+// is no '\0' after the last byte, readers have to stop at len.
+bool sb_file_map(const char *filename, SbFileMap *dest) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    logger_log(LOG_ERROR, "could not open file '%s'", filename);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    logger_log(LOG_ERROR, "could not stat file '%s'", filename);
+    close(fd);
+    return false;
+  }
+  *dest = (SbFileMap){.content = {.data = "", .cap = 0, .len = 0}};
+  if (st.st_size == 0) {
+    close(fd);
+    return true;
+  }
+
+  size_t len = (size_t)st.st_size;
+  void *data = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    logger_log(LOG_ERROR, "could not map file '%s'", filename);
+    return false;
+  }
+  madvise(data, len, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+  if (len >= SB_FILE_HUGE_PAGE_MIN) {
+    madvise(data, len, MADV_HUGEPAGE);
+  }
+#endif
+  dest->content.data = data;
+  dest->content.len = len;
+  dest->base = data;
+  dest->len = len;
+  return true;
+}
+
+// A content that was grown anyway has been copied to the heap by sb_resize,
+// the copy is freed along with the mapping.
+void sb_file_unmap(SbFileMap *map) {
+  if (!sb_is_borrowed(&map->content)) {
+    mem_free((char *)map->content.data);
+  }
+  if (map->len > 0) {
+    munmap(map->base, map->len);
+  }
+  *map = (SbFileMap){.content = {.data = "", .cap = 0, .len = 0}};
+}
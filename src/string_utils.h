@@ -9,6 +9,7 @@
 #define SB_INITIAL_CAP 64
 #define SB_INT_CAP 20
 #define SB_DOUBLE_CAP 40
+#define SB_FILE_HUGE_PAGE_MIN (2 * 1024 * 1024)
 
 #define SV_FMT "%.*s"
 #define SB_FMT "%.*s"
@@ -28,6 +29,15 @@ typedef struct {
   size_t len;
 } StringBuffer;
 
+// A read only file mapping. content is a borrowed view of it and must not be
+// appended to or otherwise mutated, base and len are what sb_file_unmap
+// releases whatever happened to content.
+typedef struct {
+  StringBuffer content;
+  void *base;
+  size_t len;
+} SbFileMap;
+
 // SV
 
 const char *cstr(const char *literal);
@@ -68,6 +78,8 @@ char *sv_dup(StringView sv);
 
 void sb_resize(StringBuffer *sb, size_t new_cap);
 
+void sb_reserve(StringBuffer *sb, size_t extra);
+
 StringBuffer *sb_new();
 
 StringBuffer *sb_new_with_custom_cap(size_t cap);
@@ -92,6 +104,8 @@ bool sb_is_valid_cstr(StringBuffer *sb);
 
 bool sb_is_empty(StringBuffer *sb);
 
+bool sb_is_borrowed(StringBuffer *sb);
+
 void sb_append(StringBuffer *sb, StringView sv);
 
 void sb_append_char(StringBuffer *sb, char ch);
@@ -104,4 +118,8 @@ void sb_remove(StringBuffer *sb, size_t idx, size_t count);
 
 bool sb_file_read(const char *filename, StringBuffer *dest);
 
+bool sb_file_map(const char *filename, SbFileMap *dest);
+
+void sb_file_unmap(SbFileMap *map);
+
 #endif // _STRING_BUFFER_H
@@ -1,5 +1,6 @@
 #include "uri.h"
 #include "logger.h"
+#include "mem.h"
 #include <stdlib.h>
 
 void uri_parse(StringView uri, UriComponents *components) {
@@ -86,14 +87,14 @@ size_t uri_query_hash(StringView key) {
 }
 
 UriQueryPairs *uri_query_new() {
-  UriQueryPairs *qp = malloc(sizeof(UriQueryPairs));
+  UriQueryPairs *qp = mem_malloc(sizeof(UriQueryPairs));
   if (qp == NULL) {
     logger_log(LOG_FATAL, "uri_query_new malloc err");
   }
   *qp = (UriQueryPairs){
       .cap = URI_QUERY_CAP_INIT,
       .size = 0,
-      .buckets = calloc(URI_QUERY_CAP_INIT, sizeof(UriQueryBucket *)),
+      .buckets = mem_calloc(URI_QUERY_CAP_INIT, sizeof(UriQueryBucket *)),
   };
   if (qp->buckets == NULL) {
     logger_log(LOG_FATAL, "uri_query_new bucckets calloc err");
@@ -115,7 +116,7 @@ void uri_query_parse(UriQueryPairs *qp, StringView query) {
 }
 
 void uri_query_resize(UriQueryPairs *qp, size_t new_cap) {
-  UriQueryBucket **new_buckets = calloc(new_cap, sizeof(UriQueryBucket *));
+  UriQueryBucket **new_buckets = mem_calloc(new_cap, sizeof(UriQueryBucket *));
   if (new_buckets == NULL) {
     logger_log(LOG_FATAL, "uri_query_resize new_buckets calloc err");
   }
@@ -131,7 +132,7 @@ void uri_query_resize(UriQueryPairs *qp, size_t new_cap) {
     }
   }
 
-  free(qp->buckets);
+  mem_free(qp->buckets);
 
   qp->buckets = new_buckets;
   qp->cap = new_cap;
@@ -140,7 +141,7 @@ void uri_query_resize(UriQueryPairs *qp, size_t new_cap) {
 void uri_query_set(UriQueryPairs *qp, StringView key, StringView value) {
   size_t hash = uri_query_hash(key);
   size_t idx = hash % qp->cap;
-  UriQueryBucket *new_bucket = malloc(sizeof(UriQueryBucket));
+  UriQueryBucket *new_bucket = mem_malloc(sizeof(UriQueryBucket));
   if (new_bucket == NULL) {
     logger_log(LOG_FATAL, "uri_query_set new_bucket malloc err");
   }
@@ -210,7 +211,7 @@ StringView uri_query_remove(UriQueryPairs *qp, StringView key) {
         qp->buckets[idx] = bucket->next;
       }
 
-      free(bucket);
+      mem_free(bucket);
 
       qp->size--;
 
@@ -243,12 +244,12 @@ void uri_query_free(UriQueryPairs *qp) {
     UriQueryBucket *bucket = qp->buckets[i];
     while (bucket) {
       UriQueryBucket *next = bucket->next;
-      free(bucket);
+      mem_free(bucket);
       bucket = next;
     }
   }
-  free(qp->buckets);
-  free(qp);
+  mem_free(qp->buckets);
+  mem_free(qp);
 }
 
 void uri_query_clear(UriQueryPairs *qp) {
@@ -256,7 +257,7 @@ void uri_query_clear(UriQueryPairs *qp) {
     UriQueryBucket *bucket = qp->buckets[i];
     while (bucket) {
       UriQueryBucket *next = bucket->next;
-      free(bucket);
+      mem_free(bucket);
       bucket = next;
     }
     qp->buckets[i] = NULL;
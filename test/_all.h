@@ -6,5 +6,22 @@ void test_uri();
 void test_dynamic_array();
 void test_json();
 void test_lexer();
+void test_arena();
+void test_json_escape();
+void test_json_sax();
+void test_json_parser();
+void test_json_index();
+void test_json_number();
+void test_json_ondemand();
+void test_json_tape();
+void test_json_writer();
+void test_json_format();
+void test_json_lines();
+void test_json_pointer();
+void test_json_binary();
+void test_json_decode();
+void test_json_cache();
+void test_json_file_cache();
+void test_mem();
 
 #endif // _ALL_H
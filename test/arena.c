@@ -0,0 +1,45 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "../src/arena.h"
+
+void test_arena_alloc() {
+  Arena *arena = arena_new(64);
+  char *a = arena_alloc(arena, 10);
+  char *b = arena_alloc(arena, 10);
+  assert(a != NULL && b != NULL && a != b && "should alloc");
+  assert((uintptr_t)b % ARENA_ALIGNMENT == 0 && "should align");
+
+  char *big = arena_alloc(arena, 1000);
+  assert(big != NULL && "should alloc bigger than chunk");
+  big[999] = 'x';
+  assert(arena->allocated == 1020 && "should count allocated bytes");
+  assert(arena->reserved == 2 * sizeof(ArenaChunk) + 64 + 1000 +
+                                ARENA_ALIGNMENT &&
+         "should count reserved chunk bytes");
+
+  arena_reset(arena);
+  assert(arena->allocated == 0 && "should reset");
+  assert(arena->reserved == sizeof(ArenaChunk) + 1000 + ARENA_ALIGNMENT &&
+         "should keep only the head chunk");
+  assert(arena_alloc(arena, 10) != NULL && "should alloc after reset");
+
+  arena_free(arena);
+}
+
+void test_arena_allocator() {
+  Arena *arena = arena_new(0);
+  Allocator allocator = arena_allocator(arena);
+  int *value = allocator.alloc(sizeof(int), NULL, allocator.context);
+  *value = 42;
+  allocator.free(sizeof(int), value, allocator.context);
+  assert(*value == 42 && "free should be noop");
+  arena_free(arena);
+}
+
+void test_arena() {
+  test_arena_alloc();
+  test_arena_allocator();
+  printf("All 'arena' tests passed successfully!\n");
+}
@@ -2,6 +2,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 
+#include "../src/arena.h"
 #include "../src/json.h"
 
 void test_json_compare() {
@@ -69,7 +70,7 @@ void test_json_parse_file() {
 void test_json_parse_array() {
   Json *json = json_new_array();
   Json *obj = json_new_object();
-  json_object_set(obj->object, sb_new_from_cstr("key1"),
+  json_object_set(obj->object, sv_new_from_cstr("key1"),
                   json_new_string("value1"));
   Json *items[] = {
       json_new_string("okej"),
@@ -94,11 +95,84 @@ void test_json_parse_array() {
   json_free(json);
 }
 
+static size_t foreach_count;
+
+static void count_pairs_cb(StringBuffer *key, Json *value) {
+  (void)key;
+  (void)value;
+  foreach_count++;
+}
+
+void test_json_object_many_keys() {
+  Json *json = json_new_object();
+  char key[32];
+  for (int i = 0; i < 10000; ++i) {
+    snprintf(key, sizeof(key), "key%d", i);
+    json_object_set(json->object, sv_new_from_cstr(key), json_new_int(i));
+  }
+  assert(json->object->len == 10000 && "object len");
+  for (int i = 0; i < 10000; ++i) {
+    snprintf(key, sizeof(key), "key%d", i);
+    Json *value = json_object_get(json->object, sv_new_from_cstr(key));
+    assert(value && value->num_integer == i && "should find every key");
+  }
+  assert(json_object_get(json->object, sv_new_from_cstr("key10000")) == NULL &&
+         "missing key");
+
+  json_object_set(json->object, sv_new_from_cstr("key42"), json_new_int(-1));
+  assert(json->object->len == 10000 && "replace keeps len");
+  assert(json_object_get(json->object, sv_new_from_cstr("key42"))
+                 ->num_integer == -1 &&
+         "replaced value");
+
+  foreach_count = 0;
+  json_object_foreach(json->object, count_pairs_cb);
+  assert(foreach_count == 10000 && "foreach visits every pair");
+  json_free(json);
+}
+
+void test_json_object_small() {
+  Json *json = json_new_object();
+  assert(json->object->ctrl == NULL && json->object->entries == NULL &&
+         "empty object allocates no entries");
+  StringBuffer *out = sb_new();
+  json_stringify(json, out);
+  assert(sb_compare_sv(out, sv_new_from_cstr("{}")) && "empty stringify");
+
+  char key[16];
+  for (int i = 0; i < 20; ++i) {
+    snprintf(key, sizeof(key), "k%d", i);
+    json_object_set(json->object, sv_new_from_cstr(key), json_new_int(i));
+    assert((json->object->ctrl == NULL) == (i < JSON_OBJECT_SMALL_MAX) &&
+           "upgrades once it outgrows the inline entries");
+    for (int j = 0; j <= i; ++j) {
+      snprintf(key, sizeof(key), "k%d", j);
+      Json *value = json_object_get(json->object, sv_new_from_cstr(key));
+      assert(value && value->num_integer == j && "should find every key");
+    }
+  }
+  json_free(json);
+
+  json = json_new_object();
+  json_object_set(json->object, sv_new_from_cstr("a"), json_new_int(1));
+  json_object_set(json->object, sv_new_from_cstr("a"), json_new_int(2));
+  assert(json->object->len == 1 &&
+         json_object_get(json->object, sv_new_from_cstr("a"))->num_integer ==
+             2 &&
+         "small replace");
+  sb_clear(out);
+  json_stringify(json, out);
+  assert(sb_compare_sv(out, sv_new_from_cstr("{\"a\":2}")) &&
+         "small stringify");
+  sb_free(out);
+  json_free(json);
+}
+
 void test_json_parse_object() {
   Json *json = json_new_object();
-  json_object_set(json->object, sb_new_from_cstr("key1"),
+  json_object_set(json->object, sv_new_from_cstr("key1"),
                   json_new_string("value1"));
-  json_object_set(json->object, sb_new_from_cstr("key2"),
+  json_object_set(json->object, sv_new_from_cstr("key2"),
                   json_new_string("value2"));
 
   Json *value1 = json_object_get(json->object, sv_new_from_cstr("key1"));
@@ -127,6 +201,30 @@ void test_json_stringify_array() {
   json_free(json);
 }
 
+void test_json_stringify_escape() {
+  const char *input = "{\"k\\\"ey\":[\"a\\\\b\\n\\u0001\\ud83d\\ude00/long "
+                      "text without escapes\\t\"]}";
+  StringBuffer *in = sb_new_from_cstr(input);
+  Json json;
+  assert(json_parse(in, &json) && "should parse escapes");
+  Json *value = json_object_get(json.object, sv_new_from_cstr("k\"ey"));
+  assert(value != NULL &&
+         sb_compare_sv(value->array->items[0]->string,
+                       sv_new_from_cstr("a\\b\n\x01\xf0\x9f\x98\x80/long "
+                                        "text without escapes\t")) &&
+         "should unescape strings and keys");
+
+  StringBuffer *out = sb_new();
+  json_stringify(&json, out);
+  assert(sb_compare_sv(out, sv_new_from_cstr(
+                                "{\"k\\\"ey\":[\"a\\\\b\\n\\u0001\xf0\x9f\x98"
+                                "\x80/long text without escapes\\t\"]}")) &&
+         "should escape strings and keys");
+  json_object_free(json.object);
+  sb_free(out);
+  sb_free(in);
+}
+
 void test_json_parse_array_fail() {
   Json *json = json_new();
   json_print(json);
@@ -145,18 +243,193 @@ void test_json_parse_object_fail() {
   json_free(json);
 }
 
+void test_json_parse_control_char() {
+  const char *inputs[] = {"\"a\x01b\"", "[\"tab\there\"]",
+                          "{\"k\x1f\": 1}",
+                          "\"a string longer than one block \n\""};
+  for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+    Json *json = json_new();
+    StringBuffer *input = sb_new_from_cstr(inputs[i]);
+    assert(!json_parse(input, json) && "should fail on raw control char");
+    json_free(json);
+    sb_free(input);
+  }
+  Json *json = json_new();
+  StringBuffer *input = sb_new_from_cstr("\"a\\u0001\\tb\"");
+  assert(json_parse(input, json) &&
+         sb_compare_sv(json->string, sv_new("a\x01\tb", 4)) &&
+         "should allow escaped control chars");
+  json_free(json);
+  sb_free(input);
+}
+
+void test_json_parse_trailing() {
+  Json *json = json_new();
+  StringBuffer *input = sb_new_from_cstr("[1] x");
+  assert(!json_parse(input, json) && "should fail on trailing input");
+  json_free(json);
+  sb_free(input);
+  json = json_new();
+  StringBuffer nul = {.data = "1\0", .cap = 0, .len = 2};
+  assert(!json_parse(&nul, json) && "should fail after a NUL byte");
+  json_free(json);
+  json = json_new();
+  input = sb_new_from_cstr(" {\"a\": [1]} \n");
+  assert(json_parse(input, json) && "should allow trailing spaces");
+  json_free(json);
+  sb_free(input);
+}
+
+void test_json_parse_with_allocator() {
+  Arena *arena = arena_new(0);
+  Allocator allocator = arena_allocator(arena);
+  StringBuffer *input = sb_new_from_cstr(
+      "[{\"name\": \"John\", \"tags\": [\"a\", \"\", null, 1, 2, 3, 4]}]");
+  Json json;
+  assert(json_parse_with_allocator(input, &json, &allocator) &&
+         "should parse with allocator");
+
+  JsonObject *first = json.array->items[0]->object;
+  assert(sb_compare_sv(json_object_get(first, sv_new_from_cstr("name"))->string,
+                       sv_new_from_cstr("John")) &&
+         "should parse name");
+  JsonArray *tags = json_object_get(first, sv_new_from_cstr("tags"))->array;
+  assert(tags->len == 7 && "should grow array in arena");
+  assert(tags->items[1]->string->len == 0 && "should parse empty string");
+  assert(tags->items[6]->num_integer == 4 && "should parse int");
+
+  sb_free(input);
+  arena_free(arena);
+}
+
+void test_json_parse_no_objects() {
+  Arena *arena = arena_new(0);
+  Allocator allocator = arena_allocator(arena);
+  StringBuffer *input = sb_new_from_cstr("[]");
+  Json json;
+  assert(json_parse_with_allocator(input, &json, &allocator) &&
+         arena->allocated ==
+             sizeof(JsonArray) + JSON_ARRAY_CAP_INIT * sizeof(Json *) &&
+         "should not create a key table without objects");
+  sb_free(input);
+  arena_free(arena);
+}
+
+void test_json_parse_intern_keys() {
+  StringBuffer *input = sb_new_from_cstr(
+      "[{\"name\": \"John\", \"age\": 25, \"isStudent\": true},"
+      " {\"name\": \"Alice\", \"age\": 30, \"na\\u006de\": false}]");
+  Json *json = json_new();
+  assert(json_parse(input, json) && "should parse");
+  JsonObject *first = json->array->items[0]->object;
+  JsonObject *second = json->array->items[1]->object;
+  assert(first->keys != NULL && first->keys == second->keys &&
+         "objects should share the document key table");
+  assert(first->keys->table->len == 3 && "keys should be stored once");
+  assert(first->entries[0].key == second->entries[0].key &&
+         "equal keys should be the same buffer");
+  assert(second->len == 2 && "escaped key should replace name");
+  assert(json_object_get(second, sv_new_from_cstr("name"))->type ==
+             JSON_FALSE &&
+         "escaped key");
+  assert(json_object_get(first, sv_new_from_cstr("missing")) == NULL &&
+         "unknown key");
+
+  JsonKey age;
+  assert(json_keys_find(first->keys, sv_new_from_cstr("age"), &age) &&
+         "should find interned key");
+  assert(json_object_get_key(first, age)->num_integer == 25 &&
+         json_object_get_key(second, age)->num_integer == 30 &&
+         "lookup by interned key");
+
+  json_object_set(second, sv_new_from_cstr("age"), json_new_int(31));
+  json_object_set(second, sv_new_from_cstr("email"), json_new_null());
+  assert(json_object_get_key(second, age)->num_integer == 31 &&
+         "set should reuse the interned key");
+  assert(json_object_get(second, sv_new_from_cstr("email")) != NULL &&
+         first->keys->table->len == 4 && "set should intern new keys");
+
+  StringBuffer *out = sb_new();
+  json_stringify(json, out);
+  assert(sb_compare_sv(out, sv_new_from_cstr(
+                                "[{\"name\":\"John\",\"age\":25,"
+                                "\"isStudent\":true},{\"name\":false,"
+                                "\"age\":31,\"email\":null}]")) &&
+         "stringify interned keys");
+  sb_free(out);
+  json_free(json);
+  sb_free(input);
+}
+
+void test_json_parse_zero_copy() {
+  Arena *arena = arena_new(0);
+  Allocator allocator = arena_allocator(arena);
+  JsonParseOptions options = {
+      .allocator = &allocator,
+      .zero_copy = true,
+  };
+  StringBuffer *input =
+      sb_new_from_cstr("{\"key1\": \"plain\", \"key2\": \"a\\\"b\"}");
+  Json json;
+  assert(json_parse_with_options(input, &json, &options) &&
+         "should parse zero copy");
+
+  StringBuffer *plain;
+  assert(json_object_get_string(json.object, sv_new_from_cstr("key1"),
+                                &plain) &&
+         "should get plain");
+  assert(sb_is_borrowed(plain) && "plain should borrow input");
+  assert(plain->data > input->data &&
+         plain->data < input->data + input->len && "should point into input");
+  assert(sb_compare_sv(plain, sv_new_from_cstr("plain")) && "plain value");
+
+  StringBuffer *escaped;
+  assert(json_object_get_string(json.object, sv_new_from_cstr("key2"),
+                                &escaped) &&
+         "should get escaped");
+  assert(!sb_is_borrowed(escaped) && "escaped should be decoded copy");
+  assert(sb_compare_sv(escaped, sv_new_from_cstr("a\"b")) && "escaped value");
+
+  sb_free(input);
+  arena_free(arena);
+}
+
+void test_json_parse_zero_copy_malloc() {
+  JsonParseOptions options = {
+      .allocator = NULL,
+      .zero_copy = true,
+  };
+  StringBuffer *input = sb_new_from_cstr("[\"abc\", {\"k\": \"v\"}]");
+  Json *json = json_new();
+  assert(json_parse_with_options(input, json, &options) &&
+         "should parse zero copy with malloc");
+  assert(sb_compare_sv(json->array->items[0]->string, sv_new_from_cstr("abc")));
+  json_free(json);
+  sb_free(input);
+}
+
 void test_json() {
   test_json_compare();
 
   test_json_parse_file();
+  test_json_parse_with_allocator();
+  test_json_parse_no_objects();
+  test_json_parse_intern_keys();
+  test_json_parse_zero_copy();
+  test_json_parse_zero_copy_malloc();
 
   test_json_parse_object();
   test_json_parse_object_fail();
+  test_json_object_many_keys();
+  test_json_object_small();
 
   test_json_parse_array();
   test_json_parse_array_fail();
+  test_json_parse_trailing();
+  test_json_parse_control_char();
 
   test_json_stringify_array();
+  test_json_stringify_escape();
 
   printf("All 'json' tests passed successfully!\n");
 }
@@ -0,0 +1,252 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../src/json_binary.h"
+
+// Keys are sorted so the round trip stringifies to the same text.
+static const char *binary_input =
+    "{\"a\":[1,-2,3.5,\"x\\ny\",true,false,null,[],{}],"
+    "\"big\":18446744073709551615,\"items\":[{\"id\":1,\"name\":\"one\"},"
+    "{\"id\":2,\"name\":\"two\"}],\"z\":\"\"}";
+
+void test_json_binary_round_trip() {
+  StringBuffer *input = sb_new_from_cstr(binary_input);
+  Json json;
+  assert(json_parse(input, &json) && "should parse");
+  StringBuffer *encoded = sb_new();
+  assert(json_to_binary(&json, encoded) && "should encode");
+
+  JsonBinary doc;
+  assert(json_binary_open(sv_new(encoded->data, encoded->len), &doc) &&
+         "should open");
+  JsonBinaryValue root = json_binary_root(&doc);
+  assert(json_binary_type(root) == JSON_OBJECT && json_binary_len(root) == 4 &&
+         "should read the root");
+
+  JsonBinaryValue items, item, value;
+  StringView name;
+  int64_t id;
+  assert(json_binary_object_get(root, sv_new_from_cstr("items"), &items) &&
+         json_binary_len(items) == 2 &&
+         json_binary_array_get(items, 1, &item) &&
+         json_binary_object_get(item, sv_new_from_cstr("id"), &value) &&
+         json_binary_get_int64(value, &id) && id == 2 &&
+         json_binary_object_get(item, sv_new_from_cstr("name"), &value) &&
+         json_binary_get_string(value, &name) &&
+         sv_compare(name, sv_new_from_cstr("two")) &&
+         "should look up nested values");
+  assert(!json_binary_array_get(items, 2, &item) &&
+         !json_binary_object_get(root, sv_new_from_cstr("b"), &value) &&
+         !json_binary_object_get(items, sv_new_from_cstr("a"), &value) &&
+         "should miss absent members");
+
+  uint64_t big;
+  double real;
+  bool flag;
+  assert(json_binary_object_get(root, sv_new_from_cstr("big"), &value) &&
+         json_binary_get_uint64(value, &big) && big == UINT64_MAX &&
+         "should read uint64");
+  assert(json_binary_object_get(root, sv_new_from_cstr("a"), &value) &&
+         json_binary_array_get(value, 2, &item) &&
+         json_binary_get_double(item, &real) && real == 3.5 &&
+         json_binary_array_get(value, 5, &item) &&
+         json_binary_get_bool(item, &flag) && !flag &&
+         !json_binary_get_int64(item, &id) && "should read scalars");
+
+  Json copy;
+  StringBuffer *out = sb_new();
+  StringBuffer *expected = sb_new();
+  assert(json_from_binary(root, &copy) && json_stringify(&copy, out) &&
+         json_stringify(&json, expected) &&
+         sb_compare_sv(out, sv_new(expected->data, expected->len)) &&
+         "should materialize the same document");
+
+  json_object_free(copy.object);
+  json_object_free(json.object);
+  sb_free(expected);
+  sb_free(out);
+  sb_free(encoded);
+  sb_free(input);
+}
+
+void test_json_binary_shared_keys() {
+  StringBuffer *input = sb_new_from_cstr(
+      "[{\"identifier\":1},{\"identifier\":2},{\"identifier\":3}]");
+  Json json;
+  assert(json_parse(input, &json) && "should parse");
+  StringBuffer *encoded = sb_new();
+  assert(json_to_binary(&json, encoded) && "should encode");
+  size_t count = 0;
+  for (size_t i = 0; i + 10 <= encoded->len; ++i) {
+    count += memcmp(encoded->data + i, "identifier", 10) == 0;
+  }
+  assert(count == 1 && "should store each key once");
+  json_array_free(json.array);
+  sb_free(encoded);
+  sb_free(input);
+}
+
+void test_json_binary_map() {
+  StringBuffer *input = sb_new_from_cstr(binary_input);
+  Json json;
+  assert(json_parse(input, &json) && "should parse");
+  StringBuffer *encoded = sb_new();
+  assert(json_to_binary(&json, encoded) && "should encode");
+
+  char path[] = "/tmp/json_binary_XXXXXX";
+  int fd = mkstemp(path);
+  assert(fd >= 0 && "should create a temp file");
+  assert(write(fd, encoded->data, encoded->len) == (ssize_t)encoded->len &&
+         "should write the file");
+  close(fd);
+
+  JsonBinary doc;
+  JsonBinaryValue value;
+  StringView name;
+  assert(json_binary_map(path, &doc) && doc.is_mapped && "should map");
+  assert(json_binary_object_get(json_binary_root(&doc),
+                                sv_new_from_cstr("z"), &value) &&
+         json_binary_get_string(value, &name) && name.len == 0 &&
+         "should read from the mapping");
+  json_binary_unmap(&doc);
+  assert(doc.data == NULL && "should reset on unmap");
+  unlink(path);
+
+  assert(!json_binary_map(path, &doc) && "should fail on a missing file");
+  json_object_free(json.object);
+  sb_free(encoded);
+  sb_free(input);
+}
+
+void test_json_binary_append() {
+  StringBuffer *input = sb_new_from_cstr(binary_input);
+  Json json;
+  assert(json_parse(input, &json) && "should parse");
+  StringBuffer *encoded = sb_new_from_cstr("PREFIX");
+  assert(json_to_binary(&json, encoded) && "should encode after data");
+
+  JsonBinary doc;
+  assert(json_binary_open(sv_new(encoded->data + 6, encoded->len - 6), &doc) &&
+         "should open the appended document");
+  JsonBinaryValue items, item, value;
+  int64_t id;
+  assert(json_binary_object_get(json_binary_root(&doc),
+                                sv_new_from_cstr("items"), &items) &&
+         json_binary_array_get(items, 1, &item) &&
+         json_binary_object_get(item, sv_new_from_cstr("id"), &value) &&
+         json_binary_get_int64(value, &id) && id == 2 &&
+         "offsets should be relative to the document");
+
+  json_object_free(json.object);
+  sb_free(encoded);
+  sb_free(input);
+}
+
+void test_json_binary_many_keys() {
+  Json *json = json_new_object();
+  char key[16];
+  for (int i = 0; i < 40; ++i) {
+    snprintf(key, sizeof(key), "key%d", i);
+    Json *item = json_new_object();
+    json_object_set(item->object, sv_new_from_cstr(key), json_new_int(i));
+    json_object_set(json->object, sv_new_from_cstr(key), item);
+  }
+  StringBuffer *encoded = sb_new();
+  assert(json_to_binary(json, encoded) && "should encode");
+  JsonBinary doc;
+  assert(json_binary_open(sv_new(encoded->data, encoded->len), &doc) &&
+         "should open");
+  for (int i = 0; i < 40; ++i) {
+    snprintf(key, sizeof(key), "key%d", i);
+    JsonBinaryValue item, value;
+    int64_t n;
+    assert(json_binary_object_get(json_binary_root(&doc),
+                                  sv_new_from_cstr(key), &item) &&
+           json_binary_object_get(item, sv_new_from_cstr(key), &value) &&
+           json_binary_get_int64(value, &n) && n == i &&
+           "should share keys past the initial table");
+  }
+  json_free(json);
+  sb_free(encoded);
+}
+
+void test_json_binary_fail() {
+  Json *json = json_new_array();
+  json_array_append(json->array, json_new_int(1));
+  json_array_append(json->array, json_new());
+  StringBuffer *encoded = sb_new_from_cstr("PREFIX");
+  assert(!json_to_binary(json, encoded) && "should fail on an empty value");
+  assert(sb_compare_sv(encoded, sv_new_from_cstr("PREFIX")) &&
+         "should leave dest as it was");
+  json_free(json);
+  sb_free(encoded);
+}
+
+void test_json_binary_corrupt() {
+  StringBuffer *input = sb_new_from_cstr("{\"key\":[1,2,3]}");
+  Json json;
+  assert(json_parse(input, &json) && "should parse");
+  StringBuffer *encoded = sb_new();
+  assert(json_to_binary(&json, encoded) && "should encode");
+
+  JsonBinary doc;
+  assert(!json_binary_open(sv_new(encoded->data, encoded->len - 1), &doc) &&
+         !json_binary_open(sv_new(encoded->data, 4), &doc) &&
+         !json_binary_open(sv_new_from_cstr("JSON{}{}{}"), &doc) &&
+         "should reject a bad header");
+
+  // A broken offset table must stay within the buffer.
+  char *data = (char *)encoded->data;
+  size_t table = JSON_BINARY_HEADER_SIZE + 5;
+  memset(data + table + 4, 0xff, 4);
+  assert(json_binary_open(sv_new(encoded->data, encoded->len), &doc) &&
+         "should open");
+  JsonBinaryValue value;
+  Json copy;
+  assert(json_binary_object_get(json_binary_root(&doc),
+                                sv_new_from_cstr("key"), &value) &&
+         json_binary_type(value) == JSON_EMPTY &&
+         json_binary_len(value) == 0 && "should not read past the end");
+  assert(!json_from_binary(json_binary_root(&doc), &copy) &&
+         "should reject an out of bounds offset");
+  json_object_free(copy.object);
+
+  json_object_free(json.object);
+  sb_free(encoded);
+  sb_free(input);
+}
+
+void test_json_binary_cycle() {
+  // An array whose only item points back at the array itself.
+  char data[17] = "JSB1";
+  uint32_t len = sizeof(data), count = 1, item_offset = 8;
+  memcpy(data + 4, &len, 4);
+  data[8] = '[';
+  memcpy(data + 9, &count, 4);
+  memcpy(data + 13, &item_offset, 4);
+  JsonBinary doc;
+  assert(json_binary_open(sv_new(data, sizeof(data)), &doc) &&
+         "should open");
+  JsonBinaryValue item;
+  assert(!json_binary_array_get(json_binary_root(&doc), 0, &item) &&
+         "should reject an offset pointing back");
+  Json copy;
+  assert(!json_from_binary(json_binary_root(&doc), &copy) &&
+         "should not follow a cycle");
+  json_array_free(copy.array);
+}
+
+void test_json_binary() {
+  test_json_binary_round_trip();
+  test_json_binary_shared_keys();
+  test_json_binary_map();
+  test_json_binary_append();
+  test_json_binary_many_keys();
+  test_json_binary_fail();
+  test_json_binary_corrupt();
+  test_json_binary_cycle();
+  printf("All 'json_binary' tests passed successfully!\n");
+}
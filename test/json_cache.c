@@ -0,0 +1,156 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "../src/arena.h"
+#include "../src/json_cache.h"
+
+static const char *cache_input =
+    "{\"user\": {\"name\": \"Ann\", \"visits\": 1},"
+    " \"items\": [{\"id\": 1, \"tags\": [\"a\", \"b\"]}, {\"id\": 2}],"
+    " \"config\": {\"deep\": {\"deeper\": [1, 2, 3]}}}";
+
+static void assert_matches_stringify(JsonCacheContext *ctx, Json *json) {
+  StringBuffer *cached = sb_new();
+  StringBuffer *expected = sb_new();
+  assert(json_stringify_cached(ctx, json, cached) && "should stringify");
+  json_stringify(json, expected);
+  assert(sb_compare(cached, expected) && "should match json_stringify");
+  sb_free(cached);
+  sb_free(expected);
+}
+
+void test_json_cache_stringify() {
+  StringBuffer *input = sb_new_from_cstr(cache_input);
+  Json json;
+  assert(json_parse(input, &json) && "should parse");
+  JsonCacheContext *ctx = json_cache_context_new();
+  assert_matches_stringify(ctx, &json);
+  assert_matches_stringify(ctx, &json);
+
+  Json *user = json_object_get(json.object, sv_new_from_cstr("user"));
+  Json *config = json_object_get(json.object, sv_new_from_cstr("config"));
+  Json *visits = json_object_get(user->object, sv_new_from_cstr("visits"));
+  JsonCache *root_cache = json_cache_get(ctx, &json);
+  JsonCache *user_cache = json_cache_get(ctx, user);
+  JsonCache *config_cache = json_cache_get(ctx, config);
+  assert(root_cache->epoch == 1 && "clean root should be copied");
+  assert(json_cache_get(ctx, visits) == NULL && "should only track containers");
+  visits->num_integer = 12345;
+  json_cache_touch(ctx, user);
+  assert(user_cache->dirty && root_cache->dirty && !config_cache->dirty &&
+         "should mark the path to the root");
+  assert_matches_stringify(ctx, &json);
+  assert(user_cache->epoch == 2 && root_cache->epoch == 2 &&
+         config_cache->epoch == 1 && "should only re-emit the changed path");
+
+  json_cache_object_set(ctx, user, sv_new_from_cstr("q\"uote"),
+                        json_new_string("new"));
+  assert(root_cache->dirty && "should touch on set");
+  assert_matches_stringify(ctx, &json);
+
+  // A child that left and came back must not reuse its old offset.
+  Json *items = json_object_get(json.object, sv_new_from_cstr("items"));
+  Json *first = json_cache_array_remove(ctx, items, 0);
+  assert(items->array->len == 1 && "should remove");
+  assert_matches_stringify(ctx, &json);
+  json_cache_array_append(ctx, items, first);
+  assert_matches_stringify(ctx, &json);
+
+  // Replacing a container drops the entries of the old one.
+  size_t tracked = ctx->len;
+  json_cache_object_set(ctx, &json, sv_new_from_cstr("config"),
+                        json_new_null());
+  assert(ctx->len == tracked - 3 && "should forget the replaced subtree");
+  assert_matches_stringify(ctx, &json);
+
+  json_cache_forget(ctx, &json);
+  assert(ctx->len == 0 && "should forget every container");
+  json_cache_context_free(ctx);
+  json_object_free(json.object);
+  sb_free(input);
+}
+
+void test_json_cache_hash() {
+  StringBuffer *a_input = sb_new_from_cstr(
+      "{\"a\": [1, 2.5, \"x\"], \"b\": {\"c\": null, \"d\": true}}");
+  StringBuffer *b_input = sb_new_from_cstr(
+      "{\"b\": {\"d\": true, \"c\": null}, \"a\": [1, 2.5, \"x\"]}");
+  Json a, b;
+  assert(json_parse(a_input, &a) && json_parse(b_input, &b) &&
+         "should parse");
+  JsonCacheContext *ctx = json_cache_context_new();
+  assert(json_hash(ctx, &a) == json_hash(ctx, &b) && json_equal(ctx, &a, &b) &&
+         "member order should not matter");
+  assert(json_hash(NULL, &a) == json_hash(ctx, &a) &&
+         "should hash without a context");
+
+  Json *list = json_object_get(b.object, sv_new_from_cstr("a"));
+  Json *item = list->array->items[0];
+  item->num_integer = 2;
+  json_cache_touch(ctx, list);
+  assert(!json_cache_get(ctx, &b)->hash_valid && !json_equal(ctx, &a, &b) &&
+         "should see the change");
+  item->num_integer = 1;
+  json_cache_touch(ctx, list);
+  assert(json_equal(ctx, &a, &b) && "should match again");
+
+  Json *swapped = list->array->items[1];
+  list->array->items[1] = list->array->items[2];
+  list->array->items[2] = swapped;
+  json_cache_touch(ctx, list);
+  assert(!json_equal(ctx, &a, &b) && "item order should matter");
+
+  json_cache_context_free(ctx);
+  json_object_free(a.object);
+  json_object_free(b.object);
+  sb_free(a_input);
+  sb_free(b_input);
+}
+
+// The cache lives in the context, so an arena document needs no cleanup
+// walk and the table survives many removals.
+void test_json_cache_arena() {
+  Arena *arena = arena_new(0);
+  Allocator allocator = arena_allocator(arena);
+  StringBuffer *input = sb_new();
+  sb_append_char(input, '[');
+  for (int i = 0; i < 200; ++i) {
+    if (i > 0) {
+      sb_append_char(input, ',');
+    }
+    sb_append(input, sv_new_from_cstr("{\"v\": [1]}"));
+  }
+  sb_append_char(input, ']');
+  Json json;
+  assert(json_parse_with_allocator(input, &json, &allocator) &&
+         "should parse");
+  JsonCacheContext *ctx = json_cache_context_new();
+  assert_matches_stringify(ctx, &json);
+  assert(ctx->len == 401 && "should track every container");
+
+  for (int i = 0; i < 100; ++i) {
+    json_cache_forget(ctx, json_cache_array_remove(ctx, &json, i));
+  }
+  assert(ctx->len == 201 && "should drop removed subtrees");
+  for (size_t i = 0; i < json.array->len; ++i) {
+    assert(json_cache_get(ctx, json.array->items[i]) != NULL &&
+           "should keep the others reachable");
+  }
+  assert_matches_stringify(ctx, &json);
+
+  json_cache_forget(ctx, &json);
+  assert(ctx->len == 0 && "should forget the document");
+  assert_matches_stringify(ctx, &json);
+  assert(ctx->len == 201 && "should reuse forgotten entries");
+
+  json_cache_context_free(ctx);
+  sb_free(input);
+  arena_free(arena);
+}
+
+void test_json_cache() {
+  test_json_cache_stringify();
+  test_json_cache_hash();
+  test_json_cache_arena();
+  printf("All 'json_cache' tests passed successfully!\n");
+}
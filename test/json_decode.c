@@ -0,0 +1,105 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "../src/json_decode.h"
+
+typedef struct {
+  StringView name;
+  int64_t qty;
+} Item;
+
+typedef struct {
+  double lat;
+  double lon;
+} Point;
+
+typedef struct {
+  uint64_t id;
+  StringView user;
+  bool urgent;
+  Point at;
+  JsonDecodedArray items;
+  JsonDecodedArray tags;
+  int64_t missing;
+} Order;
+
+static const JsonField item_fields[] = {
+    JSON_FIELD(Item, name, JSON_DECODE_STRING),
+    JSON_FIELD_KEY(Item, qty, "quantity", JSON_DECODE_INT64),
+};
+static const JsonSchema item_schema = JSON_SCHEMA(Item, item_fields);
+
+static const JsonField point_fields[] = {
+    JSON_FIELD(Point, lat, JSON_DECODE_DOUBLE),
+    JSON_FIELD(Point, lon, JSON_DECODE_DOUBLE),
+};
+static const JsonSchema point_schema = JSON_SCHEMA(Point, point_fields);
+
+static const JsonField order_fields[] = {
+    JSON_FIELD(Order, id, JSON_DECODE_UINT64),
+    JSON_FIELD(Order, user, JSON_DECODE_STRING),
+    JSON_FIELD(Order, urgent, JSON_DECODE_BOOL),
+    JSON_FIELD_OBJECT(Order, at, point_schema),
+    JSON_FIELD_ARRAY(Order, items, JSON_DECODE_OBJECT, &item_schema),
+    JSON_FIELD_ARRAY(Order, tags, JSON_DECODE_STRING, NULL),
+    JSON_FIELD(Order, missing, JSON_DECODE_INT64),
+};
+static const JsonSchema order_schema = JSON_SCHEMA(Order, order_fields);
+
+void test_json_decode_struct() {
+  const char *input =
+      "{\"user\": \"a\\\"b\", \"id\": 18446744073709551615, \"extra\": "
+      "{\"x\": [1, {}]}, \"urgent\": true, \"at\": {\"lon\": 2, \"lat\": "
+      "-1.5}, \"items\": [{\"name\": \"pen\", \"quantity\": 3}, {\"name\": "
+      "\"ink\", \"quantity\": -1}, {}, {\"name\": \"a\"}, {\"name\": \"b\"}],"
+      " \"tags\": [], \"missing\": null}";
+  Arena *arena = arena_new(0);
+  Order order = {.missing = 7};
+  assert(json_decode(sv_new_from_cstr(input), &order_schema, &order, arena) &&
+         "should decode");
+  assert(order.id == UINT64_MAX && order.urgent &&
+         sv_compare(order.user, sv_new_from_cstr("a\"b")) &&
+         "should decode scalars");
+  assert(order.at.lat == -1.5 && order.at.lon == 2.0 &&
+         "should decode nested objects");
+  assert(order.items.len == 5 && order.tags.len == 0 &&
+         order.missing == 7 && "should decode arrays and keep null fields");
+  Item *items = order.items.items;
+  assert(sv_compare(items[0].name, sv_new_from_cstr("pen")) &&
+         items[0].qty == 3 && items[1].qty == -1 &&
+         items[2].name.data == NULL && items[2].qty == 0 &&
+         sv_compare(items[4].name, sv_new_from_cstr("b")) &&
+         "should decode arrays of objects");
+  assert(items[0].name.data > input && items[0].name.data < input + 200 &&
+         "should borrow unescaped strings");
+  arena_free(arena);
+}
+
+void test_json_decode_invalid() {
+  static const char *cases[] = {
+      "{\"id\": -1}",           "{\"id\": \"1\"}",
+      "{\"urgent\": 1}",        "{\"items\": {}}",
+      "{\"at\": []}",           "{\"user\": 1}",
+      "{\"items\": [{\"quantity\": 1.5}]}",
+      "{\"tags\": [\"a\" \"b\"]}", "{\"id\": 1} x",
+      "{\"id\": nil}",          "[]",
+  };
+  Arena *arena = arena_new(0);
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    Order order = {0};
+    assert(!json_decode(sv_new_from_cstr(cases[i]), &order_schema, &order,
+                        arena) &&
+           "should reject mismatched input");
+  }
+  Order order = {0};
+  assert(!json_decode(sv_new("{\"id\": 1}\0x", 11), &order_schema, &order,
+                      arena) &&
+         "should reject input after a NUL byte");
+  arena_free(arena);
+}
+
+void test_json_decode() {
+  test_json_decode_struct();
+  test_json_decode_invalid();
+  printf("All 'json_decode' tests passed successfully!\n");
+}
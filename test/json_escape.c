@@ -0,0 +1,78 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/json_escape.h"
+
+void test_json_unescape() {
+  const char *src = "a\\\"b\\\\c\\/\\n\\t";
+  char dest[32];
+  ssize_t len = json_unescape(src, strlen(src), dest);
+  assert(len == 8 && "should unescape len");
+  assert(memcmp(dest, "a\"b\\c/\n\t", 8) == 0 && "should unescape");
+}
+
+void test_json_unescape_unicode() {
+  const char *src = "\\u0041\\u00e9\\u20ac\\ud83d\\ude00";
+  char dest[32];
+  ssize_t len = json_unescape(src, strlen(src), dest);
+  assert(len == 10 && "should unescape unicode len");
+  assert(memcmp(dest, "A\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80", 10) == 0 &&
+         "should unescape unicode");
+}
+
+void test_json_unescape_fail() {
+  char dest[32];
+  assert(json_unescape("\\x", 2, dest) < 0 && "should fail unknown escape");
+  assert(json_unescape("\\u12", 4, dest) < 0 && "should fail short unicode");
+  assert(json_unescape("\\ud83d", 6, dest) < 0 &&
+         "should fail lone surrogate");
+  assert(json_unescape("abc\\", 4, dest) < 0 && "should fail trailing slash");
+}
+
+void test_json_unescape_long() {
+  char src[80];
+  memset(src, 'x', sizeof(src));
+  memcpy(src + 40, "\\u00e9", 6);
+  char dest[80];
+  ssize_t len = json_unescape(src, sizeof(src), dest);
+  assert(len == 76 && memcmp(dest + 38, "xx\xc3\xa9xx", 6) == 0 &&
+         "should copy clean runs around escapes");
+  assert(json_unescape(src, sizeof(src), src) == 76 &&
+         memcmp(src + 38, "xx\xc3\xa9xx", 6) == 0 &&
+         "should unescape in place");
+}
+
+void test_json_escape_scan() {
+  const char *clean = "a clean string that is longer than one block";
+  assert(json_escape_scan(clean, strlen(clean)) == strlen(clean) &&
+         "should find nothing in clean text");
+  const char *dirty = "0123456789abcdefghij\x01\"\\";
+  assert(json_escape_scan(dirty, strlen(dirty)) == 20 &&
+         json_escape_scan(dirty + 21, 2) == 0 &&
+         json_escape_scan("\xc3\xa9\x7f", 3) == 3 &&
+         "should find quotes, backslashes and control chars");
+}
+
+void test_json_escape_string() {
+  const char *src = "say \"hi\"\\\n\t\b\f\r\x1f \xe2\x82\xac/";
+  char dest[64 * JSON_ESCAPE_MAX_GROWTH];
+  size_t len = json_escape(src, strlen(src), dest);
+  const char *expected = "say \\\"hi\\\"\\\\\\n\\t\\b\\f\\r\\u001f "
+                         "\xe2\x82\xac/";
+  assert(len == strlen(expected) && memcmp(dest, expected, len) == 0 &&
+         "should escape");
+  char back[64];
+  assert(json_unescape(dest, len, back) == (ssize_t)strlen(src) &&
+         memcmp(back, src, strlen(src)) == 0 && "should round trip");
+}
+
+void test_json_escape() {
+  test_json_unescape();
+  test_json_unescape_long();
+  test_json_escape_scan();
+  test_json_escape_string();
+  test_json_unescape_unicode();
+  test_json_unescape_fail();
+  printf("All 'json_escape' tests passed successfully!\n");
+}
@@ -0,0 +1,164 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../src/json_file_cache.h"
+
+static void write_file(const char *path, const char *content) {
+  FILE *fh = fopen(path, "w");
+  assert(fh != NULL && "should open file");
+  fputs(content, fh);
+  fclose(fh);
+}
+
+static int64_t document_id(JsonDocument *doc) {
+  Json *id = json_object_get(doc->root.object, sv_new_from_cstr("id"));
+  return id->num_integer;
+}
+
+void test_json_file_cache_get() {
+  char path[] = "/tmp/json_file_cache_XXXXXX";
+  close(mkstemp(path));
+  write_file(path, "{\"id\": 1, \"name\": \"first\"}");
+
+  JsonFileCache *cache = json_file_cache_new(1024 * 1024);
+  JsonDocument *a = json_file_cache_get(cache, path);
+  JsonDocument *b = json_file_cache_get(cache, path);
+  assert(a != NULL && a == b && document_id(a) == 1 &&
+         "should share the cached document");
+  assert(cache->hits == 1 && cache->misses == 1 && "should count hits");
+
+  write_file(path, "{\"id\": 22, \"name\": \"second one\"}");
+  JsonDocument *c = json_file_cache_get(cache, path);
+  assert(c != a && document_id(c) == 22 && cache->len == 1 &&
+         "should reload a changed file");
+  assert(document_id(a) == 1 && "old handles should stay valid");
+
+  json_document_release(a);
+  json_document_release(b);
+  json_file_cache_free(cache);
+  assert(document_id(c) == 22 && "handles should outlive the cache");
+  json_document_release(c);
+
+  cache = json_file_cache_new(1024 * 1024);
+  assert(json_file_cache_get(cache, "/tmp/missing.json") == NULL &&
+         "should fail on a missing file");
+  write_file(path, "{\"id\": ");
+  assert(json_file_cache_get(cache, path) == NULL && cache->len == 0 &&
+         "should not cache invalid json");
+  json_file_cache_free(cache);
+  unlink(path);
+}
+
+void test_json_file_cache_evict() {
+  char first[] = "/tmp/json_file_cache_XXXXXX";
+  char second[] = "/tmp/json_file_cache_XXXXXX";
+  close(mkstemp(first));
+  close(mkstemp(second));
+  write_file(first, "{\"id\": 1}");
+  write_file(second, "{\"id\": 2}");
+
+  JsonFileCache *cache = json_file_cache_new(0);
+  JsonDocument *doc = json_file_cache_get(cache, first);
+  assert(doc != NULL && cache->len == 0 && "should load past the budget");
+  json_document_release(doc);
+  json_file_cache_free(cache);
+
+  cache = json_file_cache_new(1024 * 1024);
+  doc = json_file_cache_get(cache, first);
+  size_t budget = cache->bytes;
+  json_document_release(doc);
+  json_file_cache_free(cache);
+
+  cache = json_file_cache_new(budget + budget / 2);
+  json_document_release(json_file_cache_get(cache, first));
+  json_document_release(json_file_cache_get(cache, second));
+  assert(cache->len == 1 && cache->evictions == 1 &&
+         cache->bytes <= cache->budget && "should evict to the budget");
+  json_document_release(json_file_cache_get(cache, second));
+  assert(cache->hits == 1 && "newest document should stay");
+  json_document_release(json_file_cache_get(cache, first));
+  assert(cache->misses == 3 && "evicted document should reload");
+  json_file_cache_free(cache);
+  unlink(first);
+  unlink(second);
+}
+
+void test_json_file_cache_footprint() {
+  char paths[3][28] = {"/tmp/json_file_cache_XXXXXX",
+                       "/tmp/json_file_cache_XXXXXX",
+                       "/tmp/json_file_cache_XXXXXX"};
+  for (size_t i = 0; i < 3; ++i) {
+    close(mkstemp(paths[i]));
+    write_file(paths[i], "{\"id\": 1}");
+  }
+
+  JsonFileCache *cache = json_file_cache_new(2 * ARENA_CHUNK_SIZE_INIT);
+  JsonDocument *doc = json_file_cache_get(cache, paths[0]);
+  assert(doc->bytes == sizeof(JsonDocument) + sizeof(Arena) +
+                           sizeof(ArenaChunk) + ARENA_CHUNK_SIZE_INIT &&
+         "should charge the whole arena chunk");
+  json_document_release(doc);
+  json_document_release(json_file_cache_get(cache, paths[1]));
+  json_document_release(json_file_cache_get(cache, paths[2]));
+  assert(cache->len == 1 && cache->evictions == 2 &&
+         cache->bytes <= cache->budget &&
+         "small documents should evict by their real footprint");
+  json_file_cache_free(cache);
+  for (size_t i = 0; i < 3; ++i) {
+    unlink(paths[i]);
+  }
+}
+
+typedef struct {
+  JsonFileCache *cache;
+  const char *paths[2];
+} CacheWorker;
+
+static void *_cache_worker_cb(void *arg) {
+  CacheWorker *worker = arg;
+  for (size_t i = 0; i < 500; ++i) {
+    JsonDocument *doc =
+        json_file_cache_get(worker->cache, worker->paths[i & 1]);
+    assert(doc != NULL && document_id(doc) == (int64_t)(i & 1) + 1 &&
+           "should read the right document");
+    json_document_release(doc);
+  }
+  return NULL;
+}
+
+void test_json_file_cache_threads() {
+  char first[] = "/tmp/json_file_cache_XXXXXX";
+  char second[] = "/tmp/json_file_cache_XXXXXX";
+  close(mkstemp(first));
+  close(mkstemp(second));
+  write_file(first, "{\"id\": 1}");
+  write_file(second, "{\"id\": 2}");
+
+  CacheWorker worker = {
+      .cache = json_file_cache_new(1024 * 1024),
+      .paths = {first, second},
+  };
+  pthread_t threads[4];
+  for (size_t i = 0; i < 4; ++i) {
+    pthread_create(&threads[i], NULL, _cache_worker_cb, &worker);
+  }
+  for (size_t i = 0; i < 4; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+  assert(worker.cache->hits + worker.cache->misses == 2000 &&
+         worker.cache->len == 2 && "should serve every lookup");
+  json_file_cache_free(worker.cache);
+  unlink(first);
+  unlink(second);
+}
+
+void test_json_file_cache() {
+  test_json_file_cache_get();
+  test_json_file_cache_evict();
+  test_json_file_cache_footprint();
+  test_json_file_cache_threads();
+  printf("All 'json_file_cache' tests passed successfully!\n");
+}
@@ -0,0 +1,93 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "../src/json_format.h"
+
+static const char *format_input =
+    "{ \"name\" : \"J o\\\" h n\",\n\t\"tags\": [ 1 , 2.5e3, true ,null],\r\n"
+    "  \"empty\": { }, \"none\": [\n], \"nested\": {\"a\": [{\"b\": \"}, ]\"}]"
+    "}, \"escaped\\\\\": \"x y\"  }  ";
+
+void test_json_minify() {
+  StringBuffer *input = sb_new_from_cstr(format_input);
+  assert(json_minify(input) && "should minify");
+  assert(sb_compare_sv(
+             input, sv_new_from_cstr(
+                        "{\"name\":\"J o\\\" h n\",\"tags\":[1,2.5e3,true,"
+                        "null],\"empty\":{},\"none\":[],\"nested\":{\"a\":"
+                        "[{\"b\":\"}, ]\"}]},\"escaped\\\\\":\"x y\"}")) &&
+         "should strip whitespace outside strings");
+  assert(input->data[input->len] == '\0' && "should stay terminated");
+  sb_free(input);
+
+  input = sb_new_from_cstr("[\"a b");
+  assert(!json_minify(input) && "should reject unterminated string");
+  sb_free(input);
+}
+
+void test_json_prettify() {
+  StringBuffer *out = sb_new();
+  assert(json_prettify(sv_new_from_cstr(format_input), 2, out) &&
+         "should prettify");
+  assert(sb_compare_sv(out, sv_new_from_cstr("{\n"
+                                             "  \"name\": \"J o\\\" h n\",\n"
+                                             "  \"tags\": [\n"
+                                             "    1,\n"
+                                             "    2.5e3,\n"
+                                             "    true,\n"
+                                             "    null\n"
+                                             "  ],\n"
+                                             "  \"empty\": {},\n"
+                                             "  \"none\": [],\n"
+                                             "  \"nested\": {\n"
+                                             "    \"a\": [\n"
+                                             "      {\n"
+                                             "        \"b\": \"}, ]\"\n"
+                                             "      }\n"
+                                             "    ]\n"
+                                             "  },\n"
+                                             "  \"escaped\\\\\": \"x y\"\n"
+                                             "}")) &&
+         "should indent");
+
+  sb_clear(out);
+  assert(json_prettify(sv_new_from_cstr("[1,[2]]"), 0, out) &&
+         sb_compare_sv(out, sv_new_from_cstr("[\n1,\n[\n2\n]\n]")) &&
+         "zero indent");
+  sb_free(out);
+}
+
+void test_json_format_long() {
+  StringBuffer *input = sb_new();
+  StringBuffer *expected = sb_new();
+  sb_append_char(input, '[');
+  sb_append_char(expected, '[');
+  for (size_t i = 0; i < 200; ++i) {
+    sb_append(input, sv_new_from_cstr(i > 0 ? " ,\n  \"a  b\\\\\" " :
+                                              " \"a  b\\\\\" "));
+    sb_append(expected, sv_new_from_cstr(i > 0 ? ",\"a  b\\\\\"" :
+                                                 "\"a  b\\\\\""));
+  }
+  sb_append_char(input, ']');
+  sb_append_char(expected, ']');
+
+  StringBuffer *pretty = sb_new();
+  assert(json_prettify(sv_new(input->data, input->len), 4, pretty) &&
+         "should prettify across blocks");
+  assert(json_minify(pretty) &&
+         sb_compare_sv(pretty, sv_new(expected->data, expected->len)) &&
+         "prettify then minify should round trip");
+  assert(json_minify(input) &&
+         sb_compare_sv(input, sv_new(expected->data, expected->len)) &&
+         "should minify across blocks");
+  sb_free(pretty);
+  sb_free(expected);
+  sb_free(input);
+}
+
+void test_json_format() {
+  test_json_minify();
+  test_json_prettify();
+  test_json_format_long();
+  printf("All 'json_format' tests passed successfully!\n");
+}
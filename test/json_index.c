@@ -0,0 +1,146 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/json.h"
+#include "../src/json_index.h"
+
+static const JsonIndexIsa test_isas[] = {
+    JSON_INDEX_ISA_SCALAR,
+    JSON_INDEX_ISA_SSE2,
+    JSON_INDEX_ISA_AVX2,
+    JSON_INDEX_ISA_AUTO,
+};
+
+static bool is_op(char ch) {
+  return ch == '{' || ch == '}' || ch == '[' || ch == ']' || ch == ':' ||
+         ch == ',';
+}
+
+static bool is_ws(char ch) {
+  return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+}
+
+// Byte at a time reference for the index definition. Like the scanner it
+// lets a backslash escape a quote outside of strings too.
+static size_t reference_index(const char *input, size_t len,
+                              uint32_t *positions) {
+  size_t n = 0;
+  bool in_string = false;
+  bool escape = false;
+  bool prev_scalar = false;
+  for (size_t i = 0; i < len; ++i) {
+    char ch = input[i];
+    bool escaped = escape;
+    escape = !escaped && ch == '\\';
+    bool quote = ch == '"' && !escaped;
+    if (in_string) {
+      if (quote) {
+        in_string = false;
+        positions[n++] = i;
+      }
+      prev_scalar = false;
+      continue;
+    }
+    if (quote) {
+      in_string = true;
+      positions[n++] = i;
+      prev_scalar = false;
+    } else if (is_op(ch)) {
+      positions[n++] = i;
+      prev_scalar = false;
+    } else if (is_ws(ch)) {
+      prev_scalar = false;
+    } else {
+      if (!prev_scalar) {
+        positions[n++] = i;
+      }
+      prev_scalar = true;
+    }
+  }
+  return n;
+}
+
+void test_json_index_positions() {
+  const char *input = "{\"a\\\"b\": [12, true],\"c\":\"x\\\\\"}";
+  uint32_t expected[] = {0, 1, 6, 7, 9, 10, 12, 14, 18, 19, 20, 22, 23, 24,
+                         28, 29};
+  for (size_t i = 0; i < sizeof(test_isas) / sizeof(test_isas[0]); ++i) {
+    if (!json_index_isa_supported(test_isas[i])) {
+      continue;
+    }
+    JsonIndex index;
+    assert(json_index_build_isa(sv_new_from_cstr(input), &index,
+                                test_isas[i]) &&
+           "should build index");
+    assert(index.len == sizeof(expected) / sizeof(expected[0]) &&
+           "index len");
+    assert(memcmp(index.positions, expected, sizeof(expected)) == 0 &&
+           "index positions");
+    json_index_free(&index);
+  }
+}
+
+void test_json_index_random() {
+  const char alphabet[] = "{}[]:,\"\\ \n\tab1-";
+  char input[700];
+  uint32_t expected[sizeof(input)];
+  srand(42);
+  for (size_t round = 0; round < 500; ++round) {
+    size_t len = (size_t)rand() % sizeof(input);
+    for (size_t i = 0; i < len; ++i) {
+      input[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+    }
+    size_t expected_len = reference_index(input, len, expected);
+
+    for (size_t i = 0; i < sizeof(test_isas) / sizeof(test_isas[0]); ++i) {
+      if (!json_index_isa_supported(test_isas[i])) {
+        continue;
+      }
+      JsonIndex index;
+      if (!json_index_build_isa(sv_new(input, len), &index, test_isas[i])) {
+        continue;
+      }
+      assert(index.len == expected_len && "random index len");
+      assert(memcmp(index.positions, expected,
+                    expected_len * sizeof(uint32_t)) == 0 &&
+             "random index positions");
+      json_index_free(&index);
+    }
+  }
+}
+
+void test_json_index_unterminated() {
+  JsonIndex index;
+  assert(!json_index_build(sv_new_from_cstr("[\"abc, 1]"), &index) &&
+         "should fail on unterminated string");
+}
+
+void test_json_index_lexer_seek() {
+  StringBuffer *input = sb_new_from_cstr("[\n  1,\n\n   \"ab\",\n 2]");
+  Lexer advanced = lexer_new(input);
+  Lexer seeked = lexer_new(input);
+  lexer_advance(&advanced);
+  lexer_advance(&seeked);
+  for (size_t target = 1; target <= input->len; ++target) {
+    lexer_advance(&advanced);
+    Lexer lexer = seeked;
+    lexer_seek(&lexer, input->data + target);
+    assert(lexer.ch == advanced.ch && "seek ch");
+    assert(lexer.cur == advanced.cur && "seek cur");
+    lexer_advance(&lexer);
+    lexer_advance(&advanced);
+    assert(lexer.ch == advanced.ch && "advance after seek");
+    lexer_seek(&advanced, input->data + target);
+  }
+  sb_free(input);
+}
+
+void test_json_index() {
+  test_json_index_positions();
+  test_json_index_random();
+  test_json_index_unterminated();
+  test_json_index_lexer_seek();
+  printf("All 'json_index' tests passed successfully!\n");
+}
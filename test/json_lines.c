@@ -0,0 +1,133 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../src/json_lines.h"
+
+typedef struct {
+  size_t count;
+  int64_t sum;
+  int64_t last_id;
+  size_t last_offset;
+  bool in_order;
+  size_t stop_after;
+} LinesState;
+
+static bool _lines_cb(Json *value, size_t offset, void *context) {
+  LinesState *state = context;
+  int64_t id_value;
+  int64_t *id = &id_value;
+  assert(json_object_get_int64(value->object, sv_new_from_cstr("id"), &id) &&
+         "should get id");
+  if (state->count > 0 && (*id != state->last_id + 1 ||
+                           offset <= state->last_offset)) {
+    state->in_order = false;
+  }
+  state->last_id = *id;
+  state->last_offset = offset;
+  state->sum += *id;
+  state->count++;
+  return state->stop_after == 0 || state->count < state->stop_after;
+}
+
+static StringBuffer *lines_input(size_t n) {
+  StringBuffer *input = sb_new();
+  char line[128];
+  for (size_t i = 0; i < n; ++i) {
+    snprintf(line, sizeof(line),
+             "{\"id\": %zu, \"name\": \"user %zu\", \"tags\": [1, 2]}%s", i,
+             i, i % 7 == 0 ? "\r\n\n" : "\n");
+    sb_append(input, sv_new_from_cstr(line));
+  }
+  return input;
+}
+
+void test_json_lines_ordered() {
+  size_t n = 20000;
+  StringBuffer *input = lines_input(n);
+  JsonLinesHandler handler = {.on_value = _lines_cb, .ordered = true};
+  for (size_t threads = 1; threads <= 4; threads += 3) {
+    LinesState state = {.in_order = true};
+    handler.context = &state;
+    assert(json_parse_lines(sv_new(input->data, input->len), threads,
+                            &handler) &&
+           "should parse lines");
+    assert(state.count == n && state.in_order && "should deliver in order");
+  }
+
+  // Workers waiting on the reorder window have to wake up on failure.
+  LinesState state = {.in_order = true, .stop_after = 10};
+  handler.context = &state;
+  assert(!json_parse_lines(sv_new(input->data, input->len), 4, &handler) &&
+         state.count == 10 && state.in_order &&
+         "callback should stop an ordered parse");
+  sb_free(input);
+}
+
+void test_json_lines_unordered() {
+  size_t n = 20000;
+  StringBuffer *input = lines_input(n);
+  LinesState state = {0};
+  JsonLinesHandler handler = {.on_value = _lines_cb, .context = &state};
+  assert(json_parse_lines(sv_new(input->data, input->len), 0, &handler) &&
+         "should parse lines");
+  assert(state.count == n && state.sum == (int64_t)(n * (n - 1) / 2) &&
+         "should deliver every line");
+
+  state = (LinesState){.stop_after = 10};
+  assert(!json_parse_lines(sv_new(input->data, input->len), 4, &handler) &&
+         state.count == 10 && "callback should stop the parse");
+
+  sb_append(input, sv_new_from_cstr("{\"id\": }\n"));
+  state = (LinesState){0};
+  assert(!json_parse_lines(sv_new(input->data, input->len), 4, &handler) &&
+         "should fail on an invalid line");
+  sb_free(input);
+}
+
+void test_json_lines_one_per_line() {
+  LinesState state = {0};
+  JsonLinesHandler handler = {.on_value = _lines_cb, .context = &state};
+  StringView two = sv_new_from_cstr("{\"id\": 0} {\"id\": 1}\n");
+  assert(!json_parse_lines(two, 1, &handler) &&
+         "should fail on two values in one line");
+  state = (LinesState){0};
+  StringView garbage = sv_new_from_cstr("{\"id\": 0}\n{\"id\": 1} garbage\n");
+  assert(!json_parse_lines(garbage, 1, &handler) &&
+         "should fail on trailing garbage");
+  state = (LinesState){0};
+  StringView nul = sv_new("{\"id\": 0}\0{\"id\": 1}\n", 20);
+  assert(!json_parse_lines(nul, 1, &handler) &&
+         "should fail on a value after a NUL byte");
+  state = (LinesState){0};
+  StringView spaces = sv_new_from_cstr("{\"id\": 0}  \t\r\n{\"id\": 1} \n");
+  assert(json_parse_lines(spaces, 1, &handler) && state.count == 2 &&
+         "should allow trailing whitespace");
+}
+
+void test_json_lines_file() {
+  char path[] = "/tmp/json_lines_XXXXXX";
+  int fd = mkstemp(path);
+  assert(fd >= 0 && "should create temp file");
+  StringBuffer *input = lines_input(100);
+  assert(write(fd, input->data, input->len) == (ssize_t)input->len &&
+         "should write temp file");
+  close(fd);
+
+  LinesState state = {.in_order = true};
+  JsonLinesHandler handler = {
+      .on_value = _lines_cb, .context = &state, .ordered = true};
+  assert(json_parse_lines_parallel(path, 2, &handler) && state.count == 100 &&
+         state.in_order && "should parse file");
+  unlink(path);
+  sb_free(input);
+}
+
+void test_json_lines() {
+  test_json_lines_ordered();
+  test_json_lines_unordered();
+  test_json_lines_one_per_line();
+  test_json_lines_file();
+  printf("All 'json_lines' tests passed successfully!\n");
+}
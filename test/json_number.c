@@ -0,0 +1,228 @@
+#include <assert.h>
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/json.h"
+#include "../src/json_number.h"
+#include "../src/json_sax.h"
+
+static bool parse_cstr(const char *input, JsonNumber *dest) {
+  size_t consumed;
+  return json_number_parse(input, strlen(input), dest, &consumed) &&
+         consumed == strlen(input);
+}
+
+static void assert_double(const char *input) {
+  JsonNumber number;
+  assert(parse_cstr(input, &number) && "should parse double");
+  assert(number.type == JSON_NUMBER_DOUBLE && "should be double");
+  double expected = strtod(input, NULL);
+  assert(memcmp(&number.floating, &expected, sizeof(double)) == 0 &&
+         "should match strtod");
+}
+
+void test_json_number_integers() {
+  JsonNumber number;
+  assert(parse_cstr("0", &number) && number.type == JSON_NUMBER_INT &&
+         number.integer == 0 && "zero");
+  assert(parse_cstr("-42", &number) && number.integer == -42 && "negative");
+  assert(parse_cstr("9223372036854775807", &number) &&
+         number.type == JSON_NUMBER_INT && number.integer == INT64_MAX &&
+         "int64 max");
+  assert(parse_cstr("-9223372036854775808", &number) &&
+         number.type == JSON_NUMBER_INT && number.integer == INT64_MIN &&
+         "int64 min");
+  assert(parse_cstr("9223372036854775808", &number) &&
+         number.type == JSON_NUMBER_UINT &&
+         number.unsigned_integer == (uint64_t)INT64_MAX + 1 &&
+         "above int64 max");
+  assert(parse_cstr("18446744073709551615", &number) &&
+         number.type == JSON_NUMBER_UINT &&
+         number.unsigned_integer == UINT64_MAX && "uint64 max");
+  assert_double("18446744073709551616");
+  assert_double("-9223372036854775809");
+  assert_double("123456789012345678901234567890");
+}
+
+void test_json_number_doubles() {
+  const char *inputs[] = {
+      "0.0",
+      "-0.0",
+      "1.5",
+      "-1.5",
+      "3.141592653589793",
+      "1e10",
+      "1E+10",
+      "1e-10",
+      "0.1",
+      "0.30000000000000004",
+      "2.2250738585072014e-308",
+      "2.2250738585072011e-308",
+      "4.9406564584124654e-324",
+      "2.4703282292062327e-324",
+      "2.4703282292062328e-324",
+      "1.7976931348623157e308",
+      "1.7976931348623159e308",
+      "1e400",
+      "1e-400",
+      "9007199254740993.0",
+      "0.000000000000000000000000000000000000000001",
+      "1.00000000000000011102230246251565404236316680908203125",
+      "1.00000000000000011102230246251565404236316680908203124",
+      "1.00000000000000011102230246251565404236316680908203126",
+      "7.2057594037927933e16",
+  };
+  for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+    assert_double(inputs[i]);
+  }
+}
+
+void test_json_number_invalid() {
+  const char *inputs[] = {"", "-", "+1", ".5", "1.", "1e", "1e+", "-x"};
+  JsonNumber number;
+  size_t consumed;
+  for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+    assert(!json_number_parse(inputs[i], strlen(inputs[i]), &number,
+                              &consumed) &&
+           "should reject invalid number");
+  }
+  assert(json_number_parse("01", 2, &number, &consumed) && consumed == 1 &&
+         "leading zero ends the number");
+  assert(json_number_parse("12,", 3, &number, &consumed) && consumed == 2 &&
+         "should stop at delimiter");
+}
+
+void test_json_number_random() {
+  srand(7);
+  char input[64];
+  for (size_t i = 0; i < 100000; ++i) {
+    uint64_t bits = 0;
+    for (size_t j = 0; j < 4; ++j) {
+      bits = bits << 16 | (uint64_t)(rand() & 0xFFFF);
+    }
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    if (value != value || value - value != 0) {
+      continue;
+    }
+    snprintf(input, sizeof(input), "%.*e", (int)(i % 20), value);
+    assert_double(input);
+  }
+  for (size_t i = 0; i < 10000; ++i) {
+    size_t len = 0;
+    size_t digits = 20 + (size_t)rand() % 30;
+    input[len++] = (char)('1' + rand() % 9);
+    for (size_t j = 1; j < digits; ++j) {
+      input[len++] = (char)('0' + rand() % 10);
+    }
+    snprintf(input + len, sizeof(input) - len, "e%d", rand() % 600 - 330);
+    assert_double(input);
+  }
+}
+
+void test_json_number_parse() {
+  StringBuffer *input = sb_new_from_cstr(
+      "[9223372036854775807, 18446744073709551615, -1.25e2, 3]");
+  Json *json = json_new();
+  assert(json_parse(input, json) && "should parse numbers");
+  JsonArray *items = json->array;
+  assert(items->items[0]->type == JSON_INT &&
+         items->items[0]->num_integer == INT64_MAX && "int64 value");
+  assert(items->items[1]->type == JSON_UINT &&
+         items->items[1]->num_unsigned == UINT64_MAX && "uint64 value");
+  assert(items->items[2]->type == JSON_DOUBLE &&
+         items->items[2]->num_double == -125.0 && "exponent value");
+
+  StringBuffer *output = sb_new();
+  json_stringify(json, output);
+  assert(sb_compare_sv(output, sv_new_from_cstr("[9223372036854775807,"
+                                                "18446744073709551615,"
+                                                "-125.0,3]")) &&
+         "should stringify 64 bit integers");
+  sb_free(output);
+  json_free(json);
+  sb_free(input);
+}
+
+static void assert_format(double value, const char *expected) {
+  char buf[JSON_NUMBER_FORMAT_CAP];
+  size_t len = json_number_format_double(value, buf);
+  assert(len == strlen(expected) && memcmp(buf, expected, len) == 0 &&
+         "should format double");
+}
+
+void test_json_number_format() {
+  char buf[JSON_NUMBER_FORMAT_CAP];
+  assert(json_number_format_int64(INT64_MIN, buf) == 20 &&
+         memcmp(buf, "-9223372036854775808", 20) == 0 && "int64 min");
+  assert(json_number_format_uint64(UINT64_MAX, buf) == 20 &&
+         memcmp(buf, "18446744073709551615", 20) == 0 && "uint64 max");
+  assert(json_number_format_int64(7, buf) == 1 && buf[0] == '7' && "digit");
+
+  assert_format(0.0, "0.0");
+  assert_format(-0.0, "-0.0");
+  assert_format(1.0, "1.0");
+  assert_format(-125.0, "-125.0");
+  assert_format(0.1, "0.1");
+  assert_format(0.3, "0.3");
+  assert_format(0.1 + 0.2, "0.30000000000000004");
+  assert_format(1.5e-7, "1.5e-7");
+  assert_format(0.00001234, "0.00001234");
+  assert_format(1e21, "1e21");
+  assert_format(123456789012345680000.0, "123456789012345680000.0");
+  assert_format(1.7976931348623157e308, "1.7976931348623157e308");
+  assert_format(4.9406564584124654e-324, "5e-324");
+  assert_format(0.0 / 0.0, "null");
+  assert_format(1.0 / 0.0, "null");
+
+  srand(11);
+  char input[JSON_NUMBER_FORMAT_CAP + 1];
+  for (size_t i = 0; i < 100000; ++i) {
+    uint64_t bits = 0;
+    for (size_t j = 0; j < 4; ++j) {
+      bits = bits << 16 | (uint64_t)(rand() & 0xFFFF);
+    }
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    if (value != value || value - value != 0) {
+      continue;
+    }
+    size_t len = json_number_format_double(value, input);
+    input[len] = '\0';
+    double parsed = strtod(input, NULL);
+    assert(memcmp(&parsed, &value, sizeof(double)) == 0 &&
+           "formatted double should round trip");
+  }
+}
+
+void test_json_number_locale() {
+  const char *input = "1.00000000000000011102230246251565404236316680908203125";
+  double expected = strtod(input, NULL);
+  const char *locales[] = {"de_DE.UTF-8", "fr_FR.UTF-8", "de_DE", "fr_FR"};
+  bool is_set = false;
+  for (size_t i = 0; i < sizeof(locales) / sizeof(locales[0]) && !is_set;
+       ++i) {
+    is_set = setlocale(LC_NUMERIC, locales[i]) != NULL;
+  }
+  if (!is_set) {
+    return;
+  }
+  JsonNumber number;
+  assert(parse_cstr(input, &number) &&
+         memcmp(&number.floating, &expected, sizeof(double)) == 0 &&
+         "should ignore a comma decimal locale");
+  setlocale(LC_NUMERIC, "C");
+}
+
+void test_json_number() {
+  test_json_number_integers();
+  test_json_number_doubles();
+  test_json_number_invalid();
+  test_json_number_random();
+  test_json_number_parse();
+  test_json_number_format();
+  test_json_number_locale();
+  printf("All 'json_number' tests passed successfully!\n");
+}
@@ -0,0 +1,112 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "../src/json_ondemand.h"
+
+void test_json_ondemand_navigate() {
+  StringBuffer *input = sb_new_from_cstr(
+      "{\"skip\": {\"deep\": [1, {\"x\": [[], {}]}, \"]}\"]},"
+      " \"user\": {\"name\": \"Ann\", \"age\": 31,"
+      " \"big\": 18446744073709551615,"
+      " \"score\": -2.5, \"admin\": false, \"note\": null},"
+      " \"tags\": [\"a\", \"b\\\"c\", 3],"
+      " \"k\\u0065y\": true}");
+  JsonOdDocument doc;
+  assert(json_od_open(input, &doc) && "should open");
+  JsonOdValue root = json_od_root(&doc);
+  assert(json_od_type(root) == JSON_OBJECT && "root type");
+
+  JsonOdValue user;
+  assert(json_od_object_get(root, sv_new_from_cstr("user"), &user) &&
+         "should find user after skipped subtree");
+  JsonOdValue value;
+  StringView string;
+  assert(json_od_object_get(user, sv_new_from_cstr("name"), &value) &&
+         json_od_get_string(value, &string) &&
+         sv_compare(string, sv_new_from_cstr("Ann")) && "name");
+  int64_t age;
+  assert(json_od_object_get(user, sv_new_from_cstr("age"), &value) &&
+         json_od_type(value) == JSON_INT && json_od_get_int64(value, &age) &&
+         age == 31 && "age");
+  uint64_t big;
+  assert(json_od_object_get(user, sv_new_from_cstr("big"), &value) &&
+         !json_od_get_int64(value, &age) && json_od_get_uint64(value, &big) &&
+         big == UINT64_MAX && "big");
+  double score;
+  assert(json_od_object_get(user, sv_new_from_cstr("score"), &value) &&
+         json_od_get_double(value, &score) && score == -2.5 && "score");
+  bool admin = true;
+  assert(json_od_object_get(user, sv_new_from_cstr("admin"), &value) &&
+         json_od_get_bool(value, &admin) && !admin && "admin");
+  assert(json_od_object_get(user, sv_new_from_cstr("note"), &value) &&
+         json_od_is_null(value) && "note");
+  assert(!json_od_object_get(user, sv_new_from_cstr("missing"), &value) &&
+         "missing key");
+
+  JsonOdValue tags;
+  assert(json_od_object_get(root, sv_new_from_cstr("tags"), &tags) &&
+         json_od_type(tags) == JSON_ARRAY && "tags");
+  assert(json_od_array_get(tags, 1, &value) &&
+         json_od_get_string(value, &string) &&
+         sv_compare(string, sv_new_from_cstr("b\"c")) && "escaped string");
+  assert(!json_od_array_get(tags, 3, &value) && "out of range");
+  assert(!json_od_get_string(tags, &string) && "wrong type");
+
+  assert(json_od_object_get(root, sv_new_from_cstr("key"), &value) &&
+         json_od_type(value) == JSON_TRUE && "escaped key");
+
+  json_od_close(&doc);
+  sb_free(input);
+}
+
+void test_json_ondemand_iter() {
+  StringBuffer *input =
+      sb_new_from_cstr("[{\"a\": 1, \"b\": [2, 3]}, [], {}, \"s\"]");
+  JsonOdDocument doc;
+  assert(json_od_open(input, &doc) && "should open");
+  JsonOdIter items = json_od_iter(json_od_root(&doc));
+  JsonOdValue item;
+  size_t count = 0;
+  while (json_od_array_next(&items, &item)) {
+    count++;
+  }
+  assert(count == 4 && "array len");
+
+  JsonOdValue first;
+  assert(json_od_array_get(json_od_root(&doc), 0, &first) && "first");
+  JsonOdIter members = json_od_iter(first);
+  StringView key;
+  JsonOdValue value;
+  assert(json_od_object_next(&members, &key, &value) &&
+         sv_compare(key, sv_new_from_cstr("a")) && "first key");
+  assert(json_od_object_next(&members, &key, &value) &&
+         sv_compare(key, sv_new_from_cstr("b")) &&
+         json_od_type(value) == JSON_ARRAY && "second key");
+  assert(!json_od_object_next(&members, &key, &value) && "end of object");
+  assert(!json_od_array_next(&members, &value) && "object is not an array");
+
+  JsonOdValue empty;
+  assert(json_od_array_get(json_od_root(&doc), 2, &empty) && "empty object");
+  members = json_od_iter(empty);
+  assert(!json_od_object_next(&members, &key, &value) && "no members");
+
+  json_od_close(&doc);
+  sb_free(input);
+}
+
+void test_json_ondemand_invalid() {
+  const char *inputs[] = {"", "[1, 2", "{\"a\" 1}", "[1] 2", "\"abc"};
+  for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+    StringBuffer *input = sb_new_from_cstr(inputs[i]);
+    JsonOdDocument doc;
+    assert(!json_od_open(input, &doc) && "should reject invalid document");
+    sb_free(input);
+  }
+}
+
+void test_json_ondemand() {
+  test_json_ondemand_navigate();
+  test_json_ondemand_iter();
+  test_json_ondemand_invalid();
+  printf("All 'json_ondemand' tests passed successfully!\n");
+}
@@ -0,0 +1,91 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/arena.h"
+#include "../src/json_parser.h"
+
+static bool json_parser_feed_split(JsonParser *parser, const char *input,
+                                   size_t step) {
+  size_t len = strlen(input);
+  for (size_t i = 0; i < len; i += step) {
+    size_t n = i + step > len ? len - i : step;
+    if (!json_parser_feed(parser, sv_new(input + i, n))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void test_json_parser_chunks() {
+  const char *input = "{\"name\": \"Jo\\\"hn\", \"age\": 25, \"tags\": [true, "
+                      "false, null, -1.5, \"\"], \"nested\": {}}";
+  for (size_t step = 1; step <= 8; ++step) {
+    JsonParser *parser = json_parser_new(NULL);
+    assert(json_parser_feed_split(parser, input, step) && "should feed");
+    Json json;
+    assert(json_parser_finish(parser, &json) && "should finish");
+
+    StringBuffer *name;
+    assert(json_object_get_string(json.object, sv_new_from_cstr("name"),
+                                  &name) &&
+           "should get name");
+    assert(sb_compare_sv(name, sv_new_from_cstr("Jo\"hn")) && "name value");
+    assert(json_object_get(json.object, sv_new_from_cstr("age"))->num_integer ==
+               25 &&
+           "age value");
+    JsonArray *tags;
+    assert(json_object_get_array(json.object, sv_new_from_cstr("tags"),
+                                 &tags) &&
+           "should get tags");
+    assert(tags->len == 5 && "tags len");
+    assert(tags->items[3]->num_double == -1.5 && "tags double");
+    assert(tags->items[4]->string->len == 0 && "tags empty string");
+
+    json_parser_free(parser);
+    json_object_free(json.object);
+  }
+}
+
+void test_json_parser_scalar() {
+  JsonParser *parser = json_parser_new(NULL);
+  assert(json_parser_feed(parser, sv_new_from_cstr(" 12")) && "feed");
+  assert(json_parser_feed(parser, sv_new_from_cstr("34 ")) && "feed");
+  Json json;
+  assert(json_parser_finish(parser, &json) && "should finish scalar");
+  assert(json.type == JSON_INT && json.num_integer == 1234 && "scalar value");
+  json_parser_free(parser);
+}
+
+void test_json_parser_arena() {
+  Arena *arena = arena_new(0);
+  Allocator allocator = arena_allocator(arena);
+  JsonParser *parser = json_parser_new(&allocator);
+  assert(json_parser_feed_split(parser, "[[1, 2], [3]]", 3) && "feed");
+  Json json;
+  assert(json_parser_finish(parser, &json) && "should finish");
+  assert(json.array->items[1]->array->items[0]->num_integer == 3 && "value");
+  json_parser_free(parser);
+  arena_free(arena);
+}
+
+void test_json_parser_fail() {
+  const char *inputs[] = {"[1, 2", "{\"a\" 1}", "[1] 2", "[tru]", "{\"a\":}",
+                          "[1}", "[\"a\x01b\"]"};
+  for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+    JsonParser *parser = json_parser_new(NULL);
+    bool is_success = json_parser_feed_split(parser, inputs[i], 2);
+    Json json;
+    assert(!(is_success && json_parser_finish(parser, &json)) &&
+           "should fail");
+    json_parser_free(parser);
+  }
+}
+
+void test_json_parser() {
+  test_json_parser_chunks();
+  test_json_parser_scalar();
+  test_json_parser_arena();
+  test_json_parser_fail();
+  printf("All 'json_parser' tests passed successfully!\n");
+}
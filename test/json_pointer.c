@@ -0,0 +1,129 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "../src/json_format.h"
+#include "../src/json_pointer.h"
+
+static const char *pointer_input =
+    "{\"users\": [{\"name\": \"Ann\", \"age\": 31},"
+    " {\"name\": \"Bob\", \"tags\": [\"x\", {\"deep\": null}]}],"
+    " \"a/b\": 1, \"m~n\": [2, 3], \"10\": \"ten\", \"\": {\"\": 0},"
+    " \"k\\u0065y\": true, \"users2\": {\"0\": \"zero\"}}";
+
+void test_json_pointer_compile() {
+  JsonPointer *p = json_pointer_compile(sv_new_from_cstr("/a~1b/m~0n/0/"));
+  assert(p != NULL && p->len == 4 && "should compile");
+  assert(sb_compare_sv(p->tokens[0].key, sv_new_from_cstr("a/b")) &&
+         sb_compare_sv(p->tokens[1].key, sv_new_from_cstr("m~n")) &&
+         "should decode escapes");
+  assert(p->tokens[2].is_index && p->tokens[2].index == 0 &&
+         !p->tokens[1].is_index && p->tokens[3].key->len == 0 &&
+         "should classify tokens");
+  json_pointer_free(p);
+
+  p = json_pointer_compile(sv_new_from_cstr(""));
+  assert(p != NULL && p->len == 0 && "empty pointer is the root");
+  json_pointer_free(p);
+
+  p = json_pointer_compile(sv_new_from_cstr("/01"));
+  assert(p != NULL && !p->tokens[0].is_index && "leading zero is a key");
+  json_pointer_free(p);
+
+  assert(json_pointer_compile(sv_new_from_cstr("users")) == NULL &&
+         json_pointer_compile(sv_new_from_cstr("/a~2")) == NULL &&
+         json_pointer_compile(sv_new_from_cstr("/a~")) == NULL &&
+         "should reject invalid pointers");
+}
+
+typedef struct {
+  const char *pointer;
+  const char *raw;
+} PointerCase;
+
+static const PointerCase pointer_cases[] = {
+    {"/users/0/name", "\"Ann\""},
+    {"/users/1/tags/1", "{\"deep\": null}"},
+    {"/users/1/tags/1/deep", "null"},
+    {"/users/0", "{\"name\": \"Ann\", \"age\": 31}"},
+    {"/a~1b", "1"},
+    {"/m~0n/1", "3"},
+    {"/10", "\"ten\""},
+    {"//", "0"},
+    {"/key", "true"},
+    {"/users2/0", "\"zero\""},
+    {"/users/2", NULL},
+    {"/users/name", NULL},
+    {"/missing", NULL},
+    {"/a~1b/x", NULL},
+};
+
+void test_json_pointer_get() {
+  StringBuffer *input = sb_new_from_cstr(pointer_input);
+  Json json;
+  assert(json_parse(input, &json) && "should parse");
+  size_t len = sizeof(pointer_cases) / sizeof(pointer_cases[0]);
+  for (size_t i = 0; i < len; ++i) {
+    JsonPointer *p = json_pointer_compile(
+        sv_new_from_cstr(pointer_cases[i].pointer));
+    Json *value = json_pointer_get(p, &json);
+    if (pointer_cases[i].raw == NULL) {
+      assert(value == NULL && "should not resolve");
+    } else {
+      assert(value != NULL && "should resolve");
+      StringBuffer *out = sb_new();
+      StringBuffer *expected = sb_new_from_cstr(pointer_cases[i].raw);
+      json_minify(expected);
+      json_stringify(value, out);
+      assert(sb_compare_sv(out, sv_new(expected->data, expected->len)) &&
+             "should resolve the right value");
+      sb_free(out);
+      sb_free(expected);
+    }
+    json_pointer_free(p);
+  }
+
+  JsonPointer *root = json_pointer_compile(sv_new_from_cstr(""));
+  assert(json_pointer_get(root, &json) == &json && "should get root");
+  json_pointer_free(root);
+  json_object_free(json.object);
+  sb_free(input);
+}
+
+void test_json_pointer_extract() {
+  size_t len = sizeof(pointer_cases) / sizeof(pointer_cases[0]);
+  JsonPointer *pointers[sizeof(pointer_cases) / sizeof(pointer_cases[0])];
+  for (size_t i = 0; i < len; ++i) {
+    pointers[i] =
+        json_pointer_compile(sv_new_from_cstr(pointer_cases[i].pointer));
+  }
+  StringView raw[sizeof(pointer_cases) / sizeof(pointer_cases[0])];
+  assert(json_pointer_extract(sv_new_from_cstr(pointer_input), pointers, len,
+                              raw) &&
+         "should extract");
+  for (size_t i = 0; i < len; ++i) {
+    if (pointer_cases[i].raw == NULL) {
+      assert(raw[i].data == NULL && "should not find");
+    } else {
+      assert(sv_compare(raw[i], sv_new_from_cstr(pointer_cases[i].raw)) &&
+             "should extract raw value");
+    }
+  }
+
+  assert(json_pointer_extract(sv_new_from_cstr("{\"users\": [1, }"), pointers,
+                              len, raw) == false &&
+         "should reject invalid input");
+  assert(json_pointer_extract(sv_new_from_cstr("{\"a/b\": 1, }"), &pointers[4],
+                              1, raw) &&
+         sv_compare(raw[0], sv_new_from_cstr("1")) &&
+         "should stop once every pointer is found");
+  for (size_t i = 0; i < len; ++i) {
+    json_pointer_free(pointers[i]);
+  }
+}
+
+void test_json_pointer() {
+  test_json_pointer_compile();
+  test_json_pointer_get();
+  test_json_pointer_extract();
+  printf("All 'json_pointer' tests passed successfully!\n");
+}
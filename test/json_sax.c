@@ -0,0 +1,134 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "../src/json_sax.h"
+
+typedef struct {
+  size_t objects;
+  size_t arrays;
+  size_t keys;
+  size_t strings;
+  int64_t int_sum;
+  double double_sum;
+  size_t bools;
+  size_t nulls;
+  StringBuffer *last_string;
+} SaxCounts;
+
+bool _sax_object_begin_cb(void *context) {
+  ((SaxCounts *)context)->objects++;
+  return true;
+}
+
+bool _sax_array_begin_cb(void *context) {
+  ((SaxCounts *)context)->arrays++;
+  return true;
+}
+
+bool _sax_key_cb(StringView key, void *context) {
+  (void)key;
+  ((SaxCounts *)context)->keys++;
+  return true;
+}
+
+bool _sax_string_cb(StringView value, void *context) {
+  SaxCounts *counts = context;
+  counts->strings++;
+  sb_clear(counts->last_string);
+  sb_append(counts->last_string, value);
+  return true;
+}
+
+bool _sax_int_cb(int64_t value, void *context) {
+  ((SaxCounts *)context)->int_sum += value;
+  return true;
+}
+
+bool _sax_double_cb(double value, void *context) {
+  ((SaxCounts *)context)->double_sum += value;
+  return true;
+}
+
+bool _sax_bool_cb(bool value, void *context) {
+  (void)value;
+  ((SaxCounts *)context)->bools++;
+  return true;
+}
+
+bool _sax_null_cb(void *context) {
+  ((SaxCounts *)context)->nulls++;
+  return true;
+}
+
+void test_json_sax_events() {
+  SaxCounts counts = {.last_string = sb_new()};
+  JsonSaxHandler handler = {
+      .on_object_begin = _sax_object_begin_cb,
+      .on_array_begin = _sax_array_begin_cb,
+      .on_key = _sax_key_cb,
+      .on_string = _sax_string_cb,
+      .on_int = _sax_int_cb,
+      .on_double = _sax_double_cb,
+      .on_bool = _sax_bool_cb,
+      .on_null = _sax_null_cb,
+      .context = &counts,
+  };
+  StringBuffer *input = sb_new_from_cstr(
+      "[{\"a\": 1, \"b\": [2, 3.5, true, null]}, {}, \"x\\ny\", -4, false]");
+  assert(json_sax_parse(input, &handler) && "should sax parse");
+  assert(counts.objects == 2 && "objects");
+  assert(counts.arrays == 2 && "arrays");
+  assert(counts.keys == 2 && "keys");
+  assert(counts.strings == 1 && "strings");
+  assert(sb_compare_sv(counts.last_string, sv_new_from_cstr("x\ny")) &&
+         "should decode escaped string");
+  assert(counts.int_sum == -1 && "ints");
+  assert(counts.double_sum == 3.5 && "doubles");
+  assert(counts.bools == 2 && "bools");
+  assert(counts.nulls == 1 && "nulls");
+
+  sb_free(input);
+  sb_free(counts.last_string);
+}
+
+bool _sax_stop_at_key_cb(StringView key, void *context) {
+  (void)context;
+  return !sv_compare(key, sv_new_from_cstr("stop"));
+}
+
+void test_json_sax_stop() {
+  JsonSaxHandler handler = {
+      .on_key = _sax_stop_at_key_cb,
+  };
+  StringBuffer *input = sb_new_from_cstr("{\"go\": 1, \"stop\": 2}");
+  assert(!json_sax_parse(input, &handler) && "should stop on callback");
+  sb_free(input);
+}
+
+void test_json_sax_fail() {
+  JsonSaxHandler handler = {0};
+  StringBuffer *input = sb_new_from_cstr("{\"key\" 1}");
+  assert(!json_sax_parse(input, &handler) && "should fail on missing colon");
+  sb_free(input);
+}
+
+void test_json_sax_trailing() {
+  JsonSaxHandler handler = {0};
+  StringBuffer *input = sb_new_from_cstr("{} junk");
+  assert(!json_sax_parse(input, &handler) && "should fail on trailing input");
+  sb_free(input);
+  // A NUL byte is not the end of the input.
+  StringBuffer nul = {.data = "[1]\0garbage", .cap = 0, .len = 11};
+  assert(!json_sax_parse(&nul, &handler) && "should fail after a NUL byte");
+  input = sb_new_from_cstr(" [1, 2] \n");
+  assert(json_sax_parse(input, &handler) && "should allow trailing spaces");
+  sb_free(input);
+}
+
+void test_json_sax() {
+  test_json_sax_events();
+  test_json_sax_stop();
+  test_json_sax_fail();
+  test_json_sax_trailing();
+  printf("All 'json_sax' tests passed successfully!\n");
+}
@@ -0,0 +1,108 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "../src/json_tape.h"
+
+void test_json_tape_accessors() {
+  StringBuffer *input = sb_new_from_cstr(
+      "{\"name\": \"Ann\", \"age\": 31, \"big\": 18446744073709551615,"
+      " \"score\": -2.5, \"admin\": true, \"note\": null,"
+      " \"tags\": [\"a\", [1, 2], {\"k\": \"v\\n\"}, false],"
+      " \"empty\": {}}");
+  JsonTape tape;
+  assert(json_tape_parse(input, &tape) && "should parse");
+  JsonTapeValue root = json_tape_root(&tape);
+  assert(json_tape_type(root) == JSON_OBJECT && json_tape_len(root) == 8 &&
+         "root");
+
+  StringView name;
+  assert(json_tape_object_get_string(root, sv_new_from_cstr("name"), &name) &&
+         sv_compare(name, sv_new_from_cstr("Ann")) && "name");
+  int64_t age;
+  assert(json_tape_object_get_int64(root, sv_new_from_cstr("age"), &age) &&
+         age == 31 && "age");
+  JsonTapeValue value;
+  uint64_t big;
+  assert(json_tape_object_get(root, sv_new_from_cstr("big"), &value) &&
+         json_tape_type(value) == JSON_UINT &&
+         json_tape_get_uint64(value, &big) && big == UINT64_MAX && "big");
+  assert(json_tape_object_get_uint64(root, sv_new_from_cstr("big"), &big) &&
+         big == UINT64_MAX && "big by key");
+  assert(json_tape_object_get_uint64(root, sv_new_from_cstr("age"), &big) &&
+         big == 31 && "non-negative int as uint64");
+  assert(!json_tape_object_get_uint64(root, sv_new_from_cstr("score"),
+                                      &big) &&
+         "double is not uint64");
+  double score;
+  assert(json_tape_object_get_double(root, sv_new_from_cstr("score"),
+                                     &score) &&
+         score == -2.5 && "score");
+  bool admin;
+  assert(json_tape_object_get_bool(root, sv_new_from_cstr("admin"), &admin) &&
+         admin && "admin");
+  assert(json_tape_object_get(root, sv_new_from_cstr("note"), &value) &&
+         json_tape_type(value) == JSON_NULL && "note");
+  assert(!json_tape_object_get_int64(root, sv_new_from_cstr("name"), &age) &&
+         "wrong type");
+  assert(!json_tape_object_get(root, sv_new_from_cstr("missing"), &value) &&
+         "missing");
+
+  JsonTapeValue tags;
+  assert(json_tape_object_get_array(root, sv_new_from_cstr("tags"), &tags) &&
+         json_tape_len(tags) == 4 && "tags");
+  JsonTapeValue nested;
+  assert(json_tape_array_get(tags, 2, &nested) &&
+         json_tape_object_get_string(nested, sv_new_from_cstr("k"), &name) &&
+         sv_compare(name, sv_new_from_cstr("v\n")) && "decoded string");
+  assert(json_tape_array_get(tags, 3, &value) &&
+         json_tape_type(value) == JSON_FALSE && "after nested");
+  assert(!json_tape_array_get(tags, 4, &value) && "out of range");
+
+  JsonTapeValue empty;
+  assert(json_tape_object_get_object(root, sv_new_from_cstr("empty"),
+                                     &empty) &&
+         json_tape_len(empty) == 0 && "empty object");
+
+  json_tape_free(&tape);
+  sb_free(input);
+}
+
+void test_json_tape_iter() {
+  StringBuffer *input = sb_new_from_cstr("{\"a\": [1, 2.5, \"x\"], \"b\": 2}");
+  JsonTape tape;
+  assert(json_tape_parse(input, &tape) && "should parse");
+  JsonTapeIter members = json_tape_iter(json_tape_root(&tape));
+  StringView key;
+  JsonTapeValue value;
+  assert(json_tape_object_next(&members, &key, &value) &&
+         sv_compare(key, sv_new_from_cstr("a")) && "first key");
+  JsonTapeIter items = json_tape_iter(value);
+  JsonType types[] = {JSON_INT, JSON_DOUBLE, JSON_STRING};
+  JsonTapeValue item;
+  for (size_t i = 0; i < 3; ++i) {
+    assert(json_tape_array_next(&items, &item) &&
+           json_tape_type(item) == types[i] && "item type");
+  }
+  assert(!json_tape_array_next(&items, &item) && "end of array");
+  assert(json_tape_object_next(&members, &key, &value) &&
+         sv_compare(key, sv_new_from_cstr("b")) && "second key");
+  assert(!json_tape_object_next(&members, &key, &value) && "end of object");
+  assert(!json_tape_array_next(&members, &item) && "object is not an array");
+
+  json_tape_free(&tape);
+  sb_free(input);
+}
+
+void test_json_tape_invalid() {
+  StringBuffer *input = sb_new_from_cstr("[1, {\"a\": }]");
+  JsonTape tape;
+  assert(!json_tape_parse(input, &tape) && "should reject invalid input");
+  sb_free(input);
+}
+
+void test_json_tape() {
+  test_json_tape_accessors();
+  test_json_tape_iter();
+  test_json_tape_invalid();
+  printf("All 'json_tape' tests passed successfully!\n");
+}
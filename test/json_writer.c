@@ -0,0 +1,97 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/json_writer.h"
+
+typedef struct {
+  StringBuffer *out;
+  size_t flushes;
+  size_t max_len;
+  size_t fail_after;
+} SinkState;
+
+static bool _sink_cb(const char *data, size_t len, void *context) {
+  SinkState *state = context;
+  if (state->fail_after > 0 && state->flushes == state->fail_after) {
+    return false;
+  }
+  state->flushes++;
+  if (len > state->max_len) {
+    state->max_len = len;
+  }
+  sb_append(state->out, sv_new(data, len));
+  return true;
+}
+
+static const char *writer_input =
+    "{\"name\": \"John\", \"age\": -25, \"big\": 18446744073709551615,"
+    " \"pi\": 3.25, \"ok\": true, \"no\": false, \"none\": null,"
+    " \"text\": \"a string that is longer than the smallest writer buffer"
+    " so it has to bypass the copy\", \"q\\\"uote\": \"tab\\there\\n\","
+    " \"tags\": [1, 2.5, [], {}, [\"x\", {\"k\": \"v\"}]]}";
+
+void test_json_writer_sink() {
+  StringBuffer *input = sb_new_from_cstr(writer_input);
+  Json json;
+  assert(json_parse(input, &json) && "should parse");
+  StringBuffer *expected = sb_new();
+  json_stringify(&json, expected);
+
+  SinkState state = {.out = sb_new()};
+  JsonWriter *w = json_writer_new(0, _sink_cb, &state);
+  assert(w->cap == JSON_WRITER_CAP_MIN && "cap should be clamped");
+  assert(json_write(w, &json) && json_writer_flush(w) && "should write");
+  assert(sb_compare_sv(state.out, sv_new(expected->data, expected->len)) &&
+         "should match stringify");
+  assert(state.flushes > 2 && "should flush in pieces");
+  json_writer_free(w);
+
+  state = (SinkState){.out = state.out, .fail_after = 1};
+  sb_clear(state.out);
+  w = json_writer_new(0, _sink_cb, &state);
+  assert(!json_write(w, &json) && "should report sink failure");
+  assert(!json_writer_write(w, "x", 1) && "should stay failed");
+  json_writer_free(w);
+
+  sb_free(state.out);
+  sb_free(expected);
+  json_object_free(json.object);
+  sb_free(input);
+}
+
+void test_json_writer_fd() {
+  StringBuffer *input = sb_new_from_cstr(writer_input);
+  Json json;
+  assert(json_parse(input, &json) && "should parse");
+  StringBuffer *expected = sb_new();
+  json_stringify(&json, expected);
+
+  FILE *file = tmpfile();
+  assert(file != NULL && "should open temp file");
+  JsonWriter *w = json_writer_new_fd(100, fileno(file));
+  assert(json_write(w, &json) && json_writer_write(w, "\n", 1) &&
+         json_write(w, &json) && json_writer_flush(w) && "should write");
+  json_writer_free(w);
+
+  char read[1024];
+  rewind(file);
+  size_t len = fread(read, 1, sizeof(read), file);
+  assert(len == expected->len * 2 + 1 && "should write both documents");
+  assert(memcmp(read, expected->data, expected->len) == 0 &&
+         read[expected->len] == '\n' &&
+         memcmp(read + expected->len + 1, expected->data, expected->len) ==
+             0 &&
+         "should match stringify");
+  fclose(file);
+
+  sb_free(expected);
+  json_object_free(json.object);
+  sb_free(input);
+}
+
+void test_json_writer() {
+  test_json_writer_sink();
+  test_json_writer_fd();
+  printf("All 'json_writer' tests passed successfully!\n");
+}
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <string.h>
 
 #include "../src/json.h"
 
@@ -16,7 +17,40 @@ void test_lexer_string() {
   sb_free(input);
 }
 
+void test_lexer_location() {
+  StringBuffer *input = sb_new_from_cstr("{\n  \"a\": 1,\n\n  \"b\": x}");
+  Lexer lexer = lexer_new(input);
+  lexer_advance(&lexer);
+  Location location = lexer_location(&lexer);
+  assert(location.line == 1 && location.offset == 1 && "first char");
+
+  lexer_seek(&lexer, strchr(input->data, 'x'));
+  location = lexer_location(&lexer);
+  assert(location.line == 4 && location.offset == 8 && "after blank line");
+
+  lexer_seek(&lexer, input->data + input->len);
+  assert(lexer.ch == JSON_END_OF_INPUT && "end of input");
+  location = lexer_location(&lexer);
+  assert(location.line == 4 && location.offset == 10 && "end location");
+  sb_free(input);
+}
+
+void test_lexer_skip_whitespace() {
+  StringBuffer *input = sb_new_from_cstr(" \t\r\n 7 ");
+  Lexer lexer = lexer_new(input);
+  lexer_advance(&lexer);
+  lexer_skip_whitespace(&lexer);
+  assert(lexer.ch == '7' && lexer.cur == input->data + 5 && "skip to digit");
+  lexer_advance(&lexer);
+  lexer_skip_whitespace(&lexer);
+  assert(lexer.ch == JSON_END_OF_INPUT && lexer.cur == lexer.end &&
+         "skip to end");
+  sb_free(input);
+}
+
 void test_lexer() {
   test_lexer_string();
+  test_lexer_location();
+  test_lexer_skip_whitespace();
   printf("All 'lexer' tests passed successfully\n");
 }
@@ -5,6 +5,23 @@ int main() {
   test_uri();
   test_json();
   test_lexer();
+  test_arena();
+  test_json_escape();
+  test_json_sax();
+  test_json_parser();
+  test_json_index();
+  test_json_number();
+  test_json_ondemand();
+  test_json_tape();
+  test_json_writer();
+  test_json_format();
+  test_json_lines();
+  test_json_pointer();
+  test_json_binary();
+  test_json_decode();
+  test_json_cache();
+  test_json_file_cache();
+  test_mem();
 
   return 0;
 }
@@ -0,0 +1,81 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/json.h"
+#include "../src/mem.h"
+
+void test_mem_default() {
+  char *ptr = mem_calloc(4, sizeof(int));
+  assert(ptr != NULL && ptr[0] == 0 && ptr[15] == 0 && "should zero memory");
+  ptr = mem_realloc(ptr, 64);
+  assert(ptr != NULL && "should grow");
+  mem_free(ptr);
+}
+
+void test_mem_profile() {
+  MemProfile *profile = mem_profile_new();
+  Allocator allocator = mem_profile_allocator(profile);
+  mem_set_allocator(&allocator);
+
+  StringBuffer *input =
+      sb_new_from_cstr("{\"a\": [1, 2, 3], \"b\": {\"c\": \"text\"}}");
+  Json *json = json_new();
+  assert(json_parse(input, json) && "should parse");
+  assert(profile->total.live > 0 && "should track live bytes");
+  size_t peak = profile->total.peak;
+  json_free(json);
+  sb_free(input);
+
+  char *ptr = mem_malloc(100);
+  ptr = mem_realloc(ptr, 1000);
+  memset(ptr, 0, 1000);
+  mem_free(ptr);
+
+  mem_set_allocator(NULL);
+  assert(profile->total.live == 0 && "should free everything");
+  assert(profile->total.calls == profile->total.frees &&
+         "should pair allocations with frees");
+  assert(profile->total.peak >= peak && profile->total.peak >= 1000 &&
+         "should keep the peak");
+
+  const MemStats *json_stats = mem_profile_subsystem(profile, "src/json.c");
+  assert(json_stats != NULL && json_stats->calls > 0 &&
+         json_stats->live == 0 && "should group sites by file");
+  const MemStats *test_stats = mem_profile_subsystem(profile, "test/mem.c");
+  assert(test_stats != NULL && test_stats->calls == 2 &&
+         test_stats->bytes == 1100 && "should count realloc as new bytes");
+  assert(mem_profile_subsystem(profile, "src/uri.c") == NULL &&
+         "should only list used files");
+
+  FILE *out = tmpfile();
+  mem_profile_report(profile, out);
+  assert(ftell(out) > 0 && "should write a report");
+  fclose(out);
+  mem_profile_free(profile);
+}
+
+void test_mem_profile_document() {
+  MemProfile *profile = mem_profile_new();
+  Allocator allocator = mem_profile_allocator(profile);
+
+  StringBuffer *input = sb_new_from_cstr("{\"a\": [1, {\"b\": \"text\"}]}");
+  Json *json = json_new_with_allocator(&allocator);
+  assert(json_parse_with_allocator(input, json, &allocator) &&
+         "should parse");
+  assert(profile->total.live > 0 && "should count the document");
+  json_free_with_allocator(json, &allocator);
+  sb_free(input);
+
+  assert(profile->total.live == 0 && "should free the document");
+  assert(mem_profile_subsystem(profile, "src/json.c") != NULL &&
+         "should attribute document sites");
+  mem_profile_free(profile);
+}
+
+void test_mem() {
+  test_mem_default();
+  test_mem_profile();
+  test_mem_profile_document();
+  printf("All 'mem' tests passed successfully!\n");
+}
@@ -1,6 +1,8 @@
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 
+#include "../src/mem.h"
 #include "../src/string_utils.h"
 
 void test_sv_starts_with() {
@@ -159,12 +161,61 @@ void test_sb_remove() {
   sb_free(sb);
 }
 
+void test_sb_zero_cap() {
+  MemProfile *profile = mem_profile_new();
+  Allocator allocator = mem_profile_allocator(profile);
+  mem_set_allocator(&allocator);
+  StringBuffer *sb = sb_new_with_custom_cap(0);
+  assert(!sb_is_borrowed(sb) && "test_sb_zero_cap should own its data");
+  sb_append(sb, sv_new_from_cstr("grown"));
+  assert(sb_compare_sv(sb, sv_new_from_cstr("grown")) &&
+         "test_sb_zero_cap failed append");
+  sb_free(sb);
+  mem_set_allocator(NULL);
+  assert(profile->total.live == 0 && "test_sb_zero_cap should not leak");
+  mem_profile_free(profile);
+}
+
+void test_sb_borrowed_append() {
+  StringBuffer borrowed = {.data = "borrowed bytes", .cap = 0, .len = 14};
+  sb_append(&borrowed, sv_new_from_cstr("!"));
+  assert(!sb_is_borrowed(&borrowed) && borrowed.cap > borrowed.len &&
+         sb_compare_sv(&borrowed, sv_new_from_cstr("borrowed bytes!")) &&
+         "test_sb_borrowed_append should copy all borrowed bytes");
+  mem_free((char *)borrowed.data);
+}
+
 void test_sb_file_read() {
   StringBuffer *sb = sb_new();
   assert(sb_file_read("test.json", sb) && "test_sb_file_read fail");
   sb_free(sb);
 }
 
+void test_sb_file_map() {
+  StringBuffer *read = sb_new();
+  assert(sb_file_read("test.json", read) && "test_sb_file_map fail");
+  SbFileMap mapped;
+  assert(sb_file_map("test.json", &mapped) &&
+         sb_is_borrowed(&mapped.content) && "test_sb_file_map fail");
+  assert(mapped.content.len == read->len &&
+         memcmp(mapped.content.data, read->data, read->len) == 0 &&
+         "test_sb_file_map should match sb_file_read");
+  sb_file_unmap(&mapped);
+  assert(mapped.content.len == 0 && mapped.len == 0 &&
+         "test_sb_file_map should reset");
+  assert(!sb_file_map("missing.json", &mapped) && "test_sb_file_map fail");
+
+  assert(sb_file_map("test.json", &mapped) && "test_sb_file_map fail");
+  sb_append(&mapped.content, sv_new_from_cstr("tail"));
+  assert(!sb_is_borrowed(&mapped.content) &&
+         mapped.content.len == read->len + 4 &&
+         "test_sb_file_map grown content should be a heap copy");
+  sb_file_unmap(&mapped);
+  assert(mapped.content.len == 0 && mapped.len == 0 &&
+         "test_sb_file_map should release a grown mapping");
+  sb_free(read);
+}
+
 void test_string_utils() {
   test_sv_starts_with();
   test_sv_ends_with();
@@ -182,7 +233,10 @@ void test_string_utils() {
   test_sb_sub();
   test_sb_clear();
   test_sb_remove();
+  test_sb_zero_cap();
+  test_sb_borrowed_append();
   test_sb_file_read();
+  test_sb_file_map();
 
   printf("All 'string_utils' tests passed!\n");
 }